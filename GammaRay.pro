@@ -168,12 +168,16 @@ SOURCES += main.cpp\
     geostats/matrixmxn.cpp \
     dialogs/ndvestimationdialog.cpp \
     geostats/gridcell.cpp \
+    geostats/cartesiangridsearchtemplate.cpp \
+    geostats/cartesiangridcovariancetable.cpp \
+    geostats/compiledvariogrammodel.cpp \
+    geostats/krigingsolver.cpp \
+    geostats/krigingweightscache.cpp \
     geostats/ndvestimation.cpp \
     geostats/spatiallocation.cpp \
     geostats/ndvestimationrunner.cpp \
     geostats/ijkdelta.cpp \
     geostats/ijkindex.cpp \
-    geostats/ijkdeltascache.cpp \
     dialogs/realizationselectiondialog.cpp \
     dialogs/gridresampledialog.cpp \
     dialogs/multivariogramdialog.cpp \
@@ -203,6 +207,11 @@ SOURCES += main.cpp\
     algorithms/decisiontree.cpp \
     domain/auxiliary/variableremover.cpp \
     domain/auxiliary/datasaver.cpp \
+    domain/auxiliary/datacache.cpp \
+    domain/auxiliary/filevaliditystamp.cpp \
+    domain/auxiliary/columnardatatable.cpp \
+    domain/auxiliary/datalineindex.cpp \
+    domain/auxiliary/datacolumnstatistics.cpp \
     imagejockey/svd/svdparametersdialog.cpp \
     imagejockey/svd/svdfactor.cpp \
     imagejockey/svd/svdfactortree.cpp \
@@ -238,6 +247,8 @@ SOURCES += main.cpp\
     domain/geogrid.cpp \
     domain/gridfile.cpp \
     domain/auxiliary/meshloader.cpp \
+    domain/auxiliary/geogridmesh.cpp \
+    domain/auxiliary/geogridcelllocator.cpp \
     geometry/vector3d.cpp \
     geometry/face3d.cpp \
     dialogs/sisimdialog.cpp \
@@ -283,6 +294,9 @@ SOURCES += main.cpp\
     geostats/mcrfsim.cpp \
     gslib/gslibparameterfiles/commonsimulationparameters.cpp \
     spatialindex/spatialindex.cpp \
+    spatialindex/kdtree.cpp \
+    spatialindex/uniformgrid.cpp \
+    spatialindex/simulatednodesindex.cpp \
     geostats/taumodel.cpp \
     dialogs/mcmcdataimputationdialog.cpp \
     imagejockey/paraviewscalarbar/vtkBoundingRectContextDevice2D.cpp \
@@ -431,12 +445,16 @@ HEADERS  += mainwindow.h \
     geostats/matrixmxn.h \
     dialogs/ndvestimationdialog.h \
     geostats/gridcell.h \
+    geostats/cartesiangridsearchtemplate.h \
+    geostats/cartesiangridcovariancetable.h \
+    geostats/compiledvariogrammodel.h \
+    geostats/krigingsolver.h \
+    geostats/krigingweightscache.h \
     geostats/ndvestimation.h \
     geostats/spatiallocation.h \
     geostats/ndvestimationrunner.h \
     geostats/ijkdelta.h \
     geostats/ijkindex.h \
-    geostats/ijkdeltascache.h \
     dialogs/realizationselectiondialog.h \
     dialogs/gridresampledialog.h \
     dialogs/multivariogramdialog.h \
@@ -466,6 +484,11 @@ HEADERS  += mainwindow.h \
     algorithms/decisiontree.h \
     domain/auxiliary/variableremover.h \
     domain/auxiliary/datasaver.h \
+    domain/auxiliary/datacache.h \
+    domain/auxiliary/filevaliditystamp.h \
+    domain/auxiliary/columnardatatable.h \
+    domain/auxiliary/datalineindex.h \
+    domain/auxiliary/datacolumnstatistics.h \
     imagejockey/svd/svdparametersdialog.h \
     imagejockey/svd/svdfactor.h \
     imagejockey/svd/svdfactortree.h \
@@ -504,6 +527,8 @@ HEADERS  += mainwindow.h \
     domain/geogrid.h \
     domain/gridfile.h \
     domain/auxiliary/meshloader.h \
+    domain/auxiliary/geogridmesh.h \
+    domain/auxiliary/geogridcelllocator.h \
     geometry/vector3d.h \
     geometry/face3d.h \
     dialogs/sisimdialog.h \
@@ -549,6 +574,9 @@ HEADERS  += mainwindow.h \
     geostats/mcrfsim.h \
     gslib/gslibparameterfiles/commonsimulationparameters.h \
     spatialindex/spatialindex.h \
+    spatialindex/kdtree.h \
+    spatialindex/uniformgrid.h \
+    spatialindex/simulatednodesindex.h \
     geostats/taumodel.h \
     dialogs/mcmcdataimputationdialog.h \
     imagejockey/paraviewscalarbar/vtkBoundingRectContextDevice2D.h \
@@ -286,10 +286,11 @@ void FactorialKrigingDialog::doFK()
 
     // get search algorithm option.
     SearchAlogorithmOption searchAlogorithmOption;
-    if( m_gpfFK->getParameter<GSLibParOption*>( 9 )->_selected_value == 0 )
-        searchAlogorithmOption = SearchAlogorithmOption::GENERIC_RTREE_BASED;
-    else
-        searchAlogorithmOption = SearchAlogorithmOption::OPTIMIZED_FOR_LARGE_HIGH_DENSITY_DATASETS;
+    switch( m_gpfFK->getParameter<GSLibParOption*>( 9 )->_selected_value ){
+    case 0: searchAlogorithmOption = SearchAlogorithmOption::GENERIC_RTREE_BASED; break;
+    case 1: searchAlogorithmOption = SearchAlogorithmOption::OPTIMIZED_FOR_LARGE_HIGH_DENSITY_DATASETS; break;
+    default: searchAlogorithmOption = SearchAlogorithmOption::ANISOTROPIC_DISTANCE_RANKED;
+    }
 
     //Build the search strategy and search neighborhood objects from the user-input values.
 	// See parameter indexes and types in GSLibParameterFile::makeParamatersForFactorialKriging()
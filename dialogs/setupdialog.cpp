@@ -14,6 +14,8 @@ SetupDialog::SetupDialog(QWidget *parent) :
     ui->txtGSPath->setText( Application::instance()->getGhostscriptPathSetting() );
     ui->txtGVPath->setText( Application::instance()->getGraphVizPathSetting() );
     ui->spinMaxGridCells3DView->setValue( Application::instance()->getMaxGridCellCountFor3DVisualizationSetting() );
+    ui->chkDataFileCache->setChecked( Application::instance()->getDataFileCacheSetting() );
+    ui->chkDataFileSinglePrecision->setChecked( Application::instance()->getDataFileSinglePrecisionSetting() );
     adjustSize();
 }
 
@@ -50,6 +52,8 @@ void SetupDialog::accept()
     Application::instance()->setGhostscriptPathSetting( ui->txtGSPath->text() );
     Application::instance()->setGraphVizPathSetting( ui->txtGVPath->text() );
     Application::instance()->setMaxGridCellCountFor3DVisualizationSetting( ui->spinMaxGridCells3DView->value() );
+    Application::instance()->setDataFileCacheSetting( ui->chkDataFileCache->isChecked() );
+    Application::instance()->setDataFileSinglePrecisionSetting( ui->chkDataFileSinglePrecision->isChecked() );
     //make dialog close.
     this->reject();
 }
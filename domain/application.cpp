@@ -91,6 +91,30 @@ void Application::setMaxGridCellCountFor3DVisualizationSetting(int value)
     qs.setValue("maxcellgrid3dview", value);
 }
 
+bool Application::getDataFileCacheSetting()
+{
+    QSettings qs;
+    return qs.value("datafilecache", false).toBool();
+}
+
+void Application::setDataFileCacheSetting(bool value)
+{
+    QSettings qs;
+    qs.setValue("datafilecache", value);
+}
+
+bool Application::getDataFileSinglePrecisionSetting()
+{
+    QSettings qs;
+    return qs.value("datafilesingleprecision", false).toBool();
+}
+
+void Application::setDataFileSinglePrecisionSetting(bool value)
+{
+    QSettings qs;
+    qs.setValue("datafilesingleprecision", value);
+}
+
 void Application::logInfo(const QString text, bool showMessageBox)
 {
     Q_ASSERT(_mw != 0);
@@ -87,6 +87,18 @@ public:
     void setMaxGridCellCountFor3DVisualizationSetting(int value);
     //!@}
 
+    //!@{
+    //! Reads and saves whether data files keep binary caches of their parsed data (see DataCache class).
+    bool getDataFileCacheSetting();
+    void setDataFileCacheSetting(bool value);
+    //!@}
+
+    //!@{
+    //! Reads and saves whether continuous variables of data files are kept in memory in single precision.
+    bool getDataFileSinglePrecisionSetting();
+    void setDataFileSinglePrecisionSetting(bool value);
+    //!@}
+
     /**
      * @brief Treats the text as an information text.
      */
@@ -0,0 +1,337 @@
+#include "columnardatatable.h"
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+const int16_t DataColumnSpan::INT16_NO_DATA;
+const int8_t DataColumnSpan::INT8_NO_DATA;
+
+namespace {
+
+size_t elementSize( DataColumnType type )
+{
+    switch( type ){
+    case DataColumnType::FLOAT32: return sizeof(float);
+    case DataColumnType::INT16: return sizeof(int16_t);
+    case DataColumnType::INT8: return sizeof(int8_t);
+    default: return sizeof(double);
+    }
+}
+
+/** Returns whether the value is an integer in [-maxMagnitude, maxMagnitude]. */
+bool isIntegerInRange( double value, double maxMagnitude )
+{
+    return std::abs( value ) <= maxMagnitude && std::floor( value ) == value;
+}
+
+}
+
+ColumnarDataTable::ColumnarDataTable() :
+    m_rowCount( 0 )
+{
+}
+
+ColumnarDataTable::ColumnarDataTable(size_t rowCount, size_t columnCount, double value) :
+    m_columns( columnCount ),
+    m_rowCount( rowCount )
+{
+    for( size_t iColumn = 0; iColumn < columnCount; ++iColumn ){
+        m_columns[iColumn].bytes.resize( rowCount * sizeof(double) );
+        double* column = getColumnForWriting( iColumn );
+        for( size_t iRow = 0; iRow < rowCount; ++iRow )
+            column[iRow] = value;
+    }
+}
+
+ColumnarDataTable::ColumnarDataTable(size_t rowCount, const std::vector<bool> &loadedColumns) :
+    m_columns( loadedColumns.size() ),
+    m_rowCount( rowCount )
+{
+    for( size_t iColumn = 0; iColumn < m_columns.size(); ++iColumn ){
+        m_columns[iColumn].isLoaded = loadedColumns[iColumn];
+        if( loadedColumns[iColumn] )
+            m_columns[iColumn].bytes.resize( rowCount * sizeof(double) ); //zero-initialized
+    }
+}
+
+ColumnarDataTable ColumnarDataTable::fromRows(const std::vector<std::vector<double> > &rows)
+{
+    if( rows.empty() )
+        return ColumnarDataTable();
+    size_t columnCount = rows[0].size();
+    ColumnarDataTable table( rows.size(), columnCount );
+    for( size_t iColumn = 0; iColumn < columnCount; ++iColumn ){
+        double* column = table.getColumnForWriting( iColumn );
+        for( size_t iRow = 0; iRow < rows.size(); ++iRow )
+            if( iColumn < rows[iRow].size() )
+                column[iRow] = rows[iRow][iColumn];
+    }
+    return table;
+}
+
+bool ColumnarDataTable::hasUnloadedColumns() const
+{
+    for( const Column& storage : m_columns )
+        if( ! storage.isLoaded )
+            return true;
+    return false;
+}
+
+double ColumnarDataTable::at(size_t row, size_t column) const
+{
+    if( row >= m_rowCount || ! isColumnLoaded( column ) )
+        throw std::out_of_range("ColumnarDataTable::at(): position out of range.");
+    return (*this)( row, column );
+}
+
+void ColumnarDataTable::set(size_t row, size_t column, double value)
+{
+    Column& storage = m_columns[column];
+    switch( storage.type ){
+    case DataColumnType::FLOAT32:
+        reinterpret_cast<float*>( storage.bytes.data() )[row] = static_cast<float>( value );
+        return;
+    case DataColumnType::INT16:
+        if( value == storage.noDataValue ){
+            reinterpret_cast<int16_t*>( storage.bytes.data() )[row] = DataColumnSpan::INT16_NO_DATA;
+            return;
+        }
+        if( isIntegerInRange( value, 32767.0 ) ){
+            reinterpret_cast<int16_t*>( storage.bytes.data() )[row] = static_cast<int16_t>( value );
+            return;
+        }
+        break;
+    case DataColumnType::INT8:
+        if( value == storage.noDataValue ){
+            reinterpret_cast<int8_t*>( storage.bytes.data() )[row] = DataColumnSpan::INT8_NO_DATA;
+            return;
+        }
+        if( isIntegerInRange( value, 127.0 ) ){
+            reinterpret_cast<int8_t*>( storage.bytes.data() )[row] = static_cast<int8_t>( value );
+            return;
+        }
+        break;
+    default:
+        reinterpret_cast<double*>( storage.bytes.data() )[row] = value;
+        return;
+    }
+    //the value does not fit in the integer column: it goes back to double precision.
+    getColumnForWriting( column )[row] = value;
+}
+
+void ColumnarDataTable::setAt(size_t row, size_t column, double value)
+{
+    if( row >= m_rowCount || ! isColumnLoaded( column ) )
+        throw std::out_of_range("ColumnarDataTable::setAt(): position out of range.");
+    set( row, column, value );
+}
+
+DataColumnSpan ColumnarDataTable::getColumn(size_t column) const
+{
+    DataColumnSpan span;
+    if( isColumnLoaded( column ) ){
+        const Column& storage = m_columns[column];
+        span.values = storage.bytes.data();
+        span.size = m_rowCount;
+        span.type = storage.type;
+        span.noDataValue = storage.noDataValue;
+    } else {
+        span.values = nullptr;
+        span.size = 0;
+        span.type = DataColumnType::FLOAT64;
+        span.noDataValue = 0.0;
+    }
+    return span;
+}
+
+double *ColumnarDataTable::getColumnForWriting(size_t column)
+{
+    if( m_columns[column].type != DataColumnType::FLOAT64 )
+        widenToFloat64( column );
+    return reinterpret_cast<double*>( m_columns[column].bytes.data() );
+}
+
+bool ColumnarDataTable::narrowToIntegers(size_t column, bool hasNoDataValue, double noDataValue)
+{
+    Column& storage = m_columns[column];
+    if( ! storage.isLoaded )
+        return false;
+    if( storage.type == DataColumnType::INT8 || storage.type == DataColumnType::INT16 )
+        return true;
+    if( storage.type != DataColumnType::FLOAT64 )
+        return false;
+
+    //find the narrowest type that holds all values exactly
+    const double* values = reinterpret_cast<const double*>( storage.bytes.data() );
+    bool fitsInt8 = true;
+    for( size_t iRow = 0; iRow < m_rowCount; ++iRow ){
+        double value = values[iRow];
+        if( hasNoDataValue && value == noDataValue )
+            continue;
+        if( ! isIntegerInRange( value, 32767.0 ) )
+            return false;
+        if( std::abs( value ) > 127.0 )
+            fitsInt8 = false;
+    }
+
+    Column narrowed;
+    narrowed.type = fitsInt8 ? DataColumnType::INT8 : DataColumnType::INT16;
+    //a NaN never compares equal, so columns without no-data value never produce the sentinel in set().
+    narrowed.noDataValue = hasNoDataValue ? noDataValue : std::numeric_limits<double>::quiet_NaN();
+    narrowed.bytes.resize( m_rowCount * elementSize( narrowed.type ) );
+    if( fitsInt8 ){
+        int8_t* codes = reinterpret_cast<int8_t*>( narrowed.bytes.data() );
+        for( size_t iRow = 0; iRow < m_rowCount; ++iRow )
+            codes[iRow] = ( hasNoDataValue && values[iRow] == noDataValue ) ?
+                              DataColumnSpan::INT8_NO_DATA : static_cast<int8_t>( values[iRow] );
+    } else {
+        int16_t* codes = reinterpret_cast<int16_t*>( narrowed.bytes.data() );
+        for( size_t iRow = 0; iRow < m_rowCount; ++iRow )
+            codes[iRow] = ( hasNoDataValue && values[iRow] == noDataValue ) ?
+                              DataColumnSpan::INT16_NO_DATA : static_cast<int16_t>( values[iRow] );
+    }
+    std::swap( storage, narrowed );
+    return true;
+}
+
+bool ColumnarDataTable::narrowToFloat32(size_t column, bool hasNoDataValue, double noDataValue)
+{
+    Column& storage = m_columns[column];
+    if( ! storage.isLoaded )
+        return false;
+    if( storage.type == DataColumnType::FLOAT32 )
+        return true;
+    if( storage.type != DataColumnType::FLOAT64 )
+        return false;
+    if( hasNoDataValue && static_cast<double>( static_cast<float>( noDataValue ) ) != noDataValue )
+        return false;
+
+    const double* values = reinterpret_cast<const double*>( storage.bytes.data() );
+    const double maxFloat = std::numeric_limits<float>::max();
+    for( size_t iRow = 0; iRow < m_rowCount; ++iRow )
+        if( std::abs( values[iRow] ) > maxFloat )
+            return false;
+
+    Column narrowed;
+    narrowed.type = DataColumnType::FLOAT32;
+    narrowed.bytes.resize( m_rowCount * sizeof(float) );
+    float* floats = reinterpret_cast<float*>( narrowed.bytes.data() );
+    for( size_t iRow = 0; iRow < m_rowCount; ++iRow )
+        floats[iRow] = static_cast<float>( values[iRow] );
+    std::swap( storage, narrowed );
+    return true;
+}
+
+std::vector<double> ColumnarDataTable::getRow(size_t row) const
+{
+    std::vector<double> result( m_columns.size(), std::numeric_limits<double>::quiet_NaN() );
+    for( size_t iColumn = 0; iColumn < m_columns.size(); ++iColumn )
+        if( m_columns[iColumn].isLoaded )
+            result[iColumn] = (*this)( row, iColumn );
+    return result;
+}
+
+void ColumnarDataTable::appendRow(const std::vector<double> &values)
+{
+    if( m_columns.empty() ){
+        m_columns.resize( values.size() );
+        for( Column& storage : m_columns )
+            storage.bytes.resize( m_rowCount * sizeof(double) );
+    }
+    ++m_rowCount;
+    for( size_t iColumn = 0; iColumn < m_columns.size(); ++iColumn ){
+        Column& storage = m_columns[iColumn];
+        if( ! storage.isLoaded )
+            continue;
+        storage.bytes.resize( m_rowCount * elementSize( storage.type ) );
+        set( m_rowCount - 1, iColumn, iColumn < values.size() ? values[iColumn] : 0.0 );
+    }
+}
+
+void ColumnarDataTable::removeRow(size_t row)
+{
+    for( Column& storage : m_columns ){
+        if( ! storage.isLoaded )
+            continue;
+        size_t size = elementSize( storage.type );
+        storage.bytes.erase( storage.bytes.begin() + row * size, storage.bytes.begin() + ( row + 1 ) * size );
+    }
+    --m_rowCount;
+}
+
+void ColumnarDataTable::removeRows(const std::vector<size_t> &rowsInAscendingOrder)
+{
+    if( rowsInAscendingOrder.empty() )
+        return;
+    for( Column& storage : m_columns ){
+        if( ! storage.isLoaded )
+            continue;
+        size_t size = elementSize( storage.type );
+        unsigned char* bytes = storage.bytes.data();
+        //stable compaction: shifts the kept values over the removed ones.
+        size_t iDestination = rowsInAscendingOrder[0];
+        size_t iSource = iDestination;
+        std::vector<size_t>::const_iterator itRemoved = rowsInAscendingOrder.cbegin();
+        for( ; iSource < m_rowCount; ++iSource ){
+            if( itRemoved != rowsInAscendingOrder.cend() && *itRemoved == iSource ){
+                ++itRemoved;
+                continue;
+            }
+            std::memcpy( bytes + iDestination * size, bytes + iSource * size, size );
+            ++iDestination;
+        }
+        storage.bytes.resize( iDestination * size );
+    }
+    m_rowCount -= rowsInAscendingOrder.size();
+}
+
+void ColumnarDataTable::appendColumn(const std::vector<double> &values, double fillValue)
+{
+    if( m_columns.empty() )
+        m_rowCount = values.size();
+    m_columns.push_back( Column() );
+    m_columns.back().bytes.resize( m_rowCount * sizeof(double) );
+    double* column = getColumnForWriting( m_columns.size() - 1 );
+    for( size_t iRow = 0; iRow < m_rowCount; ++iRow )
+        column[iRow] = iRow < values.size() ? values[iRow] : fillValue;
+}
+
+std::vector<std::vector<double> > ColumnarDataTable::toRows() const
+{
+    std::vector< std::vector<double> > result( m_rowCount, std::vector<double>( m_columns.size(), std::numeric_limits<double>::quiet_NaN() ) );
+    for( size_t iColumn = 0; iColumn < m_columns.size(); ++iColumn ){
+        if( ! m_columns[iColumn].isLoaded )
+            continue;
+        DataColumnSpan column = getColumn( iColumn );
+        for( size_t iRow = 0; iRow < m_rowCount; ++iRow )
+            result[iRow][iColumn] = column[iRow];
+    }
+    return result;
+}
+
+size_t ColumnarDataTable::getMemoryUsage() const
+{
+    size_t result = 0;
+    for( const Column& storage : m_columns )
+        result += storage.bytes.size();
+    return result;
+}
+
+void ColumnarDataTable::clear()
+{
+    //clear() does not guarantee memory is actually freed.
+    std::vector< Column >().swap( m_columns );
+    m_rowCount = 0;
+}
+
+void ColumnarDataTable::widenToFloat64(size_t column)
+{
+    DataColumnSpan span = getColumn( column );
+    Column widened;
+    widened.bytes.resize( m_rowCount * sizeof(double) );
+    double* values = reinterpret_cast<double*>( widened.bytes.data() );
+    for( size_t iRow = 0; iRow < m_rowCount; ++iRow )
+        values[iRow] = span[iRow];
+    std::swap( m_columns[column], widened );
+}
@@ -0,0 +1,220 @@
+#ifndef COLUMNARDATATABLE_H
+#define COLUMNARDATATABLE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/** The in-memory storage types of the data columns of a ColumnarDataTable.
+ * Values are always widened to double when read.
+ */
+enum class DataColumnType : unsigned char {
+    FLOAT64 = 0, //!< full precision (default)
+    FLOAT32,     //!< reduced precision for continuous variables
+    INT16,       //!< integer codes (e.g. categorical variables) in [-32767, 32767]
+    INT8         //!< integer codes (e.g. categorical variables) in [-127, 127]
+};
+
+/** A read-only view of the values of a data column, which are stored contiguously in memory.
+ * The values are widened to double on access whatever the storage type of the column is.
+ * It is valid until the table it refers to is changed in size or freed.
+ */
+struct DataColumnSpan
+{
+    /** The values reserved in integer columns to store the no-data value. */
+    static const int16_t INT16_NO_DATA = -32768;
+    static const int8_t INT8_NO_DATA = -128;
+
+    const void* values;
+    size_t size;
+    DataColumnType type;
+    /** The value read where an integer column has its no-data sentinel. */
+    double noDataValue;
+
+    /** Iterates over the values as doubles. */
+    class const_iterator {
+    public:
+        const_iterator( const DataColumnSpan* span, size_t i ) : m_span( span ), m_i( i ) {}
+        double operator*() const { return (*m_span)[m_i]; }
+        const_iterator& operator++() { ++m_i; return *this; }
+        bool operator!=( const const_iterator& other ) const { return m_i != other.m_i; }
+        bool operator==( const const_iterator& other ) const { return m_i == other.m_i; }
+    private:
+        const DataColumnSpan* m_span;
+        size_t m_i;
+    };
+
+    const_iterator begin() const { return const_iterator( this, 0 ); }
+    const_iterator end() const { return const_iterator( this, size ); }
+
+    double operator[]( size_t i ) const {
+        //the common case first, so full precision columns do not pay for the dispatch on the type.
+        if( type == DataColumnType::FLOAT64 )
+            return static_cast<const double*>( values )[i];
+        switch( type ){
+        case DataColumnType::FLOAT32:
+            return static_cast<const float*>( values )[i];
+        case DataColumnType::INT16: {
+            int16_t value = static_cast<const int16_t*>( values )[i];
+            return value == INT16_NO_DATA ? noDataValue : value;
+        }
+        case DataColumnType::INT8: {
+            int8_t value = static_cast<const int8_t*>( values )[i];
+            return value == INT8_NO_DATA ? noDataValue : value;
+        }
+        default:
+            return static_cast<const double*>( values )[i];
+        }
+    }
+
+    bool empty() const { return size == 0; }
+
+    /** Returns the address of the values if they are stored as doubles or nullptr otherwise. */
+    const double* getDoubles() const {
+        return type == DataColumnType::FLOAT64 ? static_cast<const double*>( values ) : nullptr;
+    }
+};
+
+/**
+ * The ColumnarDataTable class is the in-memory storage of the data table of DataFile objects.
+ * The values are stored column by column (structure of arrays): each data column (variable) is
+ * a single contiguous array.  This avoids one heap allocation per data row and makes per-variable
+ * scans (statistics, estimation, etc.) sweep contiguous memory.  Row-oriented access is
+ * still available through the row methods, which gather/scatter the values of a row.
+ * Each column may be stored in a narrower type (see DataColumnType and the narrowTo*() methods)
+ * to save memory.  Values are widened to double when read, so client code is unaware of it.
+ * Columns may also be left unloaded (see DataFile::loadData(const std::set<uint>&)): they keep their
+ * place, so the column indexes remain those of the file, but they have no values.
+ * Rows and columns are zero-based.
+ */
+class ColumnarDataTable
+{
+public:
+    /** Makes an empty table. */
+    ColumnarDataTable();
+
+    /** Makes a table with the given dimensions filled with the given value. */
+    ColumnarDataTable( size_t rowCount, size_t columnCount, double value = 0.0 );
+
+    /** Makes a table filled with zeros in which only the columns flagged in loadedColumns have values.
+     * The column count is the size of loadedColumns.
+     */
+    ColumnarDataTable( size_t rowCount, const std::vector<bool>& loadedColumns );
+
+    /** Makes a table from a row-major table (e.g. those returned by DataFile::getDataSortedBy()).
+     * The column count is taken from the first row.
+     */
+    static ColumnarDataTable fromRows( const std::vector< std::vector<double> >& rows );
+
+    size_t getRowCount() const { return m_rowCount; }
+    size_t getColumnCount() const { return m_columns.size(); }
+
+    /** Returns whether the table has no rows. */
+    bool empty() const { return m_rowCount == 0; }
+
+    /** Returns whether the given column exists and has values. */
+    bool isColumnLoaded( size_t column ) const { return column < m_columns.size() && m_columns[column].isLoaded; }
+
+    /** Returns whether some column has no values. */
+    bool hasUnloadedColumns() const;
+
+    /** Returns the value at the given position without bounds checking.  The column must be loaded.
+     * Loops over many values of a column should rather take the column once with getColumn() (or the address
+     * of its values with DataColumnSpan::getDoubles()), which dispatches on the storage type only once.
+     */
+    double operator()( size_t row, size_t column ) const {
+        const Column& storage = m_columns[column];
+        if( storage.type == DataColumnType::FLOAT64 )
+            return reinterpret_cast<const double*>( storage.bytes.data() )[row];
+        return getColumn( column )[row];
+    }
+
+    /** Returns the value at the given position.  Throws std::out_of_range if the position is off-table
+     * or the column is not loaded. */
+    double at( size_t row, size_t column ) const;
+
+    /** Sets the value at the given position without bounds checking.  The column must be loaded.
+     * Integer columns are widened to double if the value cannot be stored exactly.
+     * Values set in single precision columns are rounded to single precision.
+     */
+    void set( size_t row, size_t column, double value );
+
+    /** Same as set(), but throws std::out_of_range if the position is off-table or the column is not loaded. */
+    void setAt( size_t row, size_t column, double value );
+
+    /** Returns a zero-copy view of the values in the given column.  The view is empty if there is no such column
+     * or if it is not loaded. */
+    DataColumnSpan getColumn( size_t column ) const;
+
+    /** Returns the address of the contiguous values of the given column for in-place writing.  The column must be loaded.
+     * The column is widened to double precision first if it is stored in a narrower type.
+     */
+    double* getColumnForWriting( size_t column );
+
+    /** Returns the storage type of the given column. */
+    DataColumnType getColumnType( size_t column ) const { return m_columns[column].type; }
+
+    /** Tries to store the given column as 8-bit or 16-bit integers.  This only succeeds if every value
+     * is an integer in the range of the narrower type or is the no-data value, so no information is lost.
+     * @return Whether the column is now stored as integers.
+     */
+    bool narrowToIntegers( size_t column, bool hasNoDataValue, double noDataValue );
+
+    /** Tries to store the given column in single precision.  This fails if some value is beyond the float
+     * range or if the no-data value cannot be stored exactly in single precision (it would no longer
+     * be recognized as such).  Other values are rounded to ~7 significant digits.
+     * @return Whether the column is now stored in single precision.
+     */
+    bool narrowToFloat32( size_t column, bool hasNoDataValue, double noDataValue );
+
+    /** Returns a copy of the values in the given row.  Values in unloaded columns are NaN. */
+    std::vector<double> getRow( size_t row ) const;
+
+    /** Appends a row to the table.  If the table has no columns, the row defines the column count.
+     * Missing values are filled with zeros and excess values are ignored, as are values of unloaded columns.
+     */
+    void appendRow( const std::vector<double>& values );
+
+    /** Removes the given row. */
+    void removeRow( size_t row );
+
+    /** Removes the given rows in a single pass.  The row indexes must be in ascending order. */
+    void removeRows( const std::vector<size_t>& rowsInAscendingOrder );
+
+    /** Appends a column to the table.  If the table has no columns, the column defines the row count.
+     * If there are fewer values than rows, the remaining rows are filled with the given value.
+     * Excess values are ignored.  New columns are stored as doubles.
+     */
+    void appendColumn( const std::vector<double>& values, double fillValue = 0.0 );
+
+    /** Returns a row-major copy of the table (outer vector are rows, inner vectors are values in a row).
+     * Values in unloaded columns are NaN. */
+    std::vector< std::vector<double> > toRows() const;
+
+    /** Returns the number of bytes taken by the stored values. */
+    size_t getMemoryUsage() const;
+
+    /** Empties the table and frees its memory. */
+    void clear();
+
+private:
+    /** The storage of a data column. */
+    struct Column {
+        Column() : type( DataColumnType::FLOAT64 ), noDataValue( 0.0 ), isLoaded( true ) {}
+        DataColumnType type;
+        /** The values as raw bytes (memory from the default allocator is suitably aligned for any type). */
+        std::vector<unsigned char> bytes;
+        /** The value of the no-data sentinel of integer columns. */
+        double noDataValue;
+        /** Unloaded columns have no values (bytes is empty). */
+        bool isLoaded;
+    };
+
+    std::vector< Column > m_columns;
+    size_t m_rowCount;
+
+    /** Converts the given column back to double precision. */
+    void widenToFloat64( size_t column );
+};
+
+#endif // COLUMNARDATATABLE_H
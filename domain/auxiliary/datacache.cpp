@@ -0,0 +1,136 @@
+#include "datacache.h"
+#include "filevaliditystamp.h"
+#include "../application.h"
+#include "columnardatatable.h"
+#include <QFile>
+#include <cstring>
+
+/** The fixed-size header at the beginning of the cache files.
+ * The data follow it: nColumns arrays of nRows doubles each. */
+struct DataCacheHeader {
+    char magic[8];
+    FileValidityStamp dataFileStamp;
+    quint64 nRows;
+    quint64 nColumns;
+    quint64 dataLineCount;
+};
+
+//Change the last char whenever the cache layout changes, so old caches get rebuilt.
+static const char DATA_CACHE_MAGIC[8] = { 'G', 'R', 'D', 'C', 'A', 'C', 'H', '1' };
+
+DataCache::DataCache(const QString dataFilePath) :
+    _dataFilePath( dataFilePath )
+{
+}
+
+QString DataCache::getCachePath() const
+{
+    return QString( _dataFilePath ).append(".cache");
+}
+
+bool DataCache::load( const FileValidityStamp &dataFileStamp,
+                      ColumnarDataTable &data,
+                      uint &data_line_count ) const
+{
+    if( dataFileStamp.isNull() )
+        return false;
+
+    QFile cacheFile( getCachePath() );
+    if( ! cacheFile.exists() || ! cacheFile.open( QFile::ReadOnly ) )
+        return false;
+
+    //read and check the header
+    DataCacheHeader header;
+    if( cacheFile.read( reinterpret_cast<char*>( &header ), sizeof(header) ) != (qint64)sizeof(header) ||
+        std::memcmp( header.magic, DATA_CACHE_MAGIC, sizeof(DATA_CACHE_MAGIC) ) ||
+        header.dataFileStamp != dataFileStamp )
+        return false;
+    quint64 nValues = header.nRows * header.nColumns;
+    if( static_cast<quint64>( cacheFile.size() ) != sizeof(header) + nValues * sizeof(double) ){
+        Application::instance()->logWarn( "DataCache::load(): cache file " + getCachePath() + " is truncated.  Ignoring it." );
+        return false;
+    }
+
+    //map the stored data columns
+    const double* columns = nullptr;
+    uchar* mappedFile = nullptr;
+    if( nValues ){
+        mappedFile = cacheFile.map( sizeof(header), nValues * sizeof(double) );
+        if( ! mappedFile )
+            return false;
+        columns = reinterpret_cast<const double*>( mappedFile );
+    }
+
+    //copy the columns into the data table
+    data = ColumnarDataTable( header.nRows, header.nColumns );
+    for( quint64 iColumn = 0; iColumn < header.nColumns; ++iColumn )
+        std::memcpy( data.getColumnForWriting( iColumn ),
+                     columns + iColumn * header.nRows,
+                     header.nRows * sizeof(double) );
+    data_line_count = header.dataLineCount;
+
+    if( mappedFile )
+        cacheFile.unmap( mappedFile );
+    return true;
+}
+
+bool DataCache::save( const FileValidityStamp &dataFileStamp,
+                      const ColumnarDataTable &data,
+                      uint data_line_count ) const
+{
+    if( dataFileStamp.isNull() )
+        return false;
+
+    //the cache is written to a temporary file first, so a failed save does not leave a corrupt cache behind.
+    QFile cacheFile( getCachePath() + ".new" );
+    if( ! cacheFile.open( QFile::WriteOnly | QFile::Truncate ) ){
+        Application::instance()->logWarn( "DataCache::save(): could not open " + cacheFile.fileName() + " for writing." );
+        return false;
+    }
+
+    DataCacheHeader header;
+    std::memcpy( header.magic, DATA_CACHE_MAGIC, sizeof(DATA_CACHE_MAGIC) );
+    header.dataFileStamp = dataFileStamp;
+    header.nRows = data.getRowCount();
+    header.nColumns = data.getColumnCount();
+    header.dataLineCount = data_line_count;
+    bool ok = cacheFile.write( reinterpret_cast<const char*>( &header ), sizeof(header) ) == (qint64)sizeof(header);
+
+    //write the data column by column
+    std::vector<double> buffer;
+    for( quint64 iColumn = 0; ok && iColumn < header.nColumns; ++iColumn ){
+        DataColumnSpan column = data.getColumn( iColumn );
+        if( column.getDoubles() ){
+            qint64 nBytes = header.nRows * sizeof(double);
+            ok = cacheFile.write( reinterpret_cast<const char*>( column.getDoubles() ), nBytes ) == nBytes;
+        } else {
+            //columns stored in narrower types are widened to double in blocks
+            buffer.reserve( 65536 );
+            for( quint64 iRow = 0; ok && iRow < header.nRows; ){
+                buffer.clear();
+                for( ; iRow < header.nRows && buffer.size() < 65536; ++iRow )
+                    buffer.push_back( column[iRow] );
+                qint64 nBytes = buffer.size() * sizeof(double);
+                ok = cacheFile.write( reinterpret_cast<const char*>( buffer.data() ), nBytes ) == nBytes;
+            }
+        }
+    }
+    cacheFile.close();
+
+    if( ! ok ){
+        Application::instance()->logWarn( "DataCache::save(): failed to write " + cacheFile.fileName() + "." );
+        cacheFile.remove();
+        return false;
+    }
+
+    //replace the previous cache, if any.
+    remove();
+    return cacheFile.rename( getCachePath() );
+}
+
+void DataCache::remove() const
+{
+    QFile cacheFile( getCachePath() );
+    if( cacheFile.exists() )
+        cacheFile.remove();
+}
@@ -0,0 +1,46 @@
+#ifndef DATACACHE_H
+#define DATACACHE_H
+
+#include <QString>
+#include <vector>
+
+struct FileValidityStamp;
+class ColumnarDataTable;
+
+/** This is an auxiliary class used in DataFile::loadData() to keep a binary copy of the parsed data
+ * next to its GEO-EAS file (same path plus the .cache extension), so repeated loads of an unchanged
+ * file skip text parsing altogether.  The values are stored column by column, just like in memory
+ * (see ColumnarDataTable), along with the validity stamp of the GEO-EAS file at the time it was parsed.
+ */
+class DataCache
+{
+public:
+    explicit DataCache( const QString dataFilePath );
+
+    /** Returns the path to the cache file. */
+    QString getCachePath() const;
+
+    /** Loads the data in the cache file into the given data table if the cache exists and
+     * its stamp matches the given stamp of the GEO-EAS file.
+     * Returns false if the cache is absent, stale or unreadable, in which case the output parameters
+     * are left unchanged.
+     */
+    bool load( const FileValidityStamp& dataFileStamp,
+               ColumnarDataTable& data,
+               uint& data_line_count ) const;
+
+    /** (Re)writes the cache file with the given data table, tagging it with the given stamp of the
+     * GEO-EAS file the data were parsed from.  Returns false if the cache file could not be written.
+     */
+    bool save( const FileValidityStamp& dataFileStamp,
+               const ColumnarDataTable& data,
+               uint data_line_count ) const;
+
+    /** Deletes the cache file, if any. */
+    void remove() const;
+
+private:
+    QString _dataFilePath;
+};
+
+#endif // DATACACHE_H
@@ -0,0 +1,103 @@
+#include "datacolumnstatistics.h"
+#include "columnardatatable.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+/** Accumulates the statistics of the values returned by valueAt() in the range [0, size). */
+template< typename ValueAt >
+void accumulate( DataColumnStatistics& stats, size_t size, ValueAt valueAt,
+                 bool hasNoDataValue, float ndvLow, float ndvHigh )
+{
+    double min = stats.min;
+    double max = stats.max;
+    double minAbs = stats.minAbs;
+    double maxAbs = stats.maxAbs;
+    double shift = stats.shift;
+    double sum = 0.0;
+    double sumOfSquares = 0.0;
+    size_t count = 0;
+    for( size_t i = 0; i < size; ++i ){
+        double value = valueAt( i );
+        if( hasNoDataValue ){
+            float valueAsFloat = static_cast<float>( value );
+            if( valueAsFloat >= ndvLow && valueAsFloat <= ndvHigh )
+                continue;
+        }
+        if( count == 0 )
+            shift = value;
+        ++count;
+        double absValue = std::abs( value );
+        if( value < min ) min = value;
+        if( value > max ) max = value;
+        if( absValue < minAbs ) minAbs = absValue;
+        if( absValue > maxAbs ) maxAbs = absValue;
+        double shifted = value - shift;
+        sum += shifted;
+        sumOfSquares += shifted * shifted;
+    }
+    stats.min = min;
+    stats.max = max;
+    stats.minAbs = minAbs;
+    stats.maxAbs = maxAbs;
+    stats.shift = shift;
+    stats.sum = sum;
+    stats.sumOfSquares = sumOfSquares;
+    stats.count = count;
+}
+
+}
+
+DataColumnStatistics::DataColumnStatistics() :
+    isComputed( false ),
+    hasNoDataValue( false ),
+    noDataValue( 0.0 ),
+    count( 0 ),
+    min( std::numeric_limits<double>::max() ),
+    max( -std::numeric_limits<double>::max() ),
+    minAbs( std::numeric_limits<double>::max() ),
+    maxAbs( 0.0 ),
+    shift( 0.0 ),
+    sum( 0.0 ),
+    sumOfSquares( 0.0 )
+{
+}
+
+double DataColumnStatistics::getMean() const
+{
+    if( count == 0 )
+        return 0.0;
+    return shift + sum / count;
+}
+
+double DataColumnStatistics::getVariance() const
+{
+    if( count == 0 )
+        return std::numeric_limits<double>::quiet_NaN();
+    double meanOfShifted = sum / count;
+    //the variance cannot be negative, but round-off may make it slightly so.
+    return std::max( 0.0, sumOfSquares / count - meanOfShifted * meanOfShifted );
+}
+
+DataColumnStatistics DataColumnStatistics::compute(const DataColumnSpan &column, bool hasNoDataValue, double noDataValue)
+{
+    DataColumnStatistics stats;
+    stats.isComputed = true;
+    stats.hasNoDataValue = hasNoDataValue;
+    stats.noDataValue = noDataValue;
+
+    //the float values one ULP away from the no-data value delimit the values deemed as no-data.
+    float ndv = static_cast<float>( noDataValue );
+    float ndvLow = std::nextafter( ndv, -std::numeric_limits<float>::infinity() );
+    float ndvHigh = std::nextafter( ndv, std::numeric_limits<float>::infinity() );
+
+    if( const double* values = column.getDoubles() )
+        accumulate( stats, column.size, [values]( size_t i ){ return values[i]; },
+                    hasNoDataValue, ndvLow, ndvHigh );
+    else
+        accumulate( stats, column.size, [&column]( size_t i ){ return column[i]; },
+                    hasNoDataValue, ndvLow, ndvHigh );
+    return stats;
+}
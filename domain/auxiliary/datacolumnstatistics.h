@@ -0,0 +1,51 @@
+#ifndef DATACOLUMNSTATISTICS_H
+#define DATACOLUMNSTATISTICS_H
+
+#include <cstddef>
+
+struct DataColumnSpan;
+
+/**
+ * The summary statistics of the valid values (those which are not the no-data value) of a data column.
+ * They are computed in a single pass over the column by compute() and kept by DataFile so repeated calls
+ * to DataFile::min(), DataFile::max(), DataFile::mean(), etc. do not rescan the data.
+ * The sums are of the values minus the first valid value (shift), which keeps the variance accurate
+ * when the values are large relative to their spread (e.g. UTM coordinates).
+ */
+struct DataColumnStatistics
+{
+    DataColumnStatistics();
+
+    /** Whether the statistics were computed (see DataFile::invalidateColumnStatistics()). */
+    bool isComputed;
+    /** The no-data value setting used when the statistics were computed. */
+    bool hasNoDataValue;
+    double noDataValue;
+
+    /** Number of valid values. */
+    size_t count;
+    /** Extrema of the valid values.  If there are no valid values, min and minAbs are the largest double,
+     * max is the lowest double and maxAbs is zero. */
+    double min;
+    double max;
+    double minAbs;
+    double maxAbs;
+    double shift;
+    /** Sum of (value - shift). */
+    double sum;
+    /** Sum of (value - shift)^2. */
+    double sumOfSquares;
+
+    /** Returns the mean of the valid values or zero if there are none. */
+    double getMean() const;
+
+    /** Returns the population variance of the valid values (NaN if there are none). */
+    double getVariance() const;
+
+    /** Computes the statistics of the given column.  Values that equal the no-data value within one
+     * single precision ULP are excluded (same criterion as Util::almostEqual2sComplement( ndv, value, 1 )).
+     */
+    static DataColumnStatistics compute( const DataColumnSpan& column, bool hasNoDataValue, double noDataValue );
+};
+
+#endif // DATACOLUMNSTATISTICS_H
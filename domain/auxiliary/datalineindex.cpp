@@ -0,0 +1,128 @@
+#include "datalineindex.h"
+#include "../application.h"
+#include <QFile>
+#include <algorithm>
+#include <cstring>
+
+/** The fixed-size header at the beginning of the index files.
+ * The byte offsets of the indexed lines follow it (nEntries 64-bit unsigned integers). */
+struct DataLineIndexHeader {
+    char magic[8];
+    FileValidityStamp dataFileStamp;
+    quint64 dataLineCount;
+    quint64 linesPerEntry;
+    quint64 nEntries;
+};
+
+//Change the last char whenever the index layout changes, so old indexes get rebuilt.
+static const char DATA_LINE_INDEX_MAGIC[8] = { 'G', 'R', 'D', 'L', 'I', 'D', 'X', '1' };
+
+const quint64 DataLineIndex::LINES_PER_ENTRY;
+
+DataLineIndex::DataLineIndex(const QString dataFilePath) :
+    _dataFilePath( dataFilePath ),
+    _dataLineCount( 0 )
+{
+}
+
+QString DataLineIndex::getIndexPath() const
+{
+    return QString( _dataFilePath ).append(".lineindex");
+}
+
+bool DataLineIndex::load(const FileValidityStamp &dataFileStamp)
+{
+    if( dataFileStamp.isNull() )
+        return false;
+
+    QFile indexFile( getIndexPath() );
+    if( ! indexFile.exists() || ! indexFile.open( QFile::ReadOnly ) )
+        return false;
+
+    //read and check the header
+    DataLineIndexHeader header;
+    if( indexFile.read( reinterpret_cast<char*>( &header ), sizeof(header) ) != (qint64)sizeof(header) ||
+        std::memcmp( header.magic, DATA_LINE_INDEX_MAGIC, sizeof(DATA_LINE_INDEX_MAGIC) ) ||
+        header.dataFileStamp != dataFileStamp ||
+        header.linesPerEntry != LINES_PER_ENTRY )
+        return false;
+    if( static_cast<quint64>( indexFile.size() ) != sizeof(header) + header.nEntries * sizeof(quint64) ){
+        Application::instance()->logWarn( "DataLineIndex::load(): index file " + getIndexPath() + " is truncated.  Ignoring it." );
+        return false;
+    }
+
+    std::vector<quint64> offsets( header.nEntries );
+    qint64 nBytes = header.nEntries * sizeof(quint64);
+    if( nBytes && indexFile.read( reinterpret_cast<char*>( offsets.data() ), nBytes ) != nBytes )
+        return false;
+    //the offsets must point inside the data file
+    for( quint64 offset : offsets )
+        if( offset >= static_cast<quint64>( dataFileStamp.fileSize ) )
+            return false;
+
+    set( header.dataLineCount, std::move( offsets ) );
+    return true;
+}
+
+bool DataLineIndex::save(const FileValidityStamp &dataFileStamp) const
+{
+    if( dataFileStamp.isNull() )
+        return false;
+
+    //the index is written to a temporary file first, so a failed save does not leave a corrupt index behind.
+    QFile indexFile( getIndexPath() + ".new" );
+    if( ! indexFile.open( QFile::WriteOnly | QFile::Truncate ) ){
+        Application::instance()->logWarn( "DataLineIndex::save(): could not open " + indexFile.fileName() + " for writing." );
+        return false;
+    }
+
+    DataLineIndexHeader header;
+    std::memcpy( header.magic, DATA_LINE_INDEX_MAGIC, sizeof(DATA_LINE_INDEX_MAGIC) );
+    header.dataFileStamp = dataFileStamp;
+    header.dataLineCount = _dataLineCount;
+    header.linesPerEntry = LINES_PER_ENTRY;
+    header.nEntries = _offsets.size();
+    bool ok = indexFile.write( reinterpret_cast<const char*>( &header ), sizeof(header) ) == (qint64)sizeof(header);
+    qint64 nBytes = _offsets.size() * sizeof(quint64);
+    if( ok && nBytes )
+        ok = indexFile.write( reinterpret_cast<const char*>( _offsets.data() ), nBytes ) == nBytes;
+    indexFile.close();
+
+    if( ! ok ){
+        Application::instance()->logWarn( "DataLineIndex::save(): failed to write " + indexFile.fileName() + "." );
+        indexFile.remove();
+        return false;
+    }
+
+    //replace the previous index, if any.
+    remove();
+    return indexFile.rename( getIndexPath() );
+}
+
+void DataLineIndex::remove() const
+{
+    QFile indexFile( getIndexPath() );
+    if( indexFile.exists() )
+        indexFile.remove();
+}
+
+void DataLineIndex::set(quint64 dataLineCount, std::vector<quint64> &&offsets)
+{
+    _dataLineCount = dataLineCount;
+    _offsets = std::move( offsets );
+}
+
+quint64 DataLineIndex::getOffsetAtOrBefore(quint64 dataLine, quint64 &indexedDataLine) const
+{
+    quint64 entry = std::min<quint64>( dataLine / LINES_PER_ENTRY, _offsets.size() - 1 );
+    indexedDataLine = entry * LINES_PER_ENTRY;
+    return _offsets[entry];
+}
+
+qint64 DataLineIndex::getOffsetAfter(quint64 dataLine) const
+{
+    quint64 entry = dataLine / LINES_PER_ENTRY + 1;
+    if( entry >= _offsets.size() )
+        return -1;
+    return _offsets[entry];
+}
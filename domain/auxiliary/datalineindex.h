@@ -0,0 +1,66 @@
+#ifndef DATALINEINDEX_H
+#define DATALINEINDEX_H
+
+#include <QString>
+#include <vector>
+#include "filevaliditystamp.h"
+
+/** This is an auxiliary class used by DataLoader to seek data pages (e.g. a realization of a
+ * grid, see GridFile::setDataPageToRealization()) directly instead of scanning the file from the
+ * first line.  It is a sparse index of the GEO-EAS file: the byte offsets of every LINES_PER_ENTRY-th
+ * data line along with the total data line count.  It is kept next to its GEO-EAS file (same path
+ * plus the .lineindex extension) tagged with the validity stamp of the GEO-EAS file.
+ */
+class DataLineIndex
+{
+public:
+    /** The spacing between indexed data lines. */
+    static const quint64 LINES_PER_ENTRY = 4096;
+
+    explicit DataLineIndex( const QString dataFilePath );
+
+    /** Returns the path to the index file. */
+    QString getIndexPath() const;
+
+    /** Loads the index file if it exists and its stamp matches the given stamp of the GEO-EAS file.
+     * Returns false if the index is absent, stale or unreadable.
+     */
+    bool load( const FileValidityStamp& dataFileStamp );
+
+    /** (Re)writes the index file, tagging it with the given stamp of the GEO-EAS file.
+     * Returns false if the index file could not be written.
+     */
+    bool save( const FileValidityStamp& dataFileStamp ) const;
+
+    /** Deletes the index file, if any. */
+    void remove() const;
+
+    /** Sets the contents of the index.
+     * @param offsets The byte offsets of data lines 0, LINES_PER_ENTRY, 2*LINES_PER_ENTRY, etc.
+     */
+    void set( quint64 dataLineCount, std::vector<quint64>&& offsets );
+
+    /** Returns the number of data lines in the GEO-EAS file. */
+    quint64 getDataLineCount() const { return _dataLineCount; }
+
+    /** Returns whether there are no indexed lines (e.g. not loaded or the file has no data lines). */
+    bool isEmpty() const { return _offsets.empty(); }
+
+    /** Returns the byte offset of the nearest indexed data line at or before the given data line
+     * (first data line == 0).  The number of the indexed line is returned in indexedDataLine.
+     * The index must not be empty.
+     */
+    quint64 getOffsetAtOrBefore( quint64 dataLine, quint64& indexedDataLine ) const;
+
+    /** Returns the byte offset of the nearest indexed data line after the given data line
+     * or -1 if there is none (the rest of the file must be read).
+     */
+    qint64 getOffsetAfter( quint64 dataLine ) const;
+
+private:
+    QString _dataFilePath;
+    quint64 _dataLineCount;
+    std::vector<quint64> _offsets;
+};
+
+#endif // DATALINEINDEX_H
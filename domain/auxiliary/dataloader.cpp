@@ -1,17 +1,173 @@
 #include "dataloader.h"
 #include <QFileInfo>
 #include <QStringList>
-#include <QTextStream>
 #include <QThread>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <thread>
 #include "util.h"
 #include "../application.h"
+#include "columnardatatable.h"
+#include "datalineindex.h"
 
+/** A newline-aligned slice of the data section of a GEO-EAS file to be parsed by one thread. */
+struct DataChunk {
+    /** Address of the first char of the chunk. */
+    const char* begin;
+    /** Address after the last char of the chunk (the char after a line break or the end of file). */
+    const char* end;
+    /** Number of the file line (first file line == 0) at the beginning of the chunk.  Used in messages. */
+    ulong firstFileLine;
+    /** Sequential number of the first data line in the chunk (first data line in file == 0). */
+    ulong firstDataLine;
+    /** Number of data lines in the chunk. */
+    ulong nDataLines;
+    /** Index in the data array where the first data line of the chunk within the data page is to be stored. */
+    ulong firstDataRow;
+    /** Indexes in the data array of the data lines that failed to parse (they are removed after parsing). */
+    std::vector<size_t> badDataRows;
+    /** Messages collected during parsing, logged after all threads finish.  The boolean tells whether
+     * the message is an error message (information message otherwise). */
+    std::vector< std::pair< bool, QString > > messages;
+    /** Byte offsets of the data lines in the chunk to be indexed (see DataLineIndex), if the index is being built. */
+    std::vector< quint64 > indexedLineOffsets;
+};
+
+/** Returns the address of the line break ending the line starting at the given address or
+ * the end of buffer address if the line is the last one and is not terminated by a line break.
+ */
+inline const char* findLineEnd( const char* line, const char* bufferEnd ){
+    const char* lineEnd = static_cast<const char*>( std::memchr( line, '\n', bufferEnd - line ) );
+    if( ! lineEnd )
+        return bufferEnd;
+    return lineEnd;
+}
+
+/** ///////////// Counts the data lines of a chunk in a separate thread. /////////////////////////
+ * @param chunk The chunk whose nDataLines member will receive the count.
+ *//////////////////////////////////////////////////////////////////////////////////////////
+void countDataLinesThread( DataChunk* chunk ){
+    ulong count = 0;
+    const char* c = chunk->begin;
+    while( c < chunk->end ){
+        ++count;
+        c = static_cast<const char*>( std::memchr( c, '\n', chunk->end - c ) );
+        if( ! c ) //the last line of file may not be terminated by a line break
+            break;
+        ++c;
+    }
+    chunk->nDataLines = count;
+}
+
+/** ///////////// Parses the data lines of a chunk in a separate thread. /////////////////////////
+ * @param chunk The chunk to parse.  It must have its line counts and target position in the data array set.
+ * @param bufferEnd The address after the last char of the file contents.
+ * @param nVars The number of variables (values per data line) declared in the file header.
+ * @param firstDataLineToRead The first data line of the data page (inclusive).
+ * @param lastDataLineToRead The last data line of the data page (inclusive).
+ * @param data The data table, which must be already sized to hold all the data lines within the data page.
+ *             Values of the columns not loaded in it are skipped.
+ * @param bytesParsed The pointer to a shared counter of parsed bytes used to report progress.
+ * @param lineIndexBase If not null, the offsets from this address of the data lines to be indexed
+ *                      (see DataLineIndex) are collected in the chunk.
+ *//////////////////////////////////////////////////////////////////////////////////////////
+void parseDataLinesThread( DataChunk* chunk,
+                           const char* bufferEnd,
+                           int nVars,
+                           ulong firstDataLineToRead,
+                           ulong lastDataLineToRead,
+                           ColumnarDataTable* data,
+                           std::atomic<uint64_t>* bytesParsed,
+                           const char* lineIndexBase ){
+
+    //the values of a data line are scattered into the data columns
+    std::vector< double* > columns( nVars, nullptr );
+    for( int iVar = 0; iVar < nVars; ++iVar )
+        if( data->isColumnLoaded( iVar ) )
+            columns[iVar] = data->getColumnForWriting( iVar );
+
+    //the counter is updated at each 1MB parsed to avoid contention between the threads
+    const uint64_t progressStep = 1024 * 1024;
+    const char* lastProgressMark = chunk->begin;
+
+    ulong iDataRow = chunk->firstDataRow;
+    ulong iDataLine = chunk->firstDataLine;
+    const char* line = chunk->begin;
+    for( ulong iLine = 0; iLine < chunk->nDataLines; ++iLine, ++iDataLine ){
+        //the lines after the data page only need to be visited to build the line index
+        if( iDataLine > lastDataLineToRead && ! lineIndexBase )
+            break;
+
+        if( lineIndexBase && iDataLine % DataLineIndex::LINES_PER_ENTRY == 0 )
+            chunk->indexedLineOffsets.push_back( line - lineIndexBase );
+
+        const char* lineEnd = findLineEnd( line, bufferEnd );
+
+        if( lineEnd - lastProgressMark >= (long)progressStep ){
+            bytesParsed->fetch_add( lineEnd - lastProgressMark );
+            lastProgressMark = lineEnd;
+        }
+
+        //parse lines containing data (must be within the target interval)
+        if( iDataLine >= firstDataLineToRead && iDataLine <= lastDataLineToRead ){
+            //read each value along the line directly into the data table
+            int nValues = 0;
+            bool hasConversionError = false;
+            for( const char* c = line; c < lineEnd; ){
+                //skip separators
+                if( ! Util::isGEOEASNumberChar( *c ) ){
+                    ++c;
+                    continue;
+                }
+                //delimit the token
+                const char* token = c;
+                while( c < lineEnd && Util::isGEOEASNumberChar( *c ) )
+                    ++c;
+                //parse the double value (only the tokens of unloaded columns are counted)
+                if( nValues < nVars && columns[nValues] ){
+                    bool ok = true;
+                    columns[nValues][iDataRow] = Util::fastParseDouble( token, c, &ok );
+                    hasConversionError = hasConversionError || !ok;
+                }
+                ++nValues;
+            }
+            ulong fileLineNumber = chunk->firstFileLine + iLine;
+            if( nValues != nVars ){
+                chunk->badDataRows.push_back( iDataRow );
+                chunk->messages.push_back( { true, QString("ERROR: wrong number of values in line ").append(QString::number(fileLineNumber)) } );
+                chunk->messages.push_back( { true, QString("       expected: ").append(QString::number(nVars)).append(", found:").append(QString::number(nValues)) } );
+                QStringList valuesAsString;
+                Util::fastSplit( QString::fromLatin1( line, lineEnd - line ), valuesAsString );
+                for( QStringList::Iterator it = valuesAsString.begin(); it != valuesAsString.end(); ++it )
+                    chunk->messages.push_back( { false, *it } );
+            } else if( hasConversionError ){
+                QStringList valuesAsString;
+                Util::fastSplit( QString::fromLatin1( line, lineEnd - line ), valuesAsString );
+                for( QStringList::Iterator it = valuesAsString.begin(); it != valuesAsString.end(); ++it ){
+                    bool ok = true;
+                    (*it).toDouble( &ok );
+                    if( !ok ){
+                        chunk->messages.push_back( { true, QString("DataLoader::doLoad(): error in data file (line ").append(QString::number(fileLineNumber)).append("): cannot convert ").append( *it ).append(" to double.") } );
+                    }
+                }
+            }
+            ++iDataRow;
+        }
+
+        //move on to the next line
+        line = lineEnd + 1;
+    }
+
+    bytesParsed->fetch_add( chunk->end - lastProgressMark );
+}
 
 DataLoader::DataLoader(QFile &file,
-                       std::vector<std::vector<double> > &data,
+                       ColumnarDataTable &data,
                        uint &data_line_count,
                        ulong firstDataLineToRead,
                        ulong lastDataLineToRead,
+                       const std::vector<bool> &columnsToLoad,
                        QObject *parent) :
     QObject(parent),
     _file(file),
@@ -19,108 +175,209 @@ DataLoader::DataLoader(QFile &file,
     _data_line_count(data_line_count),
     _finished(false),
     _firstDataLineToRead( firstDataLineToRead ),
-    _lastDataLineToRead( lastDataLineToRead )
+    _lastDataLineToRead( lastDataLineToRead ),
+    _columnsToLoad( columnsToLoad )
 {
 }
 
 void DataLoader::doLoad() { /* do what you need and emit progress signal */
-	//QStringList list;
     int n_vars = 0;
     int var_count = 0;
-    QTextStream in(&_file);
-    long bytesReadSofar = 0;
-	QStringList valuesAsString;
 
 	//Get data file size in bytes.
 	QFileInfo fileInfo( _file );
 	uint64_t fileSize = fileInfo.size();
 
-	uint iDataLineParsed = 0;
+	//Map the file into memory, so values are parsed directly from the OS's file cache
+	//without copying lines into QStrings and tokens into QStringLists.
+	const char* buffer = nullptr;
+	uchar* mappedFile = nullptr;
+	QByteArray fallbackBuffer;
+	if( fileSize > 0 )
+		mappedFile = _file.map( 0, fileSize );
+	if( mappedFile )
+		buffer = reinterpret_cast<const char*>( mappedFile );
+	else {
+		//mapping may fail in some file systems, then read the entire file as a fallback.
+		if( fileSize > 0 )
+			Application::instance()->logWarn( "DataLoader::doLoad(): could not memory-map " + _file.fileName() +
+											  ": " + _file.errorString() + ".  Reading it into memory instead." );
+		fallbackBuffer = _file.readAll();
+		buffer = fallbackBuffer.constData();
+		fileSize = fallbackBuffer.size();
+	}
+	const char* const bufferEnd = buffer + fileSize;
 
-	uint nPushesBack = 0;
+	//parse the header to find where the data section begins
+	const char* dataSection = buffer;
+	ulong nHeaderLines = 0;
+	for (int i = 0; dataSection < bufferEnd; ++i)
+	{
+	   //TODO: second line may contain other information in grid files, so it will fail for such cases.
+	   if( i > 1 && var_count == n_vars ) //the first data line
+		   break;
+	   const char* lineEnd = findLineEnd( dataSection, bufferEnd );
+	   if( i == 0 ){} //first line is ignored
+	   else if( i == 1 ){ //second line is the number of variables
+		   n_vars = Util::getFirstNumber( QString::fromLatin1( dataSection, lineEnd - dataSection ) );
+	   } else { //the variables names
+		   ++var_count;
+	   }
+	   dataSection = lineEnd + 1;
+	   ++nHeaderLines;
+	}
+	if( dataSection > bufferEnd )
+		dataSection = bufferEnd;
 
-	uint nPopsBack = 0;
+	//Paged loads (e.g. a realization of a grid) use the line index of the file, if any, to
+	//scan only the lines in and around the page.  Otherwise, the whole data section is scanned and
+	//the index is built for the next paged loads.
+	const char* scanBegin = dataSection;
+	const char* scanEnd = bufferEnd;
+	ulong firstScannedDataLine = 0;
+	bool isPaged = _firstDataLineToRead > 0 ||
+				   _lastDataLineToRead < static_cast<ulong>( std::numeric_limits<long>::max() );
+	FileValidityStamp stamp;
+	DataLineIndex lineIndex( _file.fileName() );
+	bool useLineIndex = false;
+	if( isPaged && mappedFile ){
+		stamp = FileValidityStamp::fromFile( _file.fileName() );
+		useLineIndex = lineIndex.load( stamp ) && ! lineIndex.isEmpty() &&
+					   stamp.fileSize == static_cast<qint64>( fileSize );
+	}
+	if( useLineIndex ){
+		quint64 indexedDataLine;
+		scanBegin = std::max( buffer + lineIndex.getOffsetAtOrBefore( _firstDataLineToRead, indexedDataLine ), dataSection );
+		firstScannedDataLine = indexedDataLine;
+		qint64 endOffset = lineIndex.getOffsetAfter( _lastDataLineToRead );
+		if( endOffset >= 0 )
+			scanEnd = std::max( buffer + endOffset, scanBegin );
+	}
+	bool buildLineIndex = isPaged && mappedFile && ! useLineIndex;
 
-	for (int i = 0; !in.atEnd(); ++i)
-    {
-       //read file line by line
-       QString line = in.readLine();
+	//split the scanned section into newline-aligned chunks, one per thread.
+	//small sections are not worth the threading overhead.
+	uint64_t scanSize = scanEnd - scanBegin;
+	unsigned int nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+	if( scanSize < 1024 * 1024 )
+		nThreads = 1;
+	std::vector< DataChunk > chunks( nThreads );
+	{
+		const char* chunkBegin = scanBegin;
+		for( unsigned int iThread = 0; iThread < nThreads; ++iThread ){
+			DataChunk& chunk = chunks[iThread];
+			chunk.begin = chunkBegin;
+			if( iThread == nThreads - 1 )
+				chunk.end = scanEnd;
+			else {
+				const char* target = scanBegin + scanSize / nThreads * ( iThread + 1 );
+				if( target < chunkBegin )
+					target = chunkBegin;
+				chunk.end = std::min( findLineEnd( target, scanEnd ) + 1, scanEnd );
+			}
+			chunkBegin = chunk.end;
+		}
+	}
 
-	   //Clear the list with the tokenized data values as string
-	   valuesAsString.clear();
+	//count the data lines in each chunk in parallel
+	if( nThreads == 1 )
+		countDataLinesThread( &chunks[0] );
+	else {
+		std::thread threads[nThreads];
+		for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+			threads[iThread] = std::thread( countDataLinesThread, &chunks[iThread] );
+		for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+			threads[iThread].join();
+	}
 
-	   //updates the progress
-	   bytesReadSofar += line.size() + 1; //account for line break char (in Windows may have 2, though.)
+	//with the line counts, we can determine where in the data array each chunk stores its data lines
+	//that fall within the data page.  This allows the threads to fill the data array directly in file order.
+	ulong nScannedDataLines = 0;
+	ulong nDataLinesInPage = 0;
+	for( DataChunk& chunk : chunks ){
+		chunk.firstDataLine = firstScannedDataLine + nScannedDataLines;
+		chunk.firstFileLine = nHeaderLines + chunk.firstDataLine;
+		chunk.firstDataRow = nDataLinesInPage;
+		nScannedDataLines += chunk.nDataLines;
+		if( chunk.nDataLines > 0 ){
+			ulong pageBegin = std::max( chunk.firstDataLine, _firstDataLineToRead );
+			ulong pageEnd = std::min( chunk.firstDataLine + chunk.nDataLines - 1, _lastDataLineToRead );
+			if( pageEnd >= pageBegin )
+				nDataLinesInPage += pageEnd - pageBegin + 1;
+		}
+	}
 
-	   if( ! ( i % 100 ) ){ //update progress for each 100 lines to not impact performance much
-		   // allows tracking progress of a file up to about 400GB
-		   emit progress( (int)(bytesReadSofar / 100) );
-	   }
+	//allocate the entire data table at once
+	std::vector<bool> loadedColumns( n_vars );
+	for( int iVar = 0; iVar < n_vars; ++iVar )
+		loadedColumns[iVar] = _columnsToLoad.empty() ||
+							  ( iVar < (int)_columnsToLoad.size() && _columnsToLoad[iVar] );
+	_data = ColumnarDataTable( nDataLinesInPage, loadedColumns );
 
-	   //TODO: second line may contain other information in grid files, so it will fail for such cases.
-	   if( i == 0 ){} //first line is ignored
-	   else if( i == 1 ){ //second line is the number of variables
-		   n_vars = Util::getFirstNumber( line );
-	   } else if ( i > 1 && var_count < n_vars ){ //the variables names
-		   //list << line;
-		   ++var_count;
-	   } else if( _data_line_count >= _firstDataLineToRead &&
-				  _data_line_count <= _lastDataLineToRead ) { //parse lines containing data (must be within the target interval)
-		   //read line from the GSLib data file
-		   Util::fastSplit( line, valuesAsString );
-		   //if we are at the first data line to read...
-		   if( _data_line_count == _firstDataLineToRead ){
-			   //...estimate the number of lines in the file
-			   uint nLinesExpectation = fileSize / ( line.size() + 2 ) + 200; //+2 -> line breaks in Windows; +200 -> make room for possible line length variation
-			   //the number of data lines to store should be smaller or equal than the file line window
-			   if( nLinesExpectation > ( _lastDataLineToRead - _firstDataLineToRead ) )
-				   nLinesExpectation =  _lastDataLineToRead - _firstDataLineToRead;
-			   //now we can reserve capacity in the _data array to avoid minimize push_back calls and vector re-allocations/copies
-			   _data = std::vector<std::vector<double> >( 1.1 * nLinesExpectation, std::vector<double>( n_vars, -424242.0 ) );
-		   }
-		   if( valuesAsString.size() != n_vars ){
-			   Application::instance()->logError( QString("ERROR: wrong number of values in line ").append(QString::number(i)) );
-			   Application::instance()->logError( QString("       expected: ").append(QString::number(n_vars)).append(", found:").append(QString::number(valuesAsString.size())) );
-			   for( QStringList::Iterator it = valuesAsString.begin(); it != valuesAsString.end(); ++it ){
-				   Application::instance()->logInfo((*it));
-			   }
-		   } else {
-			   //read each value along the line
-			   QStringList::Iterator it = valuesAsString.begin();
-			   for( int j = 0; it != valuesAsString.end(); ++it, ++j ){
-				   //parse the double value
-				   bool ok = true;
-				   double value = (*it).toDouble( &ok );
-				   if( !ok ){
-					   Application::instance()->logError( QString("DataLoader::doLoad(): error in data file (line ").append(QString::number(i)).append("): cannot convert ").append( *it ).append(" to double.") );
-				   }
-				   //making sure there is room for the new data.
-				   if( iDataLineParsed == _data.size() ){
-					   ++nPushesBack;
-					   _data.push_back( std::vector<double>( n_vars, -424242.0 ) );
-				   }
-				   //store the value in the data array.
-				   _data[iDataLineParsed][j] = value;
-			   }
-			   ++_data_line_count;
-			   ++iDataLineParsed;
-		   }
-	   } else { //if the data line is not within the target interval (window in data file)
-		   ++_data_line_count; //just count it as parsed.
-	   }
-    }
+	//with the line index, the total line count is known without scanning the whole file
+	ulong nDataLinesInFile = useLineIndex ? lineIndex.getDataLineCount() : nScannedDataLines;
 
-	//remove possibly excess of data in pre-allocation of _data
-	while( iDataLineParsed < _data.size() ){
-		++nPopsBack;
-		_data.pop_back();
+	//parse the chunks in parallel
+	std::atomic<uint64_t> bytesParsed( 0 );
+	const char* lineIndexBase = buildLineIndex ? buffer : nullptr;
+	if( nThreads == 1 )
+		parseDataLinesThread( &chunks[0], bufferEnd, n_vars, _firstDataLineToRead, _lastDataLineToRead, &_data, &bytesParsed, lineIndexBase );
+	else {
+		std::thread threads[nThreads];
+		for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+			threads[iThread] = std::thread( parseDataLinesThread,
+											&chunks[iThread],
+											bufferEnd,
+											n_vars,
+											_firstDataLineToRead,
+											_lastDataLineToRead,
+											&_data,
+											&bytesParsed,
+											lineIndexBase );
+		//updates the progress while the threads run
+		while( bytesParsed.load() < scanSize ){
+			QThread::msleep( 20 );
+			// allows tracking progress of a file up to about 400GB
+			emit progress( (int)( ( scanBegin - buffer + bytesParsed.load() ) / 100 ) );
+		}
+		for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+			threads[iThread].join();
 	}
 
-	if( nPushesBack )
-		Application::instance()->logInfo( QString("DataLoader::doLoad(): data array adjustment resulted in ").append(QString::number(nPushesBack)).append(" push(es)-back.") );
+	if( mappedFile )
+		_file.unmap( mappedFile );
+
+	//save the line index for the next paged loads
+	if( buildLineIndex ){
+		std::vector< quint64 > offsets;
+		for( DataChunk& chunk : chunks )
+			offsets.insert( offsets.end(), chunk.indexedLineOffsets.begin(), chunk.indexedLineOffsets.end() );
+		lineIndex.set( nDataLinesInFile, std::move( offsets ) );
+		if( ! lineIndex.save( stamp ) )
+			Application::instance()->logWarn( "DataLoader::doLoad(): could not save the line index of " + _file.fileName() + "." );
+	}
+
+	//log the messages in file order and remove the data lines that failed to parse
+	ulong nBadDataLines = 0;
+	for( DataChunk& chunk : chunks ){
+		for( const std::pair< bool, QString >& message : chunk.messages )
+			if( message.first )
+				Application::instance()->logError( message.second );
+			else
+				Application::instance()->logInfo( message.second );
+		nBadDataLines += chunk.badDataRows.size();
+	}
+	if( nBadDataLines ){
+		std::vector<size_t> badDataRows;
+		badDataRows.reserve( nBadDataLines );
+		for( DataChunk& chunk : chunks )
+			badDataRows.insert( badDataRows.end(), chunk.badDataRows.begin(), chunk.badDataRows.end() );
+		_data.removeRows( badDataRows );
+		Application::instance()->logInfo( QString("DataLoader::doLoad(): ").append(QString::number(nBadDataLines)).append(" data line(s) could not be parsed and were discarded.") );
+	}
 
-	if( nPopsBack )
-		Application::instance()->logInfo( QString("DataLoader::doLoad(): data array adjustment resulted in ").append(QString::number(nPopsBack)).append(" pop(s)-back.") );
+	//data lines that failed to parse are not counted
+	_data_line_count = nDataLinesInFile - nBadDataLines;
 
     _finished = true;
 }
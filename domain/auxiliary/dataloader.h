@@ -3,9 +3,18 @@
 
 #include <QObject>
 #include <QFile>
+#include <vector>
+
+class ColumnarDataTable;
 
 /** This is an auxiliary class used in DataFile::loadData() to enable the progress dialog.
  * The file is read in a separate thread, so the progress bar updates.
+ * The file is memory-mapped and the values are parsed directly from its bytes into the data array.
+ * The data section is split into newline-aligned chunks which are parsed concurrently, each
+ * thread filling its own range of rows of the data table, so the rows end up in file order.
+ * Paged loads seek the data page with the line index of the file (see DataLineIndex), which is built
+ * in the first paged load.
+ * Optionally, only some columns are parsed and stored (see DataFile::loadData(const std::set<uint>&)).
  */
 class DataLoader : public QObject
 {
@@ -13,10 +22,11 @@ class DataLoader : public QObject
 
 public:
     explicit DataLoader(QFile &file,
-                        std::vector< std::vector<double> > &data,
+                        ColumnarDataTable &data,
                         uint &data_line_count,
                         ulong firstDataLineToRead,
                         ulong lastDataLineToRead,
+                        const std::vector<bool>& columnsToLoad = std::vector<bool>(),
                         QObject *parent = 0);
 
     bool isFinished(){ return _finished; }
@@ -28,11 +38,13 @@ signals:
 
 private:
     QFile &_file;
-    std::vector< std::vector<double> > &_data;
+    ColumnarDataTable &_data;
     uint &_data_line_count;
     bool _finished;
     ulong _firstDataLineToRead;
     ulong _lastDataLineToRead;
+    /** Flags the columns to parse and store.  Empty means all columns. */
+    std::vector<bool> _columnsToLoad;
 };
 
 #endif // DATALOADER_H
@@ -1,36 +1,87 @@
 #include "datasaver.h"
-#include <QTextStream>
-#include <sstream>    // std::stringstream
-#include <iomanip>      // std::setprecision
+#include "columnardatatable.h"
+#include "util.h"
+#include <QFile>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
 
-DataSaver::DataSaver(std::vector<std::vector<double> > &data, std::ostringstream &out, QObject *parent) :
+//the number of data lines formatted by each thread before the result is written to the file.
+static const size_t ROWS_PER_BLOCK = 16384;
+
+//the maximum length of a formatted value plus its separator (see Util::fastFormatDouble()).
+static const size_t MAX_CHARS_PER_VALUE = 33;
+
+DataSaver::DataSaver(const ColumnarDataTable &data, QFile &outputFile, QObject *parent) :
     QObject(parent),
     _finished( false ),
+    _failed( false ),
     _data(data),
-    _out(out)
+    _outputFile(outputFile)
 {
 }
 
 void DataSaver::doSave()
 {
-    int linesSavedSoFar = 0;
-    //for each data line
-    std::vector< std::vector<double> >::const_iterator itDataLine = _data.cbegin();
-    for(; itDataLine != _data.cend(); ++itDataLine){
-        //updates the progress
-        if( ! ( linesSavedSoFar % 1000 ) ){ //update progress for each 1000 lines to not impact performance much
-            emit progress( (int)(linesSavedSoFar) );
+    size_t nRows = _data.getRowCount();
+    unsigned int nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+    std::vector< std::string > blocks( nThreads );
+
+    //each round formats up to nThreads blocks of lines in parallel and writes them in file order.
+    for( size_t firstRow = 0; firstRow < nRows && ! _failed; firstRow += ROWS_PER_BLOCK * nThreads ){
+        emit progress( (int)firstRow );
+        std::vector< std::thread > threads;
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread ){
+            size_t blockFirstRow = std::min( firstRow + iThread * ROWS_PER_BLOCK, nRows );
+            size_t blockLastRow = std::min( blockFirstRow + ROWS_PER_BLOCK, nRows );
+            if( iThread == 0 || blockFirstRow == blockLastRow )
+                continue; //the first block is formatted by this thread, below.
+            threads.push_back( std::thread( formatRows, std::cref( _data ), blockFirstRow, blockLastRow, &blocks[iThread] ) );
         }
-        std::vector<double>::const_iterator itDataColumn = (*itDataLine).cbegin();
-        //output the value in the first column
-        _out << *itDataColumn;
-        ++itDataColumn;
-        //for each data column, from 2nd column and on.
-        for(; itDataColumn != (*itDataLine).cend(); ++itDataColumn){
-            _out << '\t' << *itDataColumn;
+        formatRows( _data, firstRow, std::min( firstRow + ROWS_PER_BLOCK, nRows ), &blocks[0] );
+        for( std::thread& thread : threads )
+            thread.join();
+
+        for( unsigned int iThread = 0; iThread < nThreads && ! _failed; ++iThread ){
+            std::string& block = blocks[iThread];
+            if( block.empty() )
+                continue;
+            if( _outputFile.write( block.data(), block.size() ) != (qint64)block.size() )
+                _failed = true;
+            block.clear();
         }
-        _out << std::endl; //mind the difference between QTextStream's endl and std::endl
-        ++linesSavedSoFar;
     }
+    emit progress( (int)nRows );
     _finished = true;
 }
+
+void DataSaver::formatRows(const ColumnarDataTable &data, size_t firstRow, size_t lastRow, std::string *buffer)
+{
+    size_t nColumns = data.getColumnCount();
+    std::vector< DataColumnSpan > columns;
+    std::vector< bool > isSinglePrecision;
+    for( size_t iColumn = 0; iColumn < nColumns; ++iColumn ){
+        columns.push_back( data.getColumn( iColumn ) );
+        isSinglePrecision.push_back( columns.back().type == DataColumnType::FLOAT32 );
+    }
+
+    //make room for the longest possible text, then trim the buffer to the actual length.
+    buffer->resize( ( lastRow - firstRow ) * ( nColumns * MAX_CHARS_PER_VALUE + 1 ) );
+    char* begin = &(*buffer)[0];
+    char* position = begin;
+    for( size_t iRow = firstRow; iRow < lastRow; ++iRow ){
+        for( size_t iColumn = 0; iColumn < nColumns; ++iColumn ){
+            if( iColumn )
+                *position++ = '\t';
+            //single precision values are written with as many digits as needed to restore the float
+            //(e.g. 0.1 instead of 0.100000001490116)
+            if( isSinglePrecision[iColumn] )
+                position = Util::fastFormatFloat( static_cast<float>( columns[iColumn][iRow] ), position );
+            else
+                position = Util::fastFormatDouble( columns[iColumn][iRow], position );
+        }
+        *position++ = '\n';
+    }
+    buffer->resize( position - begin );
+}
@@ -2,9 +2,15 @@
 #define DATASAVER_H
 
 #include <QObject>
+#include <string>
+
+class ColumnarDataTable;
+class QFile;
 
 /** This is an auxiliary class used in DataFile::writeToFS() to enable the progress dialog.
  * The file is saved in a separate thread, so the progress bar updates.
+ * Blocks of data lines are formatted in parallel into memory buffers (see Util::fastFormatDouble())
+ * and each buffer is written to the file in a single call.
  */
 class DataSaver : public QObject
 {
@@ -12,12 +18,15 @@ class DataSaver : public QObject
 
 public:
 
-    explicit DataSaver(std::vector< std::vector<double> >& data,
-                       std::ostringstream& out,
+    explicit DataSaver(const ColumnarDataTable& data,
+                       QFile& outputFile,
                        QObject *parent = nullptr);
 
     bool isFinished(){ return _finished; }
 
+    /** Returns whether writing to the output file failed (e.g. disk full). */
+    bool hasFailed(){ return _failed; }
+
 public slots:
     void doSave( );
 signals:
@@ -25,9 +34,12 @@ signals:
 
 private:
     bool _finished;
-    std::vector< std::vector<double> >& _data;
-    std::ostringstream& _out;
+    bool _failed;
+    const ColumnarDataTable& _data;
+    QFile& _outputFile;
 
+    /** Formats the data lines in [firstRow, lastRow) as text into the given buffer. */
+    static void formatRows( const ColumnarDataTable& data, size_t firstRow, size_t lastRow, std::string* buffer );
 };
 
 #endif // DATASAVER_H
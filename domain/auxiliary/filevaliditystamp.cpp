@@ -0,0 +1,62 @@
+#include "filevaliditystamp.h"
+#include "util.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+
+FileValidityStamp::FileValidityStamp() :
+    fileSize( -1 ),
+    lastModified( 0 ),
+    headerHash( 0 )
+{
+}
+
+FileValidityStamp FileValidityStamp::fromFile(const QString path)
+{
+    FileValidityStamp stamp;
+
+    QFile file( path );
+    if( ! file.open( QFile::ReadOnly ) )
+        return stamp;
+
+    //hash the header lines: the title, the variable count and the variable names.
+    quint64 hash = 14695981039346656037ULL; //FNV-1a offset basis
+    int n_vars = 0;
+    for( int i = 0; ! file.atEnd() && ( i < 2 || i < n_vars + 2 ); ++i ){
+        QByteArray line = file.readLine();
+        if( i == 1 )
+            n_vars = Util::getFirstNumber( QString::fromLatin1( line ) );
+        for( char c : line ){
+            hash ^= static_cast<unsigned char>( c );
+            hash *= 1099511628211ULL; //FNV-1a prime
+        }
+    }
+    file.close();
+
+    QFileInfo info( path );
+    stamp.fileSize = info.size();
+    stamp.lastModified = info.lastModified().toMSecsSinceEpoch();
+    stamp.headerHash = hash;
+    return stamp;
+}
+
+FileValidityStamp FileValidityStamp::fromBinaryFile(const QString path)
+{
+    FileValidityStamp stamp;
+
+    QFileInfo info( path );
+    if( ! info.exists() )
+        return stamp;
+
+    stamp.fileSize = info.size();
+    stamp.lastModified = info.lastModified().toMSecsSinceEpoch();
+    stamp.headerHash = 0;
+    return stamp;
+}
+
+bool FileValidityStamp::operator==(const FileValidityStamp &other) const
+{
+    return fileSize == other.fileSize &&
+           lastModified == other.lastModified &&
+           headerHash == other.headerHash;
+}
@@ -0,0 +1,46 @@
+#ifndef FILEVALIDITYSTAMP_H
+#define FILEVALIDITYSTAMP_H
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * The FileValidityStamp class identifies a given state of a data file by its size, its
+ * last modification time and a hash of its header (title, variable count and variable names).
+ * It is stored in the auxiliary files derived from a data file (e.g. binary caches and indexes)
+ * so they can be checked against the data file for staleness.
+ * This is a plain-old-data type, so it can be written to and read from binary files as is.
+ */
+struct FileValidityStamp
+{
+    /** Makes a null stamp (does not match any file). */
+    FileValidityStamp();
+
+    /** Computes the stamp of the GEO-EAS file in the given path.
+     * Returns a null stamp if the file does not exist or cannot be read.
+     */
+    static FileValidityStamp fromFile( const QString path );
+
+    /** Computes the stamp of a file without a GEO-EAS header (e.g. a binary GeoGrid mesh file), which is
+     * given by its size and last modification time only (the header hash is zero).
+     * Returns a null stamp if the file does not exist.
+     */
+    static FileValidityStamp fromBinaryFile( const QString path );
+
+    /** Returns whether this stamp does not refer to any file. */
+    bool isNull() const { return fileSize < 0; }
+
+    bool operator==( const FileValidityStamp& other ) const;
+    bool operator!=( const FileValidityStamp& other ) const { return !( *this == other ); }
+
+    /** The file size in bytes.  A negative value means a null stamp. */
+    qint64 fileSize;
+
+    /** The file's last modification date/time in milliseconds since the Unix epoch. */
+    qint64 lastModified;
+
+    /** The 64-bit FNV-1a hash of the header lines of the file. */
+    quint64 headerHash;
+};
+
+#endif // FILEVALIDITYSTAMP_H
@@ -0,0 +1,125 @@
+#include "geogridcelllocator.h"
+#include "geogridmesh.h"
+#include "geometry/vector3d.h"
+
+namespace {
+
+/** The vertexes of the six faces of a cell (see GeoGridMesh), in the order of GeoGrid::getFaces(). */
+const int FACE_VERTEXES[6][4] = { { 0, 1, 2, 3 },   // K-
+                                  { 4, 7, 6, 5 },   // K+
+                                  { 0, 3, 7, 4 },   // I-
+                                  { 1, 5, 6, 2 },   // I+
+                                  { 0, 4, 5, 1 },   // J-
+                                  { 3, 2, 6, 7 } }; // J+
+
+/** The IJK steps to the neighbor across each face. */
+const int FACE_STEPS[6][3] = { { 0, 0, -1 }, { 0, 0, 1 },
+                               { -1, 0, 0 }, { 1, 0, 0 },
+                               { 0, -1, 0 }, { 0, 1, 0 } };
+
+/** The same tolerance of Util::isInside(), so locations on the faces are inside. */
+const double INSIDE_BOUND = -1e-15;
+
+}
+
+GeoGridCellLocator::GeoGridCellLocator( const GeoGridMesh &mesh, uint nI, uint nJ, uint nK ) :
+    m_mesh( mesh ),
+    m_nI( nI ), m_nJ( nJ ), m_nK( nK ),
+    m_normals( static_cast<size_t>( nI ) * nJ * nK * 18 )
+{
+    size_t nCells = static_cast<size_t>( nI ) * nJ * nK;
+    for( size_t iCell = 0; iCell < nCells; ++iCell ){
+        const uint32_t* vIds = m_mesh.getCellVertexIds( iCell );
+        for( int face = 0; face < 6; ++face ){
+            //the same computation of Face3D::normal(), so the tests give the same results.
+            const int* fv = FACE_VERTEXES[face];
+            Vertex3D v0{ m_mesh.getX( vIds[fv[0]] ), m_mesh.getY( vIds[fv[0]] ), m_mesh.getZ( vIds[fv[0]] ) };
+            Vertex3D v1{ m_mesh.getX( vIds[fv[1]] ), m_mesh.getY( vIds[fv[1]] ), m_mesh.getZ( vIds[fv[1]] ) };
+            Vertex3D v2{ m_mesh.getX( vIds[fv[2]] ), m_mesh.getY( vIds[fv[2]] ), m_mesh.getZ( vIds[fv[2]] ) };
+            Vector3D n = ( v2 - v0 ).cross( v1 - v0 );
+            double d = n.norm();
+            double* normal = &m_normals[ iCell * 18 + face * 3 ];
+            normal[0] = n.x / d;
+            normal[1] = n.y / d;
+            normal[2] = n.z / d;
+        }
+    }
+}
+
+double GeoGridCellLocator::getSide( uint cellIndex, int face, double x, double y, double z ) const
+{
+    uint32_t vId = m_mesh.getCellVertexIds( cellIndex )[ FACE_VERTEXES[face][0] ];
+    const double* normal = &m_normals[ static_cast<size_t>( cellIndex ) * 18 + face * 3 ];
+    Vector3D p2f = Vertex3D{ m_mesh.getX( vId ), m_mesh.getY( vId ), m_mesh.getZ( vId ) } - Vertex3D{ x, y, z };
+    double d = p2f.dot( Vector3D{ normal[0], normal[1], normal[2] } );
+    return d / p2f.norm();
+}
+
+bool GeoGridCellLocator::isInside( uint cellIndex, double x, double y, double z ) const
+{
+    for( int face = 0; face < 6; ++face )
+        if( getSide( cellIndex, face, x, y, z ) < INSIDE_BOUND )
+            return false;
+    return true;
+}
+
+bool GeoGridCellLocator::walk( uint startCellIndex, double x, double y, double z, uint maxSteps, uint &cellIndex ) const
+{
+    int i = startCellIndex % m_nI;
+    int j = ( startCellIndex / m_nI ) % m_nJ;
+    int k = startCellIndex / ( m_nI * m_nJ );
+    uint current = startCellIndex;
+    uint previous = getCellCount();
+    for( uint step = 0; step <= maxSteps; ++step ){
+        //find the face the location is farthest beyond
+        int worstFace = -1;
+        double worstSide = INSIDE_BOUND;
+        for( int face = 0; face < 6; ++face ){
+            double side = getSide( current, face, x, y, z );
+            if( side < worstSide ){
+                worstSide = side;
+                worstFace = face;
+            }
+        }
+        if( worstFace < 0 ){
+            cellIndex = current;
+            return true;
+        }
+        //step to the neighbor across that face, if any.
+        i += FACE_STEPS[worstFace][0];
+        j += FACE_STEPS[worstFace][1];
+        k += FACE_STEPS[worstFace][2];
+        if( i < 0 || j < 0 || k < 0 || i >= static_cast<int>( m_nI ) ||
+                                       j >= static_cast<int>( m_nJ ) ||
+                                       k >= static_cast<int>( m_nK ) )
+            return false;
+        uint next = k * m_nJ * m_nI + j * m_nI + i;
+        //going back and forth between two cells means the walk is stuck (e.g. in a fold of the mesh).
+        if( next == previous )
+            return false;
+        previous = current;
+        current = next;
+    }
+    return false;
+}
+
+void GeoGridCellLocator::getLocalUVW( uint cellIndex, double x, double y, double z,
+                                      double &u, double &v, double &w ) const
+{
+    //the distances between the location and the planes of the faces, computed as in Face3D::distance().
+    Vertex3D point{ x, y, z };
+    const uint32_t* vIds = m_mesh.getCellVertexIds( cellIndex );
+    double distances[6];
+    for( int face = 0; face < 6; ++face ){
+        uint32_t vId = vIds[ FACE_VERTEXES[face][0] ];
+        const double* normal = &m_normals[ static_cast<size_t>( cellIndex ) * 18 + face * 3 ];
+        Vector3D n{ normal[0], normal[1], normal[2] };
+        double t = n.dot( Vertex3D{ m_mesh.getX( vId ), m_mesh.getY( vId ), m_mesh.getZ( vId ) } ) - n.dot( point );
+        Vertex3D p0 = point + t * n;
+        distances[face] = ( point - p0 ).norm();
+    }
+    //faces 2 and 3 are along I (U), faces 4 and 5 are along J (V) and faces 0 and 1 are along K (W).
+    u = distances[2] / ( distances[2] + distances[3] );
+    v = distances[4] / ( distances[4] + distances[5] );
+    w = distances[0] / ( distances[0] + distances[1] );
+}
@@ -0,0 +1,53 @@
+#ifndef GEOGRIDCELLLOCATOR_H
+#define GEOGRIDCELLLOCATOR_H
+
+#include <QtGlobal>
+#include <vector>
+
+class GeoGridMesh;
+
+/**
+ * The GeoGridCellLocator class finds the GeoGrid cells that contain given locations.  The outward normals of
+ * the six faces of every cell are computed once and kept in a flat array, so testing whether a location is inside
+ * a cell does not build Face3D objects.  Since the cells are structured, a location can be found by walking from
+ * a nearby cell (e.g. the one of the previous location) to its neighbors across the faces the location is beyond.
+ * The tests give the same results as Util::isInside() with the faces of GeoGrid::getFaces().
+ * The locator refers to the mesh, so it must be rebuilt if the mesh changes.
+ */
+class GeoGridCellLocator
+{
+public:
+    GeoGridCellLocator( const GeoGridMesh& mesh, uint nI, uint nJ, uint nK );
+
+    /** Returns whether the given location is inside the given cell (boundaries included). */
+    bool isInside( uint cellIndex, double x, double y, double z ) const;
+
+    /** Walks from the given cell towards the given location, each step to the neighbor across the face the
+     * location is farthest beyond, until a cell containing it is found.  Returns false if the walk leaves the
+     * grid, takes more than maxSteps steps or gets stuck (e.g. the location is outside the grid or the cells are
+     * too distorted), in which case another search method must be used.
+     * @param cellIndex Output: the index of the cell containing the location.
+     */
+    bool walk( uint startCellIndex, double x, double y, double z, uint maxSteps, uint& cellIndex ) const;
+
+    /** Computes the coordinates (between 0.0 and 1.0) of the given location inside the given cell from the
+     * distances to its faces, as GeoGrid::XYZtoUVW() does. */
+    void getLocalUVW( uint cellIndex, double x, double y, double z, double& u, double& v, double& w ) const;
+
+    uint getCellCount() const { return m_nI * m_nJ * m_nK; }
+
+private:
+    const GeoGridMesh& m_mesh;
+    uint m_nI, m_nJ, m_nK;
+
+    /** The unit outward normals of the six faces of each cell: the X, Y and Z of face f of cell c
+     * are at 18 * c + 3 * f. */
+    std::vector<double> m_normals;
+
+    /** Returns the position of the location relative to the given face: negative if it is beyond the face
+     * (outside the cell).  This is the cosine of the angle between the normal and the direction from the location
+     * to the face's first vertex. */
+    double getSide( uint cellIndex, int face, double x, double y, double z ) const;
+};
+
+#endif // GEOGRIDCELLLOCATOR_H
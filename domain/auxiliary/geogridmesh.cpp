@@ -0,0 +1,145 @@
+#include "geogridmesh.h"
+#include "../application.h"
+#include <QFile>
+#include <cstring>
+
+/** The fixed-size header at the beginning of binary mesh files.
+ * The mesh follows it: the nVertexes X coordinates, the nVertexes Y coordinates,
+ * the nVertexes Z coordinates (all doubles) and then the 8 * nCells vertex ids (32-bit unsigned integers). */
+struct GeoGridMeshHeader {
+    char magic[8];
+    quint64 nVertexes;
+    quint64 nCells;
+};
+
+//Change the last char whenever the file layout changes.
+static const char GEOGRID_MESH_MAGIC[8] = { 'G', 'R', 'M', 'E', 'S', 'H', 'B', '1' };
+
+GeoGridMesh::GeoGridMesh()
+{
+}
+
+void GeoGridMesh::reserve(size_t nVertexes, size_t nCells)
+{
+    m_X.reserve( nVertexes );
+    m_Y.reserve( nVertexes );
+    m_Z.reserve( nVertexes );
+    m_cellVertexIds.reserve( nCells * 8 );
+}
+
+void GeoGridMesh::appendVertex(double x, double y, double z)
+{
+    m_X.push_back( x );
+    m_Y.push_back( y );
+    m_Z.push_back( z );
+}
+
+void GeoGridMesh::appendCell(const uint32_t (&vIds)[8])
+{
+    m_cellVertexIds.insert( m_cellVertexIds.end(), vIds, vIds + 8 );
+}
+
+void GeoGridMesh::clear()
+{
+    //clear() does not guarantee memory is actually freed.
+    std::vector<double>().swap( m_X );
+    std::vector<double>().swap( m_Y );
+    std::vector<double>().swap( m_Z );
+    std::vector<uint32_t>().swap( m_cellVertexIds );
+}
+
+bool GeoGridMesh::isBinaryFile(const QString &path)
+{
+    QFile file( path );
+    if( ! file.open( QFile::ReadOnly ) )
+        return false;
+    char magic[8];
+    return file.read( magic, sizeof(magic) ) == (qint64)sizeof(magic) &&
+           ! std::memcmp( magic, GEOGRID_MESH_MAGIC, sizeof(magic) );
+}
+
+bool GeoGridMesh::loadBinary(const QString &path)
+{
+    QFile file( path );
+    if( ! file.open( QFile::ReadOnly ) )
+        return false;
+
+    //read and check the header
+    GeoGridMeshHeader header;
+    if( file.read( reinterpret_cast<char*>( &header ), sizeof(header) ) != (qint64)sizeof(header) ||
+        std::memcmp( header.magic, GEOGRID_MESH_MAGIC, sizeof(GEOGRID_MESH_MAGIC) ) )
+        return false;
+    quint64 bytesOfCoordinates = header.nVertexes * sizeof(double);
+    quint64 bytesOfCells = header.nCells * 8 * sizeof(uint32_t);
+    if( static_cast<quint64>( file.size() ) != sizeof(header) + 3 * bytesOfCoordinates + bytesOfCells ){
+        Application::instance()->logError( "GeoGridMesh::loadBinary(): mesh file " + path + " is truncated." );
+        return false;
+    }
+
+    //map the arrays in the file
+    uchar* mappedFile = nullptr;
+    if( header.nVertexes || header.nCells ){
+        mappedFile = file.map( sizeof(header), 3 * bytesOfCoordinates + bytesOfCells );
+        if( ! mappedFile ){
+            Application::instance()->logError( "GeoGridMesh::loadBinary(): could not map " + path + " in memory." );
+            return false;
+        }
+    }
+    const double* coordinates = reinterpret_cast<const double*>( mappedFile );
+    const uint32_t* cellVertexIds = reinterpret_cast<const uint32_t*>( mappedFile + 3 * bytesOfCoordinates );
+
+    //a corrupt file must not lead to out-of-bounds accesses later.
+    for( quint64 i = 0; i < header.nCells * 8; ++i )
+        if( cellVertexIds[i] >= header.nVertexes ){
+            Application::instance()->logError( "GeoGridMesh::loadBinary(): mesh file " + path + " refers to non-existing vertexes." );
+            file.unmap( mappedFile );
+            return false;
+        }
+
+    //copy the arrays
+    m_X.assign( coordinates, coordinates + header.nVertexes );
+    m_Y.assign( coordinates + header.nVertexes, coordinates + 2 * header.nVertexes );
+    m_Z.assign( coordinates + 2 * header.nVertexes, coordinates + 3 * header.nVertexes );
+    m_cellVertexIds.assign( cellVertexIds, cellVertexIds + header.nCells * 8 );
+
+    if( mappedFile )
+        file.unmap( mappedFile );
+    return true;
+}
+
+bool GeoGridMesh::saveBinary(const QString &path) const
+{
+    //the mesh is written to a temporary file first, so a failed save does not destroy the existing mesh file.
+    QFile file( path + ".new" );
+    if( ! file.open( QFile::WriteOnly | QFile::Truncate ) ){
+        Application::instance()->logError( "GeoGridMesh::saveBinary(): could not open " + file.fileName() + " for writing." );
+        return false;
+    }
+
+    GeoGridMeshHeader header;
+    std::memcpy( header.magic, GEOGRID_MESH_MAGIC, sizeof(GEOGRID_MESH_MAGIC) );
+    header.nVertexes = getVertexCount();
+    header.nCells = getCellCount();
+    bool ok = file.write( reinterpret_cast<const char*>( &header ), sizeof(header) ) == (qint64)sizeof(header);
+
+    const std::vector<double>* coordinates[] = { &m_X, &m_Y, &m_Z };
+    for( const std::vector<double>* values : coordinates ){
+        qint64 nBytes = values->size() * sizeof(double);
+        ok = ok && file.write( reinterpret_cast<const char*>( values->data() ), nBytes ) == nBytes;
+    }
+    qint64 nBytes = m_cellVertexIds.size() * sizeof(uint32_t);
+    ok = ok && file.write( reinterpret_cast<const char*>( m_cellVertexIds.data() ), nBytes ) == nBytes;
+    file.close();
+
+    if( ! ok ){
+        Application::instance()->logError( "GeoGridMesh::saveBinary(): failed to write " + file.fileName() + "." );
+        file.remove();
+        return false;
+    }
+
+    //replace the previous mesh file, if any.
+    QFile previous( path );
+    if( previous.exists() )
+        previous.remove();
+    return file.rename( path );
+}
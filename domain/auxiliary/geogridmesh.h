@@ -0,0 +1,90 @@
+#ifndef GEOGRIDMESH_H
+#define GEOGRIDMESH_H
+
+#include <QString>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * The GeoGridMesh class holds the cell geometry of a GeoGrid in flat arrays (structure of arrays):
+ * the X, Y and Z coordinates of the vertexes are in three arrays and the ids of the eight vertexes
+ * of every cell are in a single array (cell c uses the elements 8*c to 8*c+7).  A vertex id is its index
+ * in the coordinate arrays.  The cell index is computed from its topological coordinates following
+ * GSLib convention: K * nJ * nI + J * nI + I.  So the cell of index 0 is the cell with I = 0; J = 0; K = 0.
+ *
+ * Order of the vertex ids forming the geometry of a cell:
+ *
+ *                        J
+ *                        |
+ *                        |
+ *
+ *                        3-----------2   face 0 = 0 1 2 3
+ *                       /|          /|   face 1 = 4 7 6 5
+ *                     /  |        /  |   face 2 = 0 3 7 4
+ *                   /    |      /    |   face 3 = 1 5 6 2
+ *                  7--------- 6      |   face 4 = 0 4 5 1
+ *                  |     |    |      |   face 5 = 3 2 6 7
+ *                  |     0----|------1    --- I
+ *                  |    /     |     /
+ *                  |  /       |   /
+ *                  |/         | /
+ *                  4--------- 5
+ *
+ *               /
+ *             /
+ *           K
+ *
+ * The mesh is persisted in a binary file with the same layout as in memory (see saveBinary()), which is
+ * memory-mapped when loaded.  The older text format is read by MeshLoader and written by
+ * GeoGrid::exportMeshAsText().
+ */
+class GeoGridMesh
+{
+public:
+    GeoGridMesh();
+
+    size_t getVertexCount() const { return m_X.size(); }
+    size_t getCellCount() const { return m_cellVertexIds.size() / 8; }
+
+    /** Returns whether there are no vertexes and no cells. */
+    bool empty() const { return m_X.empty() && m_cellVertexIds.empty(); }
+
+    /** Pre-allocates memory for the given numbers of vertexes and cells. */
+    void reserve( size_t nVertexes, size_t nCells );
+
+    void appendVertex( double x, double y, double z );
+
+    /** Appends a cell given the ids of its eight vertexes (see the class documentation for their order). */
+    void appendCell( const uint32_t (&vIds)[8] );
+
+    double getX( uint32_t vertexId ) const { return m_X[vertexId]; }
+    double getY( uint32_t vertexId ) const { return m_Y[vertexId]; }
+    double getZ( uint32_t vertexId ) const { return m_Z[vertexId]; }
+
+    /** Returns the address of the eight vertex ids of the given cell.  No bounds checking is performed. */
+    const uint32_t* getCellVertexIds( size_t cellIndex ) const { return m_cellVertexIds.data() + cellIndex * 8; }
+
+    /** Empties the mesh and frees its memory. */
+    void clear();
+
+    /** Returns whether the given file is a mesh file in binary format. */
+    static bool isBinaryFile( const QString& path );
+
+    /** Replaces the mesh with the one in the given binary file.  Returns false if the file cannot be read,
+     * is not a binary mesh file, is truncated or refers to non-existing vertexes, in which case the mesh is
+     * left unchanged.
+     */
+    bool loadBinary( const QString& path );
+
+    /** Writes the mesh to the given file in binary format.  Returns false if the file could not be written. */
+    bool saveBinary( const QString& path ) const;
+
+private:
+    std::vector<double> m_X;
+    std::vector<double> m_Y;
+    std::vector<double> m_Z;
+    std::vector<uint32_t> m_cellVertexIds;
+};
+
+#endif // GEOGRIDMESH_H
@@ -1,4 +1,5 @@
 #include "meshloader.h"
+#include "geogridmesh.h"
 
 #include <QFileInfo>
 #include <QTextStream>
@@ -7,13 +8,11 @@
 #include "../application.h"
 
 
-MeshLoader::MeshLoader(QFile & file, std::vector<VertexRecordPtr> & vertexes,
-					   std::vector<CellDefRecordPtr> & cellDefs,
+MeshLoader::MeshLoader(QFile & file, GeoGridMesh & mesh,
 					   uint & data_line_count, QObject * parent) :
 	QObject(parent),
 	_file(file),
-	m_vertexes( vertexes ),
-	m_cellDefs( cellDefs ),
+	m_mesh( mesh ),
 	_data_line_count(data_line_count),
 	_finished(false)
 {
@@ -68,7 +67,7 @@ void MeshLoader::doLoad()
 		   if( isInVertexesSection ){
 			   if( valuesAsString.size() != 3 ){
 				   Application::instance()->logError( QString("MeshLoader::doLoad(): vertex coordinate count different from 3 in line ").append(QString::number(i)) );
-				   m_vertexes.push_back( VertexRecordPtr( new VertexRecord{ 0.0, 0.0, 0.0 } ) );
+				   m_mesh.appendVertex( 0.0, 0.0, 0.0 );
 			   } else {
 				   bool ok[] = {true, true, true};
 				   double x = valuesAsString[0].toDouble( &ok[0] );
@@ -77,27 +76,28 @@ void MeshLoader::doLoad()
 				   if( !ok[0] || !ok[1] || !ok[2] )
 					   Application::instance()->logError( QString("MeshLoader::doLoad(): error in vertex section of mesh file (line ").
 														  append(QString::number(i)).append("): could not convert a value to double.") );
-				   m_vertexes.push_back( VertexRecordPtr( new VertexRecord{ x, y, z } ) ) ;
+				   m_mesh.appendVertex( x, y, z );
 			   }
 		   } else if( isInCellDefsSection ) {
 			   if( valuesAsString.size() != 8 ){
 				   Application::instance()->logError( QString("MeshLoader::doLoad(): vertex id count in cell definition different from 8 in line ").append(QString::number(i)) );
-				   m_cellDefs.push_back( CellDefRecordPtr( new CellDefRecord{ {0, 0, 0, 0, 0, 0, 0, 0} } ) );
+				   const uint32_t noVIds[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+				   m_mesh.appendCell( noVIds );
 			   } else {
 				   bool ok[] = {true, true, true, true, true, true, true, true};
-				   int vId[8];
-				   vId[0] = valuesAsString[0].toInt( &ok[0] );
-				   vId[1] = valuesAsString[1].toInt( &ok[1] );
-				   vId[2] = valuesAsString[2].toInt( &ok[2] );
-				   vId[3] = valuesAsString[3].toInt( &ok[3] );
-				   vId[4] = valuesAsString[4].toInt( &ok[4] );
-				   vId[5] = valuesAsString[5].toInt( &ok[5] );
-				   vId[6] = valuesAsString[6].toInt( &ok[6] );
-				   vId[7] = valuesAsString[7].toInt( &ok[7] );
+				   uint32_t vId[8];
+				   for( int iVertex = 0; iVertex < 8; ++iVertex )
+					   vId[iVertex] = valuesAsString[iVertex].toUInt( &ok[iVertex] );
 				   if( !ok[0] || !ok[1] || !ok[2] || !ok[3] || !ok[4] || !ok[5] || !ok[6] || !ok[7] )
 					   Application::instance()->logError( QString("MeshLoader::doLoad(): error in cell definition section of mesh file (line ").
 														  append(QString::number(i)).append("): could not convert a value to unsigned integer.") );
-				   m_cellDefs.push_back( CellDefRecordPtr( new CellDefRecord{ { vId[0], vId[1], vId[2], vId[3], vId[4], vId[5], vId[6], vId[7] } } ) );
+				   //the vertexes section comes first, so references to non-existing vertexes can be detected here.
+				   for( int iVertex = 0; iVertex < 8; ++iVertex )
+					   if( vId[iVertex] >= m_mesh.getVertexCount() ){
+						   Application::instance()->logError( QString("MeshLoader::doLoad(): non-existing vertex referred to in line ").append(QString::number(i)) );
+						   vId[iVertex] = 0;
+					   }
+				   m_mesh.appendCell( vId );
 			   }
 		   }
 
@@ -3,10 +3,12 @@
 
 #include <QObject>
 #include <QFile>
-#include "../geogrid.h"
+
+class GeoGridMesh;
 
 /** This is an auxiliary class used in GeoGrid::loadMesh() to enable the progress dialog.
  * The file is read in a separate thread, so the progress bar updates.
+ * It reads mesh files in the older text format.  Binary mesh files are read by GeoGridMesh::loadBinary().
  */
 class MeshLoader : public QObject
 {
@@ -15,8 +17,7 @@ class MeshLoader : public QObject
 
 public:
 	explicit MeshLoader(QFile &file,
-						std::vector< VertexRecordPtr > &vertexes,
-						std::vector< CellDefRecordPtr > &cellDefs,
+						GeoGridMesh &mesh,
 						uint &data_line_count,
 						QObject *parent = 0);
 
@@ -29,8 +30,7 @@ signals:
 
 private:
 	QFile &_file;
-	std::vector< VertexRecordPtr > &m_vertexes;
-	std::vector< CellDefRecordPtr > &m_cellDefs;
+	GeoGridMesh &m_mesh;
 	uint &_data_line_count;
 	bool _finished;
 };
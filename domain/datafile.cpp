@@ -26,6 +26,10 @@
 #include "auxiliary/dataloader.h"
 #include "auxiliary/variableremover.h"
 #include "auxiliary/datasaver.h"
+#include "auxiliary/datacache.h"
+#include "auxiliary/datalineindex.h"
+#include "auxiliary/filevaliditystamp.h"
+#include "spatialindex/spatialindex.h"
 #include "algorithms/ialgorithmdatasource.h"
 #include "calculator/icalcproperty.h"
 #include "geogrid.h"
@@ -119,14 +123,42 @@ DataFile::DataFile(QString path)
 }
 
 void DataFile::loadData()
+{
+    loadDataColumns(std::vector<bool>());
+}
+
+void DataFile::loadData(const std::set<uint> &columns)
+{
+    std::vector<bool> columnsToLoad;
+    for (uint column : columns) {
+        if (column >= columnsToLoad.size())
+            columnsToLoad.resize(column + 1, false);
+        columnsToLoad[column] = true;
+    }
+    // an empty set would mean all columns to the loader
+    if (columnsToLoad.empty())
+        return;
+    loadDataColumns(columnsToLoad);
+}
+
+void DataFile::loadDataColumns(const std::vector<bool> &columnsToLoad)
 {
     QFile file(this->_path);
     file.open(QFile::ReadOnly | QFile::Text);
     uint data_line_count = 0;
     QFileInfo info(_path);
 
+    // whether the requested columns (all if none is flagged) are already in memory
+    bool hasRequestedColumns = !_data.hasUnloadedColumns();
+    if (!columnsToLoad.empty()) {
+        hasRequestedColumns = true;
+        for (uint iColumn = 0; iColumn < columnsToLoad.size(); ++iColumn)
+            if (columnsToLoad[iColumn] && !_data.isColumnLoaded(iColumn))
+                hasRequestedColumns = false;
+    }
+
     // if loaded data is not empty and was loaded before
-    if (!_data.empty() && !_lastModifiedDateTimeLastLoad.isNull()) {
+    if (!_data.empty() && !_lastModifiedDateTimeLastLoad.isNull() && hasRequestedColumns) {
         QDateTime currentLastModified = info.lastModified();
         // if modified datetime didn't change since last call to loadData
         if (currentLastModified <= _lastModifiedDateTimeLastLoad) {
@@ -146,39 +178,58 @@ void DataFile::loadData()
 
     // make sure _data is empty
     _data.clear();
-	std::vector< std::vector<double> >().swap(_data); //clear() may not actually free memory
+    invalidateColumnStatistics();
+
+    // try the binary cache first, which is only kept for entire files (it has all the columns)
+    bool useCache = Application::instance()->getDataFileCacheSetting() && !isSetToBePaged();
+    FileValidityStamp stamp;
+    bool loadedFromCache = false;
+    if (useCache) {
+        stamp = FileValidityStamp::fromFile(_path);
+        loadedFromCache = DataCache(_path).load(stamp, _data, data_line_count);
+        if (loadedFromCache)
+            Application::instance()->logInfo("Data loaded from the binary cache.");
+    }
 
-    // data load takes place in another thread, so we can show and update a progress bar
-    //////////////////////////////////
-    QProgressDialog progressDialog;
-    progressDialog.show();
-    progressDialog.setLabelText("Loading and parsing " + _path + "...");
-    progressDialog.setMinimum(0);
-    progressDialog.setValue(0);
-    progressDialog.setMaximum(getFileSize() / 100); // see DataLoader::doLoad(). Dividing
-                                                    // by 100 allows a max value of ~400GB
-                                                    // when converting from long to int
-    QThread *thread = new QThread(); // does it need to set parent (a QObject)?
-    DataLoader *dl = new DataLoader(file, _data, data_line_count, _dataPageFirstLine,
-                                    _dataPageLastLine); // Do not set a parent. The object
-                                                        // cannot be moved if it has a
-                                                        // parent.
-    dl->moveToThread(thread);
-    dl->connect(thread, SIGNAL(finished()), dl, SLOT(deleteLater()));
-    dl->connect(thread, SIGNAL(started()), dl, SLOT(doLoad()));
-    dl->connect(dl, SIGNAL(progress(int)), &progressDialog, SLOT(setValue(int)));
-	thread->start();
-    /////////////////////////////////
+    if (!loadedFromCache) {
+        // data load takes place in another thread, so we can show and update a progress bar
+        //////////////////////////////////
+        QProgressDialog progressDialog;
+        progressDialog.show();
+        progressDialog.setLabelText("Loading and parsing " + _path + "...");
+        progressDialog.setMinimum(0);
+        progressDialog.setValue(0);
+        progressDialog.setMaximum(getFileSize() / 100); // see DataLoader::doLoad(). Dividing
+                                                        // by 100 allows a max value of ~400GB
+                                                        // when converting from long to int
+        QThread *thread = new QThread(); // does it need to set parent (a QObject)?
+        DataLoader *dl = new DataLoader(file, _data, data_line_count, _dataPageFirstLine,
+                                        _dataPageLastLine, columnsToLoad); // Do not set a parent. The object
+                                                                           // cannot be moved if it has a
+                                                                           // parent.
+        dl->moveToThread(thread);
+        dl->connect(thread, SIGNAL(finished()), dl, SLOT(deleteLater()));
+        dl->connect(thread, SIGNAL(started()), dl, SLOT(doLoad()));
+        dl->connect(dl, SIGNAL(progress(int)), &progressDialog, SLOT(setValue(int)));
+        thread->start();
+        /////////////////////////////////
+
+        // wait for the data load to finish
+        // not very beautiful, but simple and effective
+        while (!dl->isFinished()) {
+            thread->wait(200); // reduces cpu usage, refreshes at each 500 milliseconds
+            QCoreApplication::processEvents(); // let Qt repaint widgets
+        }
 
-    // wait for the data load to finish
-    // not very beautiful, but simple and effective
-    while (!dl->isFinished()) {
-        thread->wait(200); // reduces cpu usage, refreshes at each 500 milliseconds
-        QCoreApplication::processEvents(); // let Qt repaint widgets
+        // rebuild the binary cache for the next loads
+        if (useCache && columnsToLoad.empty() && !DataCache(_path).save(stamp, _data, data_line_count))
+            Application::instance()->logWarn("DataFile::loadData(): could not update the binary cache of " + _path + ".");
     }
 
     file.close();
 
+    narrowDataColumns();
+
 	// geo- and cartesian grids must have a given number of read lines
 	if (this->getFileType() == "CARTESIANGRID" || this->getFileType() == "GEOGRID" ) {
 		GridFile *gf = (GridFile *)this;
@@ -200,113 +251,124 @@ void DataFile::loadData()
     Application::instance()->logInfo("Finished loading data.");
 }
 
-double DataFile::data(uint line, uint column)
+void DataFile::narrowDataColumns()
 {
-    switch (_data.size()) { // if _data is empty
-    case 0:
-        loadData(); // loads the data from disk.
+    bool singlePrecision = Application::instance()->getDataFileSinglePrecisionSetting();
+    bool hasNDV = hasNoDataValue();
+    double ndv = getNoDataValueAsDouble();
+    size_t bytesBefore = _data.getMemoryUsage();
+
+    for (size_t iColumn = 0; iColumn < _data.getColumnCount(); ++iColumn) {
+        bool isCategoricalColumn = false;
+        QList<QPair<uint, QString>>::iterator it = _categorical_attributes.begin();
+        for (; it != _categorical_attributes.end(); ++it)
+            if ((*it).first == iColumn + 1) // GEO-EAS indexes start at 1
+                isCategoricalColumn = true;
+        // categorical columns are left as is if they contain non-integer or large codes
+        if (isCategoricalColumn)
+            _data.narrowToIntegers(iColumn, hasNDV, ndv);
+        else if (singlePrecision && canBeInSinglePrecision(iColumn))
+            _data.narrowToFloat32(iColumn, hasNDV, ndv);
     }
-    return (this->_data.at(line)).at(column);
+
+    size_t bytesAfter = _data.getMemoryUsage();
+    if (bytesAfter < bytesBefore)
+        Application::instance()->logInfo(QString("Loaded data take ")
+                                              .append(QString::number(bytesAfter / 1048576.0, 'f', 1))
+                                              .append("MB in memory (")
+                                              .append(QString::number(bytesBefore / 1048576.0, 'f', 1))
+                                              .append("MB in double precision)."));
+}
+
+double DataFile::data(uint line, uint column)
+{
+    if (_data.empty() || !_data.isColumnLoaded(column))
+        loadData(); // loads the data from disk (all columns if only some were loaded).
+    return _data.at(line, column);
 }
 
 double DataFile::dataConst(uint line, uint column) const
 {
-    switch (_data.size()) { // if _data is empty
-    case 0:
+    if (_data.empty())
         assert( false && "DataFile::dataConst(): data not loaded.  Make sure you call loadData() prior to fetching data with dataConst()." );
-    }
-    return (this->_data.at(line)).at(column);
+    return _data.at(line, column);
 }
 
-// TODO: consider adding a flag to disable NDV checking (applicable to coordinates)
 double DataFile::max(uint column)
 {
-    if (_data.size() == 0)
+    if (_data.empty())
         Application::instance()->logError(
             "DataFile::max(): Data not loaded. Unspecified value was returned.");
-    double ndv = this->getNoDataValue().toDouble();
-    bool has_ndv = this->hasNoDataValue();
-    double result = -std::numeric_limits<double>::max();
-    for (uint i = 0; i < _data.size(); ++i) {
-        double value = data(i, column);
-        if (value > result && (!has_ndv || !Util::almostEqual2sComplement(ndv, value, 1)))
-            result = value;
-    }
-    return result;
+    return getColumnStatistics(column).max;
 }
 
 double DataFile::maxAbs(uint column)
 {
-    if (_data.size() == 0)
+    if (_data.empty())
         Application::instance()->logError(
             "DataFile::maxAbs(): Data not loaded. Unspecified value was returned.");
-    double ndv = this->getNoDataValue().toDouble();
-    bool has_ndv = this->hasNoDataValue();
-	double result = 0.0;
-    for (uint i = 0; i < _data.size(); ++i) {
-        double value = data(i, column);
-        if (std::abs<double>(value) > result
-            && (!has_ndv || !Util::almostEqual2sComplement(ndv, value, 1)))
-            result = std::abs<double>(value);
-    }
-    return result;
+    return getColumnStatistics(column).maxAbs;
 }
 
-// TODO: consider adding a flag to disable NDV checking (applicable to coordinates)
 double DataFile::min(uint column)
 {
-    if (_data.size() == 0)
+    if (_data.empty())
         Application::instance()->logError(
             "DataFile::min(): Data not loaded. Unspecified value was returned.");
-    double ndv = this->getNoDataValue().toDouble();
-    bool has_ndv = this->hasNoDataValue();
-    double result = std::numeric_limits<double>::max();
-    for (uint i = 0; i < _data.size(); ++i) {
-        double value = data(i, column);
-        if (value < result && (!has_ndv || !Util::almostEqual2sComplement(ndv, value, 1)))
-            result = value;
-    }
-    return result;
+    return getColumnStatistics(column).min;
 }
 
 double DataFile::minAbs(uint column)
 {
-    if (_data.size() == 0)
+    if (_data.empty())
         Application::instance()->logError(
             "DataFile::minAbs(): Data not loaded. Unspecified value was returned.");
-    double ndv = this->getNoDataValue().toDouble();
-    bool has_ndv = this->hasNoDataValue();
-    double result = std::numeric_limits<double>::max();
-    for (uint i = 0; i < _data.size(); ++i) {
-        double value = data(i, column);
-        if (std::abs<double>(value) < result
-            && (!has_ndv || !Util::almostEqual2sComplement(ndv, value, 1)))
-            result = std::abs<double>(value);
-    }
-    return result;
+    return getColumnStatistics(column).minAbs;
 }
 
-// TODO: consider adding a flag to disable NDV checking (applicable to coordinates)
 double DataFile::mean(uint column)
 {
-    if (_data.size() == 0)
+    if (_data.empty())
         Application::instance()->logError(
             "DataFile::mean(): Data not loaded. Unspecified value was returned.");
+    return getColumnStatistics(column).getMean();
+}
+
+const DataColumnStatistics &DataFile::getColumnStatistics(uint column)
+{
+    // a partial load may lack the column
+    if (!_data.empty() && !_data.isColumnLoaded(column))
+        loadData(); // loads the data from disk (all columns if only some were loaded).
+    // the no-data value may have changed since the statistics were computed
     double ndv = this->getNoDataValue().toDouble();
     bool has_ndv = this->hasNoDataValue();
-    double result = 0.0;
-    uint count_valid = 0;
-    for (uint i = 0; i < _data.size(); ++i) {
-        double value = data(i, column);
-        if (!has_ndv || !Util::almostEqual2sComplement(ndv, value, 1)) {
-            result += value;
-            ++count_valid;
+    if (column >= _columnStatistics.size())
+        _columnStatistics.resize(column + 1);
+    DataColumnStatistics &stats = _columnStatistics[column];
+    if (!stats.isComputed || stats.hasNoDataValue != has_ndv || (has_ndv && stats.noDataValue != ndv)) {
+        stats = DataColumnStatistics::compute(_data.getColumn(column), has_ndv, ndv);
+        // statistics of absent data are not kept, so they are computed again once the data are loaded
+        // (the callers already report data not loaded at all)
+        if (_data.empty() || !_data.isColumnLoaded(column)) {
+            if (!_data.empty())
+                Application::instance()->logError(
+                    "DataFile::getColumnStatistics(): column " + QString::number(column)
+                    + " could not be loaded. Unspecified values were returned.");
+            stats.isComputed = false;
         }
     }
-    if (count_valid > 0)
-        return result / count_valid;
-    else
-        return 0.0;
+    return stats;
+}
+
+void DataFile::invalidateColumnStatistics()
+{
+    _columnStatistics.clear();
+}
+
+void DataFile::invalidateColumnStatistics(uint column)
+{
+    if (column < _columnStatistics.size())
+        _columnStatistics[column].isComputed = false;
 }
 
 uint DataFile::getFieldGEOEASIndex(QString field_name) const
@@ -413,12 +475,18 @@ void DataFile::deleteFromFS()
     QFile file(this->getMetaDataFilePath());
     file.remove(); // TODO: throw exception if remove() returns false (fails).  Also see
                    // QIODevice::errorString() to see error message.
+    // and the binary cache, line index and saved spatial index, if any
+    DataCache(_path).remove();
+    DataLineIndex(_path).remove();
+    QFile spatialIndexFile( SpatialIndex::getIndexFilePath( this ) );
+    if( spatialIndexFile.exists() )
+        spatialIndexFile.remove();
 }
 
 void DataFile::writeToFS()
 {
 
-    if( _data.size() <= 0 ){
+    if( _data.empty() ){
         Application::instance()->logError("DataFile::writeToFS(): No data. Save failed.");
         return;
     }
@@ -428,14 +496,18 @@ void DataFile::writeToFS()
         return;
     }
 
+    if( _data.hasUnloadedColumns() ){
+        Application::instance()->logError("DataFile::writeToFS(): only some columns are loaded (see loadData(columns)). Save failed.");
+        return;
+    }
+
     //create a new file for output
     QFile outputFile( QString( this->getPath() ).append(".new") );
     if( ! outputFile.open( QFile::WriteOnly | QFile::Text | QFile::Truncate ) )
         assert( false && "DataFile::writeToFS(): Could not open ASCII file for writing.");
 
+    // the header is composed in memory, the data lines are formatted by DataSaver
     std::ostringstream out;
-    out.precision( 12 );
-    //std::fixed( out ); //this forces fixed precision (that is, zeros to the right)
 
     // if file already exists, keep copy of the file description or make up one otherwise
     QString comment;
@@ -447,7 +519,7 @@ void DataFile::writeToFS()
 
     // next, we need to know the number of columns
     //(assumes the first data line has the correct number of variables)
-    uint nvars = _data[0].size();
+    uint nvars = _data.getColumnCount();
     out << nvars << endl;
 
     // get all child objects (mostly attributes directly under this file or attached under
@@ -485,6 +557,16 @@ void DataFile::writeToFS()
         }
     }
 
+    // write the header, keeping the current file if it could not be entirely written
+    std::string header = out.str();
+    if( outputFile.write( header.data(), header.length() ) != (qint64)header.length() ){
+        Application::instance()->logError("DataFile::writeToFS(): failed to write " + outputFile.fileName() +
+                                          " (disk full?).  The file " + this->getPath() + " was not changed.");
+        outputFile.close();
+        outputFile.remove();
+        return;
+    }
+
     //data save takes place in another thread, so we can show and update a progress bar
     //////////////////////////////////
     QProgressDialog progressDialog;
@@ -494,7 +576,7 @@ void DataFile::writeToFS()
     progressDialog.setValue( 0 );
     progressDialog.setMaximum( getDataLineCount() );
     QThread* thread = new QThread();  //does it need to set parent (a QObject)?
-    DataSaver* ds = new DataSaver( _data, out );  // Do not set a parent. The object cannot be moved if it has a parent.
+    DataSaver* ds = new DataSaver( _data, outputFile );  // Do not set a parent. The object cannot be moved if it has a parent.
     ds->moveToThread(thread);
     ds->connect(thread, SIGNAL(finished()), ds, SLOT(deleteLater()));
     ds->connect(thread, SIGNAL(started()), ds, SLOT(doSave()));
@@ -509,11 +591,17 @@ void DataFile::writeToFS()
         QCoreApplication::processEvents(); //let Qt repaint widgets
     }
 
-    outputFile.write( out.str().data(), out.str().length() );
-
     // close output file
     outputFile.close();
 
+    // keep the current file if the new one could not be entirely written
+    if( ds->hasFailed() ){
+        Application::instance()->logError("DataFile::writeToFS(): failed to write " + outputFile.fileName() +
+                                          " (disk full?).  The file " + this->getPath() + " was not changed.");
+        outputFile.remove();
+        return;
+    }
+
     // deletes the current file
     QFile currentFile(this->getPath());
     currentFile.remove();
@@ -622,13 +710,13 @@ std::vector< std::vector<double> > DataFile::getDataSortedBy(int variableIndex,
         Application::instance()->logError("DataFile::getDataSortedBy(): Operation failed: no data loaded.");
         return result;
     }
-    if( variableIndex < 0 || variableIndex >= _data[0].size() ){ //assuming all rows have the same number of columns.
+    if( variableIndex < 0 || variableIndex >= (int)_data.getColumnCount() ){
         Application::instance()->logError("DataFile::getDataSortedBy(): Operation failed: index out of range: " + QString::number(variableIndex));
         return result;
     }
 
     // Make a duplicate of the original data.
-    result = _data;
+    result = _data.toRows();
 
     // Sort the data by given column.
     Util::sortDataFrame( result, variableIndex, sortingOrder );
@@ -645,7 +733,7 @@ std::vector< std::vector< std::vector<double> > > DataFile::getDataGroupedBy(int
         Application::instance()->logError("DataFile::getDataGroupedBy(): Operation failed: no data loaded.");
         return result;
     }
-    if( variableIndex < 0 || variableIndex >= _data[0].size() ){ //assuming all rows have the same number of columns.
+    if( variableIndex < 0 || variableIndex >= (int)_data.getColumnCount() ){
         Application::instance()->logError("DataFile::getDataGroupedBy(): Operation failed: index out of range: " + QString::number(variableIndex));
         return result;
     }
@@ -671,9 +759,9 @@ std::vector< std::vector< std::vector<double> > > DataFile::getDataGroupedBy(int
     return result;
 }
 
-const std::vector<double> &DataFile::getDataRow(int rowIndex) const
+std::vector<double> DataFile::getDataRow(int rowIndex) const
 {
-    return _data[rowIndex];
+    return _data.getRow(rowIndex);
 }
 
 std::vector<std::vector<double> > DataFile::getDataFilteredBy(int variableIndex, double value0, double value1) const
@@ -700,7 +788,8 @@ std::vector<std::vector<double> > DataFile::getDataFilteredBy(int variableIndex,
 
 void DataFile::replaceDataFrame( const std::vector<std::vector<double> > &dataTable )
 {
-    _data = dataTable;
+    _data = ColumnarDataTable::fromRows(dataTable);
+    invalidateColumnStatistics();
 }
 
 bool DataFile::getCenter(double &x, double &y, double &z) const
@@ -868,7 +957,7 @@ void DataFile::addGEOEASColumn(Attribute *at, const QString new_name, bool categ
     }
 }
 
-uint DataFile::getDataLineCount() const { return _data.size(); }
+uint DataFile::getDataLineCount() const { return _data.getRowCount(); }
 
 uint DataFile::getDataColumnCount()
 {
@@ -879,7 +968,7 @@ uint DataFile::getDataColumnCount()
 uint DataFile::getDataColumnCountConst() const
 {
     if (getDataLineCount() > 0)
-        return _data[0].size();
+        return _data.getColumnCount();
     else
         return 0;
 }
@@ -900,21 +989,24 @@ void DataFile::classify(uint column, UnivariateCategoryClassification *ucc,
     // load the current data from the file system
     loadData();
 
+    // define the default value (for class not found)
+    int noClassFoundValue = -1;
+    if (hasNoDataValue())
+        // hopefully the file's NDV is integer
+        noClassFoundValue = (int)getNoDataValue().toDouble();
+
     // for each data row...
-    std::vector<std::vector<double>>::iterator it = _data.begin();
-    for (; it != _data.end(); ++it) {
-        // define the default value (for class not found)
-        int noClassFoundValue = -1;
-        if (hasNoDataValue())
-            // hopefully the file's NDV is integer
-            noClassFoundValue = (int)getNoDataValue().toDouble();
-        //...get the input value
-        double value = (*it).at(column);
-        //...get the category code corresponding to the value
+    DataColumnSpan inputValues = _data.getColumn(column);
+    std::vector<double> categoryIds;
+    categoryIds.reserve(inputValues.size);
+    for (double value : inputValues) {
+        //...get the category code corresponding to the input value
         int categoryId = ucc->getCategory(value, noClassFoundValue);
-        //...append the code to the current row.
-        (*it).push_back(categoryId);
+        //...collect the code for the new column.
+        categoryIds.push_back(categoryId);
     }
+    _data.appendColumn(categoryIds);
+    invalidateColumnStatistics();
 
     // create and add a new Attribute object the represents the new column
     uint newIndexGEOEAS = Util::getFieldNames(this->getPath()).count() + 1;
@@ -939,26 +1031,29 @@ void DataFile::convertToCategorical(uint column, CategoryDefinition *cd, int fal
     loadData();
 
     // for each data row...
-    std::vector<std::vector<double>>::iterator it = _data.begin();
-    for (; it != _data.end(); ++it) {
-        double originalValue = (*it).at(column);
+    DataColumnSpan originalValues = _data.getColumn(column);
+    std::vector<double> codes;
+    codes.reserve(originalValues.size);
+    for (double originalValue : originalValues) {
         //...get the input value
         //The categorical code is an integer, so making sure it is properly rounded off.
         int candidateCode = static_cast<int>( std::round( originalValue ) );
         //...check whether the value is a valid category code
         if ( cd->codeExists( candidateCode ) )
-            //...append the code to the current row.
-            (*it).push_back( candidateCode );
+            //...collect the code for the new column.
+            codes.push_back( candidateCode );
         else {
             //...if the invalid value is a no-data-value...
             if( hasNoDataValue() && isNDV( originalValue ) )
                 //...result is also no-data-value
-                (*it).push_back( getNoDataValueAsDouble() );
+                codes.push_back( getNoDataValueAsDouble() );
             else
                 //...use the fallback code if the value is an invalid code
-                (*it).push_back( fallbackCode );
+                codes.push_back( fallbackCode );
         }
     }
+    _data.appendColumn(codes);
+    invalidateColumnStatistics();
 
     // create and add a new Attribute object the represents the new column
     uint newIndexGEOEAS = Util::getFieldNames(this->getPath()).count() + 1;
@@ -980,8 +1075,7 @@ void DataFile::convertToCategorical(uint column, CategoryDefinition *cd, int fal
 
 void DataFile::freeLoadedData() {
 	_data.clear();
-	//clear() does not guarantee memory is actually freed.
-	std::vector< std::vector<double> >().swap( _data );
+	invalidateColumnStatistics();
 }
 
 void DataFile::setDataPage(long firstDataLine, long lastDataLine)
@@ -1006,31 +1100,29 @@ void DataFile::addDataColumns(std::vector< std::complex<double> > &columns,
                               const QString nameForNewAttributeOfImaginaryPart)
 {
     // TODO: refatorar reutilizando addEmptyDataColumn e um futuro addDataColumn
-    if (_data.empty()) { // no data, column will be first column
-        _data.reserve(columns.size());
-        std::vector<std::complex<double>>::iterator it = columns.begin();
-        for (; it != columns.end(); ++it)
-            _data.push_back({(*it).real(), (*it).imag()});
-    } else { // there are data already, column will be appended to the current ones
-        std::vector<std::complex<double>>::iterator itColumn = columns.begin();
-        std::vector<std::vector<double>>::iterator itData = _data.begin();
-        // hopefully both iterators end at the same time
-        for (; itColumn != columns.end(), itData != _data.end(); ++itColumn, ++itData) {
-            (*itData).push_back((*itColumn).real());
-            (*itData).push_back((*itColumn).imag());
-        }
-        if (itData != _data.end() || itColumn != columns.end())
-            Application::instance()->logError("DataFile::addDataColumn(): number of "
-                                              "values to add mismatched number of data "
-                                              "rows.");
+    // separate the real and imaginary parts
+    std::vector<double> realParts, imaginaryParts;
+    realParts.reserve(columns.size());
+    imaginaryParts.reserve(columns.size());
+    std::vector<std::complex<double>>::iterator it = columns.begin();
+    for (; it != columns.end(); ++it) {
+        realParts.push_back((*it).real());
+        imaginaryParts.push_back((*it).imag());
     }
 
+    // if there are data already, the columns will be appended to the current ones,
+    // otherwise the new columns define the number of data rows
+    if (!_data.empty() && _data.getRowCount() != columns.size())
+        Application::instance()->logError("DataFile::addDataColumn(): number of "
+                                          "values to add mismatched number of data "
+                                          "rows.");
+    _data.appendColumn(realParts);
+    _data.appendColumn(imaginaryParts);
+    invalidateColumnStatistics();
+
     // get the GEO-EAS index for new attributes
-    uint indexGEOEASreal
-        = _data[0].size()
-          - 1; // assumes the first row has the correct number of data columns
-    uint indexGEOEASimag
-        = _data[0].size(); // assumes the first row has the correct number of data columns
+    uint indexGEOEASreal = _data.getColumnCount() - 1;
+    uint indexGEOEASimag = _data.getColumnCount();
 
     // Create new Attribute objects that correspond to the new data columns in memory
     Attribute *newAttributeReal
@@ -1051,27 +1143,17 @@ long DataFile::addEmptyDataColumn(const QString columnName, long numberOfDataEle
 {
     std::vector<double> newColumn(numberOfDataElements, 0.0);
 
-    if (_data.empty()) { // no data, column will be first column
-        _data.reserve(newColumn.size());
-        std::vector<double>::iterator it = newColumn.begin();
-        for (; it != newColumn.end(); ++it)
-            _data.push_back({*it});
-    } else { // there are data already, column will be appended to the current ones
-        std::vector<double>::iterator itColumn = newColumn.begin();
-        std::vector<std::vector<double>>::iterator itData = _data.begin();
-        // hopefully both iterators end at the same time
-        for (; itColumn != newColumn.end(), itData != _data.end(); ++itColumn, ++itData) {
-            (*itData).push_back(*itColumn);
-        }
-        if (itData != _data.end() || itColumn != newColumn.end())
-            Application::instance()->logError("DataFile::addEmptyDataColumn(): number of "
-                                              "values to add mismatched number of data "
-                                              "rows.");
-    }
+    // if there are data already, the column will be appended to the current ones,
+    // otherwise the new column defines the number of data rows
+    if (!_data.empty() && _data.getRowCount() != newColumn.size())
+        Application::instance()->logError("DataFile::addEmptyDataColumn(): number of "
+                                          "values to add mismatched number of data "
+                                          "rows.");
+    _data.appendColumn(newColumn);
+    invalidateColumnStatistics();
 
     // get the GEO-EAS index for new attribute
-    uint indexGEOEAS
-        = _data[0].size(); // assumes the first row has the correct number of data column
+    uint indexGEOEAS = _data.getColumnCount();
 
     // Create new Attribute objects that correspond to the new data column in memory
     Attribute *newAttribute = new Attribute(columnName, indexGEOEAS);
@@ -1105,20 +1187,12 @@ int DataFile::addNewDataColumn(const QString columnName,
         defaultValue = getNoDataValueAsDouble();
 
     // append the values to the existing data array
-    std::vector<double>::const_iterator itColumn = values.cbegin();
-    std::vector<std::vector<double>>::iterator itData = _data.begin();
-    // hopefully both iterators end at the same time
-	for (; itColumn != values.cend(), itColumn != values.end() && itData != _data.end(); ++itColumn, ++itData)
-        (*itData).push_back(*itColumn);
-
-    // If the transfer was not completed (the input vector is too short), fill the
-    // remainder with the default value
-    for (; itData != _data.end(); ++itData)
-        (*itData).push_back(defaultValue);
+    // If the input vector is too short, the remainder is filled with the default value
+    _data.appendColumn(values, defaultValue);
+    invalidateColumnStatistics();
 
     // get the GEO-EAS index for new attribute
-    uint indexGEOEAS
-        = _data[0].size(); // assumes the first row has the correct number of data column
+    uint indexGEOEAS = _data.getColumnCount();
 
     // if the added column was deemed categorical, adds its GEO-EAS index and name of the
     // category definition
@@ -1238,30 +1312,12 @@ void DataFile::deleteVariable( uint columnToDelete )
 
 double DataFile::variance(uint column)
 {
-    if (_data.size() == 0) {
+    if (_data.empty()) {
         Application::instance()->logError(
             "DataFile::variance(): Data not loaded. Zero was returned.");
         return 0.0;
     }
-    // collect the valid values
-    double ndv = this->getNoDataValue().toDouble();
-    bool has_ndv = this->hasNoDataValue();
-    std::vector<double> values;
-    values.reserve(getDataLineCount());
-    for (uint i = 0; i < _data.size(); ++i) {
-        double value = data(i, column);
-        if (!has_ndv || !Util::almostEqual2sComplement(ndv, value, 1)) {
-            values.push_back(value);
-        }
-    }
-    // compute the variance
-    double mean = this->mean(column);
-    std::vector<double> diff(values.size());
-    std::transform(values.begin(), values.end(), diff.begin(),
-                   [mean](double x) { return x - mean; });
-    double squaredSum(std::inner_product(diff.begin(), diff.end(), diff.begin(), 0.0));
-    double stdev(std::sqrt(squaredSum / (double)values.size()));
-    return stdev * stdev;
+    return getColumnStatistics(column).getVariance();
 }
 
 double DataFile::correlation(uint columnX, uint columnY)
@@ -1307,22 +1363,27 @@ double DataFile::correlation(uint columnX, uint columnY)
 
 void DataFile::setData(uint line, uint column, double value)
 {
-	switch (_data.size()) { // if _data is empty
-	case 0:
-		loadData(); // loads the data from disk.
-	}
-    this->_data.at(line).at(column) = value;
+	if (_data.empty() || !_data.isColumnLoaded(column))
+		loadData(); // loads the data from disk (all columns if only some were loaded).
+    this->_data.setAt(line, column, value);
+    invalidateColumnStatistics(column);
 }
 
 std::vector<double> DataFile::getDataColumn(uint column)
 {
-    loadData();
-    std::vector<double> result;
-    uint nLines = getDataLineCount();
-    result.reserve( nLines );
-    for( uint i = 0; i < nLines; ++i)
-        result.push_back( data(i, column) );
-    return result;
+    // a partial load is kept if it has the column
+    if (!_data.hasUnloadedColumns() || !_data.isColumnLoaded(column))
+        loadData();
+    DataColumnSpan values = _data.getColumn( column );
+    return std::vector<double>( values.begin(), values.end() );
+}
+
+DataColumnSpan DataFile::getDataColumnSpan(uint column)
+{
+    // a partial load is kept if it has the column
+    if (!_data.hasUnloadedColumns() || !_data.isColumnLoaded(column))
+        loadData();
+    return _data.getColumn( column );
 }
 
 double DataFile::getProportion(int variableIndex, double value0, double value1)
@@ -1346,5 +1407,14 @@ double DataFile::getProportion(int variableIndex, double value0, double value1)
 
 void DataFile::removeDataLine(uint line)
 {
-	_data.erase( _data.begin() + line );
+	_data.removeRow( line );
+	invalidateColumnStatistics();
+}
+
+void DataFile::removeDataLines(const std::vector<uint> &linesInAscendingOrder)
+{
+	if( linesInAscendingOrder.empty() )
+		return;
+	_data.removeRows( std::vector<size_t>( linesInAscendingOrder.begin(), linesInAscendingOrder.end() ) );
+	invalidateColumnStatistics();
 }
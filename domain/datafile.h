@@ -4,7 +4,10 @@
 #include "file.h"
 #include "calculator/icalcpropertycollection.h"
 #include "util.h"
+#include "auxiliary/columnardatatable.h"
+#include "auxiliary/datacolumnstatistics.h"
 #include <vector>
+#include <set>
 #include <QMap>
 #include <QDateTime>
 #include <complex>
@@ -37,6 +40,14 @@ public:
       */
     void loadData();
 
+    /**
+      *  Loads only the given data columns (0 = 1st column) into the _data table.  The other columns are
+      *  skipped while parsing, so memory and time are saved when only a few variables of a wide file are needed.
+      *  The column indexes remain those of the file.  Calling loadData() or accessing a column that is not loaded
+      *  (e.g. with data()) triggers a reload of all columns.  writeToFS() fails while only some columns are loaded.
+      */
+    void loadData( const std::set<uint>& columns );
+
     /**
       *  Returns the data at the given position.
       *  This does not follow GEO_EAS convention, so the first data value, at the first line and first column of the file
@@ -82,6 +93,14 @@ public:
      */
     double mean( uint column );
 
+    /**
+     * Returns the summary statistics of the valid values in the given column (first column is 0).
+     * The statistics used by min(), max(), mean(), variance(), etc. are computed in a single pass when first needed
+     * and kept until the data change (e.g. with setData(), removeDataLine() or a data reload), so consecutive
+     * calls for the same column do not rescan it.
+     */
+    const DataColumnStatistics& getColumnStatistics( uint column );
+
     /**
      * Returns the index of the given field in GEO-EAS convention (first is 1).
      * If the given field name does not exist, returns zero.
@@ -256,6 +275,8 @@ public:
      * To read all data lines in the file, set any interval that will surely include
      * all data lines such as 0 and std::numeric_limits<long>::max().
      * Setting a data page also helps in selecting a realization or range of realizations in Cartesian grids.
+     * The first paged load of a file builds its line index (see DataLineIndex), so the next paged loads
+     * read only the lines around the page instead of scanning the file from the beginning.
      */
     void setDataPage( long firstDataLine, long lastDataLine );
 
@@ -349,6 +370,12 @@ public:
 	 */
 	void removeDataLine( uint line );
 
+	/** Removes the given data lines from the internal data array in a single pass, keeping the order of the
+	 * remaining lines.  The line numbers must be in ascending order.
+	 * It is necessary to call writeToFS() to commit the change to filesystem.
+	 */
+	void removeDataLines( const std::vector<uint>& linesInAscendingOrder );
+
     /** Returns the loaded values for a variable given its column index (GEO-EAS index - 1).
      * May return an empty container if data is not loaded or less elements than records in the
      * physical file if it has been paged (e.g. file with multiple simulation realizations, see
@@ -356,6 +383,12 @@ public:
      */
     std::vector< double > getDataColumn( uint column );
 
+    /** Returns a zero-copy view of the loaded values of a variable given its column index (GEO-EAS index - 1).
+     * Data are loaded on demand.  The view becomes invalid if data are reloaded, freed or
+     * rows/columns are added or removed.
+     */
+    DataColumnSpan getDataColumnSpan( uint column );
+
     /**
      * Returns the proportion of the values that fall in the given interval.
      * To count discrete values (e.g. facies codes) just make them equal.
@@ -388,11 +421,14 @@ public:
      */
     std::vector< std::vector< std::vector<double> > > getDataGroupedBy( int variableIndex ) const;
 
-    /** Returns a read-only reference to the internal data table. */
-    const std::vector< std::vector<double> >& getDataTable() const { return _data; }
+    /** Returns a row-major copy of the internal data table (outer vector are rows of data). */
+    std::vector< std::vector<double> > getDataTable() const { return _data.toRows(); }
 
-    /** Returns a read-only reference to a data row. */
-    const std::vector<double>& getDataRow( int rowIndex ) const;
+    /** Returns a read-only reference to the internal (columnar) data table. */
+    const ColumnarDataTable& getColumnarDataTable() const { return _data; }
+
+    /** Returns a copy of the values in a data row. */
+    std::vector<double> getDataRow( int rowIndex ) const;
 
     /**
      * Returns a new data table filtered by the given data column.
@@ -438,11 +474,9 @@ public:
 protected:
 
     /**
-     * The data table.  A matrix of doubles.
-     * Outer vector are rows of data.
-     * Inner vector are values in a row of data.
+     * The data table.  A matrix of doubles stored column by column (see ColumnarDataTable).
      */
-	std::vector< std::vector<double> > _data;
+	ColumnarDataTable _data;
 
     /** The no-data value specified by the user. */
     QString _no_data_value;
@@ -476,6 +510,34 @@ protected:
     /** The pointer to the internal interface to the algorithms' data source (see classes in /algorithms subdirectory). */
     std::shared_ptr<IAlgorithmDataSource> _algorithmDataSourceInterface;
 
+    /**
+     * Returns whether the given data column (0 = 1st column) can be kept in memory in single precision
+     * when the user enables it (see Application::getDataFileSinglePrecisionSetting()).
+     * Default is false, subclasses with bulky data return true for their continuous variables.
+     */
+    virtual bool canBeInSinglePrecision( uint /*column*/ ) const { return false; }
+
+    /**
+     * Reduces the memory taken by the loaded data: categorical variables are stored as 8 or 16-bit
+     * integers and, if enabled in the settings, continuous variables are stored in single precision.
+     * Values are widened back to double when read.  Called at the end of loadData().
+     */
+    void narrowDataColumns();
+
+    /** Discards the statistics of all columns (see getColumnStatistics()).  Must be called
+     * whenever _data is changed directly by subclasses. */
+    void invalidateColumnStatistics();
+
+    /** Discards the statistics of the given column (see getColumnStatistics()). */
+    void invalidateColumnStatistics( uint column );
+
+private:
+    /** The statistics of the data columns computed so far (see getColumnStatistics()). */
+    std::vector< DataColumnStatistics > _columnStatistics;
+
+    /** Implements the loadData() methods.  An empty columnsToLoad means all columns. */
+    void loadDataColumns( const std::vector<bool>& columnsToLoad );
+
 };
 
 #endif // DATAFILE_H
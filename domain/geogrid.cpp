@@ -6,6 +6,7 @@
 #include "spatialindex/spatialindex.h"
 #include "domain/application.h"
 #include "auxiliary/meshloader.h"
+#include "auxiliary/geogridcelllocator.h"
 #include "domain/pointset.h"
 #include "domain/segmentset.h"
 #include "util.h"
@@ -22,10 +23,20 @@
 #include <QThread>
 
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+/** The maximum number of steps of the walks in GeoGrid::locateCell(). */
+const uint MAX_WALK_STEPS = 16;
+}
 
 GeoGrid::GeoGrid( QString path ) :
 	GridFile( path ),
 	m_spatialIndex( new SpatialIndex() ),
+	m_cellLocator(),
+	m_lastLocatedCell( 0 ),
 	m_lastModifiedDateTimeLastMeshLoad()
 {
 	this->_no_data_value = "";
@@ -38,6 +49,8 @@ GeoGrid::GeoGrid( QString path ) :
 GeoGrid::GeoGrid(QString path, Attribute * atTop, Attribute * atBase, uint nHorizonSlices) :
 	GridFile( path ),
 	m_spatialIndex( new SpatialIndex() ),
+	m_cellLocator(),
+	m_lastLocatedCell( 0 ),
 	m_lastModifiedDateTimeLastMeshLoad()
 {
 	CartesianGrid *cgTop = dynamic_cast<CartesianGrid*>( atTop->getContainingFile() );
@@ -52,8 +65,14 @@ GeoGrid::GeoGrid(QString path, Attribute * atTop, Attribute * atBase, uint nHori
 	uint nKVertexes = nHorizonSlices + 1;
 	uint nVertexes = nIVertexes * nJVertexes * nKVertexes;
 
-	//allocate the vertex list
-	m_vertexesPart.reserve( nVertexes );
+	//define the number of cells (cell centered values, one less than the number of vertexes in each direction )
+	uint nICells = cgBase->getNI()-1;
+	uint nJCells = cgBase->getNJ()-1;
+	uint nKCells = nHorizonSlices;
+	uint nCells = nICells * nJCells * nKCells;
+
+	//allocate the mesh arrays
+	m_mesh.reserve( nVertexes, nCells );
 
 	//get the indexes of the properties holding the top and base values.
 	uint columnIndexBase = atBase->getAttributeGEOEASgivenIndex()-1;
@@ -69,42 +88,29 @@ GeoGrid::GeoGrid(QString path, Attribute * atTop, Attribute * atBase, uint nHori
 				//compute the depth (z) of the current vertex.
 				double depth = vBase + ( k / (double)nHorizonSlices ) * ( vTop - vBase );
 				//create and set the position of the vertex
-				VertexRecordPtr vertex( new VertexRecord() );
 				double x, y, z;
 				cgBase->IJKtoXYZ( i, j, 0, x, y, z );
-				vertex->X = x;
-				vertex->Y = y;
-				vertex->Z = depth;
-				m_vertexesPart.push_back( vertex );
+				m_mesh.appendVertex( x, y, depth );
 			}
 		}
 	}
 
-	//define the number of cells (cell centered values, one less than the number of vertexes in each direction )
-	uint nICells = cgBase->getNI()-1;
-	uint nJCells = cgBase->getNJ()-1;
-	uint nKCells = nHorizonSlices;
-	uint nCells = nICells * nJCells * nKCells;
-
-	//allocate the cell definition list
-	m_cellDefsPart.reserve( nCells );
-
 	//assign vertexes id's to the cells
 	for( uint k = 0; k < nKCells; ++k ){
 		for( uint j = 0; j < nJCells; ++j ){
 			for( uint i = 0; i < nICells; ++i ){
-				CellDefRecordPtr cellDef( new CellDefRecord() );
-				//see Doxygen of CellDefRecordPtr in geogrid.h for a diagram of vertex arrangement in space
+				uint32_t vId[8];
+				//see Doxygen of GeoGridMesh for a diagram of vertex arrangement in space
 				// and how they form the edges and faces of the visual representation of the cell.
-				cellDef->vId[0] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
-				cellDef->vId[1] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
-				cellDef->vId[2] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
-				cellDef->vId[3] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
-				cellDef->vId[4] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
-				cellDef->vId[5] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
-				cellDef->vId[6] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
-				cellDef->vId[7] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
-				m_cellDefsPart.push_back( cellDef );
+				vId[0] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
+				vId[1] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
+				vId[2] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
+				vId[3] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
+				vId[4] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
+				vId[5] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
+				vId[6] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
+				vId[7] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
+				m_mesh.appendCell( vId );
 			}
 		}
 	}
@@ -120,6 +126,8 @@ GeoGrid::GeoGrid(QString path, Attribute * atTop, Attribute * atBase, uint nHori
 GeoGrid::GeoGrid(QString path, std::vector<GeoGridZone> zones) :
     GridFile( path ),
     m_spatialIndex( new SpatialIndex() ),
+    m_cellLocator(),
+    m_lastLocatedCell( 0 ),
     m_lastModifiedDateTimeLastMeshLoad()
 {
     //get origin Cartesian grid and do some sanity checks
@@ -143,8 +151,16 @@ GeoGrid::GeoGrid(QString path, std::vector<GeoGridZone> zones) :
         nKVertexes += zone.nHorizonSlices + 1;
     uint nVertexes = nIVertexes * nJVertexes * nKVertexes;
 
-    //allocate the vertex list
-    m_vertexesPart.reserve( nVertexes );
+    //define the number of cells (cell centered values, one less than the number of vertexes in each direction )
+    uint nICells = cg->getNI()-1;
+    uint nJCells = cg->getNJ()-1;
+    uint nKCells = 0;
+    for( const GeoGridZone zone : zones )
+        nKCells += zone.nHorizonSlices;
+    uint nCells = nICells * nJCells * nKCells;
+
+    //allocate the mesh arrays
+    m_mesh.reserve( nVertexes, nCells );
 
     //traverse the collection of zones from bottommost to topmost (reverse of user-entered order)
     for ( std::vector<GeoGridZone>::const_reverse_iterator iZone = zones.crbegin(); iZone != zones.crend(); ++iZone ) {
@@ -166,29 +182,14 @@ GeoGrid::GeoGrid(QString path, std::vector<GeoGridZone> zones) :
                     //compute the depth (z) of the current vertex.
                     double depth = vBase + ( k / (double)zone.nHorizonSlices ) * ( vTop - vBase );
                     //create and set the position of the vertex
-                    VertexRecordPtr vertex( new VertexRecord() );
                     double x, y, z;
                     cg->IJKtoXYZ( i, j, 0, x, y, z );
-                    vertex->X = x;
-                    vertex->Y = y;
-                    vertex->Z = depth;
-                    m_vertexesPart.push_back( vertex );
+                    m_mesh.appendVertex( x, y, depth );
                 }
             }
         }
     }
 
-    //define the number of cells (cell centered values, one less than the number of vertexes in each direction )
-    uint nICells = cg->getNI()-1;
-    uint nJCells = cg->getNJ()-1;
-    uint nKCells = 0;
-    for( const GeoGridZone zone : zones )
-        nKCells += zone.nHorizonSlices;
-    uint nCells = nICells * nJCells * nKCells;
-
-    //allocate the cell definition list
-    m_cellDefsPart.reserve( nCells );
-
     uint vertexKoffset = 0;
     for( const GeoGridZone zone : zones ){
         uint nKCellsZone = zone.nHorizonSlices;
@@ -196,18 +197,18 @@ GeoGrid::GeoGrid(QString path, std::vector<GeoGridZone> zones) :
         for( uint k = 0; k < nKCellsZone; ++k ){
             for( uint j = 0; j < nJCells; ++j ){
                 for( uint i = 0; i < nICells; ++i ){
-                    CellDefRecordPtr cellDef( new CellDefRecord() );
-                    //see Doxygen of CellDefRecordPtr in geogrid.h for a diagram of vertex arrangement in space
+                    uint32_t vId[8];
+                    //see Doxygen of GeoGridMesh for a diagram of vertex arrangement in space
                     // and how they form the edges and faces of the visual representation of the cell.
-                    cellDef->vId[0] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
-                    cellDef->vId[1] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
-                    cellDef->vId[2] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
-                    cellDef->vId[3] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
-                    cellDef->vId[4] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
-                    cellDef->vId[5] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
-                    cellDef->vId[6] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
-                    cellDef->vId[7] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
-                    m_cellDefsPart.push_back( cellDef );
+                    vId[0] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
+                    vId[1] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
+                    vId[2] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
+                    vId[3] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
+                    vId[4] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
+                    vId[5] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
+                    vId[6] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
+                    vId[7] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
+                    m_mesh.appendCell( vId );
                 }
             }
         }
@@ -231,18 +232,17 @@ void GeoGrid::getBoundingBox(uint cellIndex,
 	minX = minY = minZ = std::numeric_limits<double>::max();
 	maxX = maxY = maxZ = std::numeric_limits<double>::min();
 	//Get the cell
-	CellDefRecordPtr cellDef = m_cellDefsPart.at( cellIndex );
+	assert( cellIndex < m_mesh.getCellCount() && "GeoGrid::getBoundingBox(): cell index out of range." );
+	const uint32_t* vIds = m_mesh.getCellVertexIds( cellIndex );
 	//for each of the eight vertexes of the cell
 	for( uint i = 0; i < 8; ++i ){
-		//Get the vertex
-		VertexRecordPtr vertex = m_vertexesPart.at( cellDef->vId[i] );
 		//set the max's and min's
-		minX = std::min( minX, vertex->X );
-		minY = std::min( minY, vertex->Y );
-		minZ = std::min( minZ, vertex->Z );
-		maxX = std::max( maxX, vertex->X );
-		maxY = std::max( maxY, vertex->Y );
-		maxZ = std::max( maxZ, vertex->Z );
+		minX = std::min( minX, m_mesh.getX( vIds[i] ) );
+		minY = std::min( minY, m_mesh.getY( vIds[i] ) );
+		minZ = std::min( minZ, m_mesh.getZ( vIds[i] ) );
+		maxX = std::max( maxX, m_mesh.getX( vIds[i] ) );
+		maxY = std::max( maxY, m_mesh.getY( vIds[i] ) );
+		maxZ = std::max( maxZ, m_mesh.getZ( vIds[i] ) );
 	}
 }
 
@@ -254,58 +254,28 @@ QString GeoGrid::getMeshFilePath()
 
 void GeoGrid::saveMesh()
 {
-	if( m_vertexesPart.empty() || m_vertexesPart.empty() ){
+	if( m_mesh.empty() ){
 		Application::instance()->logInfo("GeoGrid::saveMesh(): No mesh or mesh not loaded.  Nothing done.");
 		return;
 	}
 
-	//close mesh file and write header
-	QFile file( this->getMeshFilePath() );
-	file.open( QFile::WriteOnly | QFile::Text );
-	QTextStream out(&file);
-	out << APP_NAME << " GeoGrid mesh file.  This file is generated automatically.  Do not edit this file.\n";
-	out << "version=" << APP_VERSION << '\n';
-
-	out << "VERTEX LOCATIONS:\n";
-	{
-		std::vector< VertexRecordPtr >::iterator it = m_vertexesPart.begin();
-		for( ; it != m_vertexesPart.end(); ++it ){
-			//making sure the values are written in GSLib-like precision
-			std::stringstream ss;
-			ss << std::setprecision( 12 ) << (*it)->X << ';';
-			ss << std::setprecision( 12 ) << (*it)->Y << ';';
-			ss << std::setprecision( 12 ) << (*it)->Z ;
-			out << ss.str().c_str() << '\n';
-		}
-	}
-
-	out << "CELL VERTEX INDEXES:\n";
-	{
-		std::vector< CellDefRecordPtr >::iterator it = m_cellDefsPart.begin();
-		for( ; it != m_cellDefsPart.end(); ++it ){
-			std::stringstream ss;
-			for( int i = 0; i < 7; ++i)
-				ss << (*it)->vId[i] << ';';
-			ss << (*it)->vId[7];
-			out << ss.str().c_str() << "\n";
-		}
+	if( ! m_mesh.saveBinary( this->getMeshFilePath() ) ){
+		Application::instance()->logError("GeoGrid::saveMesh(): Failed to save the mesh.");
+		return;
 	}
 
-	//close mesh file
-	file.close();
+	//the saved mesh is the one in memory, so there is no need to reload it.
+	m_lastModifiedDateTimeLastMeshLoad = QFileInfo( this->getMeshFilePath() ).lastModified();
 
 	Application::instance()->logInfo("GeoGrid::saveMesh(): Mesh saved.");
 }
 
 void GeoGrid::loadMesh()
 {
-	QFile file( this->getMeshFilePath() );
-	file.open(QFile::ReadOnly | QFile::Text);
-	uint data_line_count = 0;
 	QFileInfo info( this->getMeshFilePath() );
 
 	// if loaded mesh is not empty and was loaded before
-	if ( (!m_cellDefsPart.empty() || !m_vertexesPart.empty() ) && !m_lastModifiedDateTimeLastMeshLoad.isNull()) {
+	if ( !m_mesh.empty() && !m_lastModifiedDateTimeLastMeshLoad.isNull()) {
 		QDateTime currentLastModified = info.lastModified();
 		// if modified datetime didn't change since last call to loadMesh
 		if (currentLastModified <= m_lastModifiedDateTimeLastMeshLoad) {
@@ -317,32 +287,132 @@ void GeoGrid::loadMesh()
 		}
 	}
 
-	// record the current datetime of file change
-	m_lastModifiedDateTimeLastMeshLoad = info.lastModified();
+	// the current datetime of file change, recorded if the mesh is loaded successfully
+	QDateTime lastModified = info.lastModified();
 
 	Application::instance()->logInfo(
 		QString("Loading mesh from ").append( this->getMeshFilePath() ).append("..."));
 
 	// make sure mesh data is empty
-	m_cellDefsPart.clear();
-	m_vertexesPart.clear();
-	std::vector< CellDefRecordPtr >().swap( m_cellDefsPart ); //clear() may not actually free memory
-	std::vector< VertexRecordPtr >().swap( m_vertexesPart ); //clear() may not actually free memory
+	m_mesh.clear();
+	m_cellLocator.reset();
+
+	if( GeoGridMesh::isBinaryFile( this->getMeshFilePath() ) ){
+		// binary mesh files are mapped in memory and copied into the mesh arrays, which is fast
+		// enough to not need a progress dialog.
+		if( ! m_mesh.loadBinary( this->getMeshFilePath() ) ){
+			m_mesh.clear();
+			Application::instance()->logError( "GeoGrid::loadMesh(): failed to load the mesh file " +
+											   this->getMeshFilePath() + " (missing, unreadable or corrupt).");
+			return;
+		}
+	} else {
+		// mesh file in the text format of older versions
+		loadMeshFromText( this->getMeshFilePath() );
+		// converts it to the binary format so the next loads are faster
+		if( ! m_mesh.empty() ){
+			Application::instance()->logInfo("GeoGrid::loadMesh(): converting the mesh file to binary format.");
+			saveMesh();
+		}
+	}
+
+	// record the datetime of file change
+	m_lastModifiedDateTimeLastMeshLoad = lastModified;
+
+	Application::instance()->logInfo("Finished loading mesh.");
+}
+
+bool GeoGrid::exportMeshAsText(const QString &path)
+{
+	loadMesh();
+
+	if( m_mesh.empty() ){
+		Application::instance()->logError("GeoGrid::exportMeshAsText(): No mesh.  Nothing done.");
+		return false;
+	}
+
+	//open the output file and write header
+	QFile file( path );
+	if( ! file.open( QFile::WriteOnly | QFile::Text ) ){
+		Application::instance()->logError("GeoGrid::exportMeshAsText(): could not open " + path + " for writing.");
+		return false;
+	}
+	QTextStream out(&file);
+	out << APP_NAME << " GeoGrid mesh file.  This file is generated automatically.  Do not edit this file.\n";
+	out << "version=" << APP_VERSION << '\n';
+
+	out << "VERTEX LOCATIONS:\n";
+	for( uint32_t iVertex = 0; iVertex < m_mesh.getVertexCount(); ++iVertex ){
+		//making sure the values are written in GSLib-like precision
+		std::stringstream ss;
+		ss << std::setprecision( 12 ) << m_mesh.getX( iVertex ) << ';';
+		ss << std::setprecision( 12 ) << m_mesh.getY( iVertex ) << ';';
+		ss << std::setprecision( 12 ) << m_mesh.getZ( iVertex ) ;
+		out << ss.str().c_str() << '\n';
+	}
+
+	out << "CELL VERTEX INDEXES:\n";
+	for( size_t iCell = 0; iCell < m_mesh.getCellCount(); ++iCell ){
+		const uint32_t* vIds = m_mesh.getCellVertexIds( iCell );
+		std::stringstream ss;
+		for( int i = 0; i < 7; ++i)
+			ss << vIds[i] << ';';
+		ss << vIds[7];
+		out << ss.str().c_str() << "\n";
+	}
+
+	//close mesh file
+	file.close();
+
+	Application::instance()->logInfo("GeoGrid::exportMeshAsText(): Mesh exported to " + path + ".");
+	return true;
+}
+
+bool GeoGrid::importMeshFromText(const QString &path)
+{
+	GeoGridMesh previousMesh;
+	std::swap( previousMesh, m_mesh );
+
+	loadMeshFromText( path );
+
+	if( m_mesh.getCellCount() != m_nI * m_nJ * m_nK ){
+		Application::instance()->logError( QString("GeoGrid::importMeshFromText(): the mesh in ").append( path )
+										   .append(" has ").append( QString::number( m_mesh.getCellCount() ) )
+										   .append(" cells instead of ").append( QString::number( m_nI * m_nJ * m_nK ) )
+										   .append(".  Import canceled.") );
+		std::swap( previousMesh, m_mesh );
+		return false;
+	}
+
+	//the cell geometries changed
+	resetCellSearch();
+
+	saveMesh();
+	return true;
+}
+
+void GeoGrid::loadMeshFromText(const QString &path)
+{
+	QFile file( path );
+	file.open(QFile::ReadOnly | QFile::Text);
+	uint data_line_count = 0;
+
+	m_mesh.clear();
 
 	// mesh load takes place in another thread, so we can show and update a progress bar
 	//////////////////////////////////
 	QProgressDialog progressDialog;
 	progressDialog.show();
-	progressDialog.setLabelText("Loading and parsing mesh file " + this->getMeshFilePath() + "...");
+	progressDialog.setLabelText("Loading and parsing mesh file " + path + "...");
 	progressDialog.setMinimum(0);
 	progressDialog.setValue(0);
-	progressDialog.setMaximum(getFileSize() / 100); // see MeshLoader::doLoad(). Dividing
-													// by 100 allows a max value of ~400GB
-													// when converting from long to int
+	progressDialog.setMaximum(file.size() / 100); // see MeshLoader::doLoad(). Dividing
+												  // by 100 allows a max value of ~400GB
+												  // when converting from long to int
 	QThread *thread = new QThread(); // does it need to set parent (a QObject)?
-	MeshLoader *ml = new MeshLoader(file, m_vertexesPart, m_cellDefsPart, data_line_count ); // Do not set a parent. The object
-																							 // cannot be moved if it has a
-																							 // parent.
+	MeshLoader *ml = new MeshLoader(file, m_mesh, data_line_count ); // Do not set a parent. The object
+																	 // cannot be moved if it has a
+																	 // parent.
 	ml->moveToThread(thread);
 	ml->connect(thread, SIGNAL(finished()), ml, SLOT(deleteLater()));
 	ml->connect(thread, SIGNAL(started()), ml, SLOT(doLoad()));
@@ -359,7 +429,11 @@ void GeoGrid::loadMesh()
 
 	file.close();
 
-	Application::instance()->logInfo("Finished loading mesh.");
+	// cells without vertexes cannot be used
+	if( m_mesh.getCellCount() > 0 && m_mesh.getVertexCount() == 0 ){
+		Application::instance()->logError("GeoGrid::loadMeshFromText(): the mesh in " + path + " has no vertexes.");
+		m_mesh.clear();
+	}
 }
 
 void GeoGrid::setInfoFromMetadataFile()
@@ -434,32 +508,27 @@ void GeoGrid::setInfo(int nI, int nJ, int nK, int nreal, const QString no_data_v
 uint GeoGrid::getMeshNumberOfVertexes()
 {
 	this->loadMesh();
-	return m_vertexesPart.size();
+	return m_mesh.getVertexCount();
 }
 
 void GeoGrid::getMeshVertexLocation(uint index, double & x, double & y, double & z)
 {
-	x = m_vertexesPart[index]->X;
-	y = m_vertexesPart[index]->Y;
-	z = m_vertexesPart[index]->Z;
+	x = m_mesh.getX( index );
+	y = m_mesh.getY( index );
+	z = m_mesh.getZ( index );
 }
 
 uint GeoGrid::getMeshNumberOfCells()
 {
 	this->loadMesh();
-	return m_cellDefsPart.size();
+	return m_mesh.getCellCount();
 }
 
 void GeoGrid::getMeshCellDefinition(uint index, uint (&vIds)[8])
 {
-	vIds[0] = m_cellDefsPart[index]->vId[0];
-	vIds[1] = m_cellDefsPart[index]->vId[1];
-	vIds[2] = m_cellDefsPart[index]->vId[2];
-	vIds[3] = m_cellDefsPart[index]->vId[3];
-	vIds[4] = m_cellDefsPart[index]->vId[4];
-	vIds[5] = m_cellDefsPart[index]->vId[5];
-	vIds[6] = m_cellDefsPart[index]->vId[6];
-    vIds[7] = m_cellDefsPart[index]->vId[7];
+	const uint32_t* cellVIds = m_mesh.getCellVertexIds( index );
+	for( int i = 0; i < 8; ++i )
+		vIds[i] = cellVIds[i];
 }
 
 PointSet *GeoGrid::unfold( PointSet *inputPS, QString nameForNewPointSet )
@@ -499,23 +568,26 @@ PointSet *GeoGrid::unfold( PointSet *inputPS, QString nameForNewPointSet )
     uint xIndex = result->getXindex() - 1; //first GEO-EAS index = 1
     uint yIndex = result->getYindex() - 1;
     uint zIndex = result->getZindex() - 1;
+    std::vector<double> x( nSamples ), y( nSamples ), z( nSamples );
+    for( uint iSample = 0; iSample < nSamples; ++iSample ){
+        //get the XYZ location of the sample
+        x[iSample] = result->data( iSample, xIndex );
+        y[iSample] = result->data( iSample, yIndex );
+        z[iSample] = result->data( iSample, zIndex );
+    }
+    //get the UVW coordinates of all samples at once
+    std::vector<double> u, v, w;
+    std::vector<bool> found;
+    XYZtoUVW( x, y, z, u, v, w, found );
     std::vector<uint> samplesToRemove;
 	bool empty = true;
     for( uint iSample = 0; iSample < nSamples; ++iSample ){
-        //get the XYZ location of the sample
-        double x = result->data( iSample, xIndex );
-        double y = result->data( iSample, yIndex );
-        double z = result->data( iSample, zIndex );
-        //get the UVW coordinates
-		double u = -1.0;
-		double v = -1.0;
-		double w = -1.0;
-        if( XYZtoUVW( x, y, z, u, v, w ) ){
+        if( found[iSample] ){
 			empty = false;
 			//assign them to the point set
-			result->setData( iSample, nColumns - 3, u );
-			result->setData( iSample, nColumns - 2, v );
-			result->setData( iSample, nColumns - 1, w );
+			result->setData( iSample, nColumns - 3, u[iSample] );
+			result->setData( iSample, nColumns - 2, v[iSample] );
+			result->setData( iSample, nColumns - 1, w[iSample] );
 		} else {
             //a cell was not found (likely the sample is outside the grid)
             //so mark the sample for removal
@@ -528,10 +600,7 @@ PointSet *GeoGrid::unfold( PointSet *inputPS, QString nameForNewPointSet )
                      result->getWeightsVariablesPairs(), result->getNSVarVarTrnTriads(), result->getCategoricalAttributes() );
 
 	//remove the samples with invalid UVW coordinates
-	std::vector<uint>::iterator it = samplesToRemove.begin();
-	uint offset = 0; //adjust for previously deleted lines.
-	for( ; it != samplesToRemove.end(); ++it, ++offset )
-		result->removeDataLine( *it - offset );
+	result->removeDataLines( samplesToRemove );
 
 	//if no data remained
 	if( empty ){
@@ -596,33 +665,34 @@ SegmentSet *GeoGrid::unfold(SegmentSet *inputSS, QString nameForNewSegmentSet)
     uint xFIndex = result->getXFinalIndex() - 1;
     uint yFIndex = result->getYFinalIndex() - 1;
     uint zFIndex = result->getZFinalIndex() - 1;
+    std::vector<double> xi( nSamples ), yi( nSamples ), zi( nSamples );
+    std::vector<double> xf( nSamples ), yf( nSamples ), zf( nSamples );
+    for( uint iSample = 0; iSample < nSamples; ++iSample ){
+        //get the XYZ locations of the sample
+        xi[iSample] = result->data( iSample, xIIndex );
+        yi[iSample] = result->data( iSample, yIIndex );
+        zi[iSample] = result->data( iSample, zIIndex );
+        xf[iSample] = result->data( iSample, xFIndex );
+        yf[iSample] = result->data( iSample, yFIndex );
+        zf[iSample] = result->data( iSample, zFIndex );
+    }
+    //get the UVW coordinates of all initial ends, then of all final ends
+    std::vector<double> ui, vi, wi, uf, vf, wf;
+    std::vector<bool> foundI, foundF;
+    XYZtoUVW( xi, yi, zi, ui, vi, wi, foundI );
+    XYZtoUVW( xf, yf, zf, uf, vf, wf, foundF );
     std::vector<uint> samplesToRemove;
     bool empty = true;
     for( uint iSample = 0; iSample < nSamples; ++iSample ){
-        //get the XYZ locations of the sample
-        double xi = result->data( iSample, xIIndex );
-        double yi = result->data( iSample, yIIndex );
-        double zi = result->data( iSample, zIIndex );
-        double xf = result->data( iSample, xFIndex );
-        double yf = result->data( iSample, yFIndex );
-        double zf = result->data( iSample, zFIndex );
-        //get the UVW coordinates
-        double ui = -1.0;
-        double vi = -1.0;
-        double wi = -1.0;
-        double uf = -1.0;
-        double vf = -1.0;
-        double wf = -1.0;
-        if( XYZtoUVW( xi, yi, zi, ui, vi, wi ) &&
-            XYZtoUVW( xf, yf, zf, uf, vf, wf ) ){
+        if( foundI[iSample] && foundF[iSample] ){
             empty = false;
             //assign them to the point set
-            result->setData( iSample, nColumns - 6, ui );
-            result->setData( iSample, nColumns - 5, vi );
-            result->setData( iSample, nColumns - 4, wi );
-            result->setData( iSample, nColumns - 3, uf );
-            result->setData( iSample, nColumns - 2, vf );
-            result->setData( iSample, nColumns - 1, wf );
+            result->setData( iSample, nColumns - 6, ui[iSample] );
+            result->setData( iSample, nColumns - 5, vi[iSample] );
+            result->setData( iSample, nColumns - 4, wi[iSample] );
+            result->setData( iSample, nColumns - 3, uf[iSample] );
+            result->setData( iSample, nColumns - 2, vf[iSample] );
+            result->setData( iSample, nColumns - 1, wf[iSample] );
         } else {
             //a cell was not found (likely one or both ends of a sample is outside the grid)
             //so mark the sample for removal
@@ -636,10 +706,7 @@ SegmentSet *GeoGrid::unfold(SegmentSet *inputSS, QString nameForNewSegmentSet)
                      result->getWeightsVariablesPairs(), result->getNSVarVarTrnTriads(), result->getCategoricalAttributes() );
 
     //remove the samples with invalid UVW coordinates
-    std::vector<uint>::iterator it = samplesToRemove.begin();
-    uint offset = 0; //adjust for previously deleted lines.
-    for( ; it != samplesToRemove.end(); ++it, ++offset )
-        result->removeDataLine( *it - offset );
+    result->removeDataLines( samplesToRemove );
 
     //if no data remained
     if( empty ){
@@ -663,35 +730,30 @@ bool GeoGrid::XYZtoUVW(double x, double y, double z, double &u, double &v, doubl
 {
     // https://math.stackexchange.com/questions/13404/mapping-irregular-quadrilateral-to-a-rectangle
 
-	//Obtain the topological coordinates (IJK) of the cell that contains the location.
-	uint i, j, k;
-	if( ! XYZtoIJK( x, y, z, i, j, k ) )
+	if( ! prepareCellSearch() )
 		return false;
 
-	//Obtain the index of the cell.
-	uint cellIndex = IJKtoIndex( i, j, k );
-
-	//Make a point object corresponding to the query location.
-	Vertex3D location{ x, y, z };
+	//Obtain the index of the cell that contains the location.
+	uint cellIndex = m_lastLocatedCell;
+	if( ! locateCell( x, y, z, cellIndex ) )
+		return false;
+	m_lastLocatedCell = cellIndex;
 
-	//Get the faces' geometries of the cell.
-	std::vector<Face3D> cellFaces = getFaces( cellIndex );
+	getUVW( cellIndex, x, y, z, u, v, w );
+	return true;
+}
 
-	//faces 2 and 3 are along I direction, thus are respect to U depositional coordinate
-	//faces 4 and 5 are along J direction, thus are respect to V depositional coordinate
-	//faces 0 and 1 are along K direction, thus are respect to W depositional coordinate
-	//compute the six distances between the location and the faces
-	double dU0 = cellFaces[2].distance( location );
-	double dU1 = cellFaces[3].distance( location );
-	double dV0 = cellFaces[4].distance( location );
-	double dV1 = cellFaces[5].distance( location );
-	double dW0 = cellFaces[0].distance( location );
-	double dW1 = cellFaces[1].distance( location );
+void GeoGrid::getUVW(uint cellIndex, double x, double y, double z, double &u, double &v, double &w) const
+{
+	//Obtain the topological coordinates (IJK) of the cell.
+	uint i = cellIndex % m_nI;
+	uint j = ( cellIndex / m_nI ) % m_nJ;
+	uint k = cellIndex / ( m_nI * m_nJ );
 
-	//compute the UVW within the cell (min = 0.0, max = 1.0)
-	double local_u = dU0 / (dU0 + dU1);
-	double local_v = dV0 / (dV0 + dV1);
-	double local_w = dW0 / (dW0 + dW1);
+	//compute the UVW within the cell (min = 0.0, max = 1.0) from the distances between the location
+	//and the faces of the cell.
+	double local_u, local_v, local_w;
+	m_cellLocator->getLocalUVW( cellIndex, x, y, z, local_u, local_v, local_w );
 
 	//compute the global UVW steps.
 	double du = 1.0 / m_nI;
@@ -702,57 +764,97 @@ bool GeoGrid::XYZtoUVW(double x, double y, double z, double &u, double &v, doubl
 	u = du * i + du * local_u;
 	v = dv * j + dv * local_v;
 	w = dw * k + dw * local_w;
+}
 
-	return true;
+void GeoGrid::XYZtoUVW(const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &z,
+                       std::vector<double> &u, std::vector<double> &v, std::vector<double> &w,
+                       std::vector<bool> &found)
+{
+    assert( x.size() == y.size() && x.size() == z.size() && "GeoGrid::XYZtoUVW(): coordinate vectors of different sizes.");
+
+    size_t n = x.size();
+    u.assign( n, -1.0 );
+    v.assign( n, -1.0 );
+    w.assign( n, -1.0 );
+    found.assign( n, false );
+    if( n == 0 || ! prepareCellSearch() )
+        return;
+
+    //The locations are processed in parallel in blocks of consecutive locations.  Within a block, each
+    //search starts from the cell of the previous location.  The first search of every block starts from the
+    //first cell, so the result does not depend on the number of threads or on which thread gets which block.
+    const size_t LOCATIONS_PER_BLOCK = 4096;
+    size_t nBlocks = ( n + LOCATIONS_PER_BLOCK - 1 ) / LOCATIONS_PER_BLOCK;
+    std::vector<char> inside( n, 0 ); //std::vector<bool> cannot be written by several threads
+    std::atomic< size_t > nextBlock( 0 );
+    auto unfoldBlocks = [&](){
+        for( size_t iBlock = nextBlock++; iBlock < nBlocks; iBlock = nextBlock++ ){
+            uint cellIndex = 0;
+            size_t last = std::min( ( iBlock + 1 ) * LOCATIONS_PER_BLOCK, n );
+            for( size_t i = iBlock * LOCATIONS_PER_BLOCK; i < last; ++i ){
+                uint startCellIndex = cellIndex;
+                if( locateCell( x[i], y[i], z[i], cellIndex ) ){
+                    getUVW( cellIndex, x[i], y[i], z[i], u[i], v[i], w[i] );
+                    inside[i] = 1;
+                } else
+                    cellIndex = startCellIndex;
+            }
+        }
+    };
+    unsigned int nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+    std::vector< std::thread > threads;
+    for( unsigned int iThread = 1; iThread < nThreads && iThread < nBlocks; ++iThread )
+        threads.push_back( std::thread( unfoldBlocks ) );
+    unfoldBlocks(); //this thread also does its share.
+    for( std::thread& thread : threads )
+        thread.join();
+
+    for( size_t i = 0; i < n; ++i )
+        found[i] = inside[i];
 }
 
 std::vector<Face3D> GeoGrid::getFaces( uint cellIndex )
 {
 	//get the cell geometry definition (vertexes' indexes).
-	CellDefRecordPtr cellDef = m_cellDefsPart.at( cellIndex );
+	assert( cellIndex < m_mesh.getCellCount() && "GeoGrid::getFaces(): cell index out of range." );
+	const uint32_t* vIds = m_mesh.getCellVertexIds( cellIndex );
 
 	//get the vertex data of the cell
-	VertexRecordPtr vd[8];
-	vd[0] = m_vertexesPart.at( cellDef->vId[0] );
-	vd[1] = m_vertexesPart.at( cellDef->vId[1] );
-	vd[2] = m_vertexesPart.at( cellDef->vId[2] );
-	vd[3] = m_vertexesPart.at( cellDef->vId[3] );
-	vd[4] = m_vertexesPart.at( cellDef->vId[4] );
-	vd[5] = m_vertexesPart.at( cellDef->vId[5] );
-	vd[6] = m_vertexesPart.at( cellDef->vId[6] );
-	vd[7] = m_vertexesPart.at( cellDef->vId[7] );
+	Vertex3D vd[8];
+	for( int i = 0; i < 8; ++i )
+		vd[i] = Vertex3D{ m_mesh.getX( vIds[i] ), m_mesh.getY( vIds[i] ), m_mesh.getZ( vIds[i] ) };
 
 	//------------make the six face geometries------------
 	std::vector<Face3D> fs( 6 );
-	fs[0].v[0] = Vertex3D{ vd[0]->X, vd[0]->Y, vd[0]->Z };
-	fs[0].v[1] = Vertex3D{ vd[1]->X, vd[1]->Y, vd[1]->Z };
-	fs[0].v[2] = Vertex3D{ vd[2]->X, vd[2]->Y, vd[2]->Z };
-	fs[0].v[3] = Vertex3D{ vd[3]->X, vd[3]->Y, vd[3]->Z };
-
-	fs[1].v[0] = Vertex3D{ vd[4]->X, vd[4]->Y, vd[4]->Z };
-	fs[1].v[1] = Vertex3D{ vd[7]->X, vd[7]->Y, vd[7]->Z };
-	fs[1].v[2] = Vertex3D{ vd[6]->X, vd[6]->Y, vd[6]->Z };
-	fs[1].v[3] = Vertex3D{ vd[5]->X, vd[5]->Y, vd[5]->Z };
-
-	fs[2].v[0] = Vertex3D{ vd[0]->X, vd[0]->Y, vd[0]->Z };
-	fs[2].v[1] = Vertex3D{ vd[3]->X, vd[3]->Y, vd[3]->Z };
-	fs[2].v[2] = Vertex3D{ vd[7]->X, vd[7]->Y, vd[7]->Z };
-	fs[2].v[3] = Vertex3D{ vd[4]->X, vd[4]->Y, vd[4]->Z };
-
-	fs[3].v[0] = Vertex3D{ vd[1]->X, vd[1]->Y, vd[1]->Z };
-	fs[3].v[1] = Vertex3D{ vd[5]->X, vd[5]->Y, vd[5]->Z };
-	fs[3].v[2] = Vertex3D{ vd[6]->X, vd[6]->Y, vd[6]->Z };
-	fs[3].v[3] = Vertex3D{ vd[2]->X, vd[2]->Y, vd[2]->Z };
-
-	fs[4].v[0] = Vertex3D{ vd[0]->X, vd[0]->Y, vd[0]->Z };
-	fs[4].v[1] = Vertex3D{ vd[4]->X, vd[4]->Y, vd[4]->Z };
-	fs[4].v[2] = Vertex3D{ vd[5]->X, vd[5]->Y, vd[5]->Z };
-	fs[4].v[3] = Vertex3D{ vd[1]->X, vd[1]->Y, vd[1]->Z };
-
-	fs[5].v[0] = Vertex3D{ vd[3]->X, vd[3]->Y, vd[3]->Z };
-	fs[5].v[1] = Vertex3D{ vd[2]->X, vd[2]->Y, vd[2]->Z };
-	fs[5].v[2] = Vertex3D{ vd[6]->X, vd[6]->Y, vd[6]->Z };
-	fs[5].v[3] = Vertex3D{ vd[7]->X, vd[7]->Y, vd[7]->Z };
+	fs[0].v[0] = vd[0];
+	fs[0].v[1] = vd[1];
+	fs[0].v[2] = vd[2];
+	fs[0].v[3] = vd[3];
+
+	fs[1].v[0] = vd[4];
+	fs[1].v[1] = vd[7];
+	fs[1].v[2] = vd[6];
+	fs[1].v[3] = vd[5];
+
+	fs[2].v[0] = vd[0];
+	fs[2].v[1] = vd[3];
+	fs[2].v[2] = vd[7];
+	fs[2].v[3] = vd[4];
+
+	fs[3].v[0] = vd[1];
+	fs[3].v[1] = vd[5];
+	fs[3].v[2] = vd[6];
+	fs[3].v[3] = vd[2];
+
+	fs[4].v[0] = vd[0];
+	fs[4].v[1] = vd[4];
+	fs[4].v[2] = vd[5];
+	fs[4].v[3] = vd[1];
+
+	fs[5].v[0] = vd[3];
+	fs[5].v[1] = vd[2];
+	fs[5].v[2] = vd[6];
+	fs[5].v[3] = vd[7];
 	//----------------------------------------------------
 
 	return fs;
@@ -818,31 +920,17 @@ Hexahedron GeoGrid::makeHexahedron( uint cellIndex )
 void GeoGrid::IJKtoXYZ(uint i, uint j, uint k, double & x, double & y, double & z) const
 {
 	uint cellIndex = k * m_nJ * m_nI + j * m_nI + i;
-	CellDefRecordPtr cellDef = m_cellDefsPart.at( cellIndex );
-	x = ( m_vertexesPart.at( cellDef->vId[0] )->X +
-		  m_vertexesPart.at( cellDef->vId[1] )->X +
-		  m_vertexesPart.at( cellDef->vId[2] )->X +
-		  m_vertexesPart.at( cellDef->vId[3] )->X +
-		  m_vertexesPart.at( cellDef->vId[4] )->X +
-		  m_vertexesPart.at( cellDef->vId[5] )->X +
-		  m_vertexesPart.at( cellDef->vId[6] )->X +
-		  m_vertexesPart.at( cellDef->vId[7] )->X ) / 8 ;
-	y = ( m_vertexesPart.at( cellDef->vId[0] )->Y +
-		  m_vertexesPart.at( cellDef->vId[1] )->Y +
-		  m_vertexesPart.at( cellDef->vId[2] )->Y +
-		  m_vertexesPart.at( cellDef->vId[3] )->Y +
-		  m_vertexesPart.at( cellDef->vId[4] )->Y +
-		  m_vertexesPart.at( cellDef->vId[5] )->Y +
-		  m_vertexesPart.at( cellDef->vId[6] )->Y +
-		  m_vertexesPart.at( cellDef->vId[7] )->Y ) / 8 ;
-	z = ( m_vertexesPart.at( cellDef->vId[0] )->Z +
-		  m_vertexesPart.at( cellDef->vId[1] )->Z +
-		  m_vertexesPart.at( cellDef->vId[2] )->Z +
-		  m_vertexesPart.at( cellDef->vId[3] )->Z +
-		  m_vertexesPart.at( cellDef->vId[4] )->Z +
-		  m_vertexesPart.at( cellDef->vId[5] )->Z +
-		  m_vertexesPart.at( cellDef->vId[6] )->Z +
-		  m_vertexesPart.at( cellDef->vId[7] )->Z ) / 8 ;
+	assert( cellIndex < m_mesh.getCellCount() && "GeoGrid::IJKtoXYZ(): cell index out of range." );
+	const uint32_t* vIds = m_mesh.getCellVertexIds( cellIndex );
+	x = y = z = 0.0;
+	for( int iVertex = 0; iVertex < 8; ++iVertex ){
+		x += m_mesh.getX( vIds[iVertex] );
+		y += m_mesh.getY( vIds[iVertex] );
+		z += m_mesh.getZ( vIds[iVertex] );
+	}
+	x /= 8;
+	y /= 8;
+	z /= 8;
 }
 
 SpatialLocation GeoGrid::getCenter()
@@ -867,36 +955,65 @@ SpatialLocation GeoGrid::getCenter()
 
 bool GeoGrid::XYZtoIJK( double x, double y, double z, uint& i, uint& j, uint& k )
 {
-	if( m_spatialIndex->isEmpty() )
-		m_spatialIndex->fill( this );
-
-	//Get the nearest cells.
-	QList<uint> cellIndexes = m_spatialIndex->getNearest( x, y, z, 5 );
-
-	//if the spatial search failed, assumes it fell outside the grid
-	if( cellIndexes.empty() )
+	if( ! prepareCellSearch() )
+		return false;
+	uint cellIndex = m_lastLocatedCell;
+	if( ! locateCell( x, y, z, cellIndex ) )
 		return false;
+	m_lastLocatedCell = cellIndex;
+	//return the cell's topological coordinates
+	this->indexToIJK( cellIndex, i, j, k );
+	return true;
+}
 
-	//the test location
-	Vertex3D p{ x, y, z };
-
-	//for each one of the closest cells returned by the spatial index
-	QList<uint>::iterator itCellIndex = cellIndexes.begin();
-	for( ; itCellIndex != cellIndexes.end(); ++itCellIndex ){
-		//get the cell's faces geometry .
-		std::vector<Face3D> fs = getFaces( *itCellIndex );
-		//if the location is inside the cell
-		if( Util::isInside( p, fs ) ){
-			//return the cell's topological coordinates
-			this->indexToIJK( *itCellIndex, i, j, k );
-			return true;
+bool GeoGrid::prepareCellSearch()
+{
+	//the index is saved next to the grid file, so it is built only once for a given mesh.
+	if( m_spatialIndex->isEmpty() )
+		m_spatialIndex->fillPersistent( this );
+
+	//the face normals are computed once for all searches.
+	if( ! m_cellLocator ){
+		if( m_mesh.empty() )
+			loadMesh();
+		if( m_mesh.getCellCount() != m_nI * m_nJ * m_nK || m_mesh.getCellCount() == 0 ){
+			Application::instance()->logError("GeoGrid::prepareCellSearch(): the mesh does not match the grid dimensions.");
+			return false;
 		}
+		m_cellLocator.reset( new GeoGridCellLocator( m_mesh, m_nI, m_nJ, m_nK ) );
+		m_lastLocatedCell = 0;
 	}
+	return true;
+}
+
+bool GeoGrid::locateCell( double x, double y, double z, uint& cellIndex ) const
+{
+	//Nearby locations are often searched one after the other (e.g. samples along a well),
+	//so walking from the last cell found usually takes a few steps.  Longer walks are
+	//slower than the search below.
+	if( m_cellLocator->walk( cellIndex, x, y, z, MAX_WALK_STEPS, cellIndex ) )
+		return true;
+
+	//Otherwise, test every cell whose bounding box contains the location, in order of cell index.
+	QList<uint> cellIndexes = m_spatialIndex->getWithinDistance( x, y, z, 0.0 );
+	std::sort( cellIndexes.begin(), cellIndexes.end() );
+	for( uint candidate : cellIndexes )
+		if( m_cellLocator->isInside( candidate, x, y, z ) ){
+			cellIndex = candidate;
+			return true;
+		}
 
-	//if execution reaches this point, the search failed.
+	//if execution reaches this point, the location is outside the grid.
 	return false;
 }
 
+void GeoGrid::resetCellSearch()
+{
+	m_spatialIndex->clear();
+	m_cellLocator.reset();
+	m_lastLocatedCell = 0;
+}
+
 double GeoGrid::getDataSpatialLocation(uint line, CartesianCoord whichCoord)
 {
 	uint i, j, k;
@@ -931,14 +1048,10 @@ void GeoGrid::freeLoadedData()
         UVW_aspect->clearLoadedData();
 
     // free cell geometry data
-    m_vertexesPart.clear();
-    m_cellDefsPart.clear();
-    //clear() does not guarantee memory is actually freed.
-    std::vector< VertexRecordPtr >().swap( m_vertexesPart );
-    std::vector< CellDefRecordPtr >().swap( m_cellDefsPart );
+    m_mesh.clear();
 
     // free spatial index data
-    m_spatialIndex->clear();
+    resetCellSearch();
 
     // call superclass's free data method.
     DataFile::freeLoadedData();
@@ -4,60 +4,13 @@
 #include "gridfile.h"
 #include "geometry/face3d.h"
 #include "geometry/hexahedron.h"
+#include "auxiliary/geogridmesh.h"
 
 class CartesianGrid;
 class SpatialIndex;
 class PointSet;
 class SegmentSet;
-
-/** The data record holding the spatial position of a vertex.
- * It's id is the index in the m_vertexes container.
- */
-typedef struct {
-	double X;
-	double Y;
-	double Z;
-} VertexRecord;
-typedef std::shared_ptr< VertexRecord > VertexRecordPtr;
-
-
-/**
- * The data record holding the ids of the vertexes forming the geometry of a cell.
- * The cell it refers to is identified by and id.  This id is the index in m_cellDefs
- * container.  The cell index is computed from its topological coordinates following
- * GSLib convention: K * nJ * nI + J * nI + I.  So the first element of index 0 in m_cellDefs
- * is the cell with I = 0; J = 0; K = 0.
- *
- * Vertex id elements in the vId[8] array forming the geometry of a cell:
- *
- *                        J
- *                        |
- *                        |
- *
- *                        3-----------2   face 0 = 0 1 2 3
- *                       /|          /|   face 1 = 4 7 6 5
- *                     /  |        /  |   face 2 = 0 3 7 4
- *                   /    |      /    |   face 3 = 1 5 6 2
- *                  7--------- 6      |   face 4 = 0 4 5 1
- *                  |     |    |      |   face 5 = 3 2 6 7
- *                  |     0----|------1    --- I
- *                  |    /     |     /
- *                  |  /       |   /
- *                  |/         | /
- *                  4--------- 5
- *
- *               /
- *             /
- *           K
- *
- *
- *
- */
-typedef struct{
-	int vId[8];
-} CellDefRecord;
-typedef std::shared_ptr< CellDefRecord > CellDefRecordPtr;
-
+class GeoGridCellLocator;
 
 /**
  * Structure used as parameter for multi-zone GeoGrid constructors.
@@ -103,20 +56,33 @@ public:
 						 double& maxX, double& maxY, double& maxZ );
 
 	/** Returns the path to the file that stores the geometry data, that is,
-	 * the contents of the m_vertexesPart and m_cellDefsPart members.
+	 * the contents of the m_mesh member.
 	 */
 	QString getMeshFilePath();
 
 	/**
-	 * Saves the geometry data to file system.
+	 * Saves the geometry data to file system in binary format (see GeoGridMesh).
 	 */
 	void saveMesh();
 
 	/**
-	 * Loads the grid's mesh.
+	 * Loads the grid's mesh.  Mesh files in the older text format are also read, in which case
+	 * they are converted to the binary format.
 	 */
 	void loadMesh();
 
+	/**
+	 * Writes the geometry data to the given file in the text format, which can be read by other programs
+	 * or by importMeshFromText().  Returns false if the mesh could not be written.
+	 */
+	bool exportMeshAsText( const QString& path );
+
+	/**
+	 * Replaces the grid's mesh with the one in the given mesh file in text format and saves it.  The mesh must
+	 * have the cell count of the grid.  Returns false if the mesh could not be imported.
+	 */
+	bool importMeshFromText( const QString& path );
+
 	/** Sets GeoGrid metadata from the accompaining .md file, if it exists.
 	 Nothing happens if the metadata file does not exist.  If it exists, it calls
 	 #setInfo() with the metadata read from the .md file.*/
@@ -160,6 +126,17 @@ public:
     bool XYZtoUVW(  double x,  double y,  double z,
                    double& u, double& v, double& w );
 
+    /**
+     * Does the same as XYZtoUVW( double, double, double, double&, double&, double& ) for many locations at once,
+     * in parallel.  The search for the cell of each location starts from that of the previous one, so it is faster
+     * if consecutive locations are near each other (e.g. samples along wells).
+     * @param found Output: whether each location is inside the grid mesh.  The UVW coordinates of the locations
+     *              outside it are left as -1.0.
+     */
+    void XYZtoUVW( const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z,
+                   std::vector<double>& u, std::vector<double>& v, std::vector<double>& w,
+                   std::vector<bool>& found );
+
 	/**
 	 * Creates and returns a vector containing the geometries of the six faces of a cell.
 	 */
@@ -227,17 +204,42 @@ public:
 
 private:
 	//--------------mesh data-----------------------
-	std::vector< VertexRecordPtr > m_vertexesPart;
-	std::vector< CellDefRecordPtr > m_cellDefsPart;
+	GeoGridMesh m_mesh;
 	//----------------------------------------------
     std::unique_ptr< SpatialIndex > m_spatialIndex;
 
+    /** Locates the cells containing given locations.  Built on demand, it must be reset if the mesh changes. */
+    std::unique_ptr< GeoGridCellLocator > m_cellLocator;
+
+    /** The cell found in the last call to XYZtoIJK() or XYZtoUVW(), where the next search starts. */
+    uint m_lastLocatedCell;
+
 	/**
 	 * Stores the file timestamp in the last call to loadMesh().
 	 * This time is used to detect whether there is a change in the mesh file, to prevent
 	 * unnecessary data reloads.
 	 */
 	QDateTime m_lastModifiedDateTimeLastMeshLoad;
+
+	/** Replaces m_mesh with the contents of the given mesh file in text format (see MeshLoader). */
+	void loadMeshFromText( const QString& path );
+
+	/** Builds the spatial index and the cell locator used by locateCell() if not done yet.
+	 * Returns false if the mesh is missing or does not match the grid dimensions. */
+	bool prepareCellSearch();
+
+	/** Finds the index of the cell containing the given location.  It first walks from the cell given in
+	 * cellIndex (see GeoGridCellLocator::walk()), then tests all the cells whose bounding boxes contain the
+	 * location.  Returns false, leaving cellIndex unspecified, if the location is outside the grid mesh.
+	 * prepareCellSearch() must have succeeded.  This may be called by several threads at once. */
+	bool locateCell( double x, double y, double z, uint& cellIndex ) const;
+
+	/** Computes the UVW coordinates of a location inside the given cell.  prepareCellSearch() must have
+	 * succeeded. */
+	void getUVW( uint cellIndex, double x, double y, double z, double& u, double& v, double& w ) const;
+
+	/** Discards the data derived from the cell geometries, which must be called when the mesh changes. */
+	void resetCellSearch();
 };
 
 typedef std::shared_ptr<GeoGrid> GeoGridPtr;
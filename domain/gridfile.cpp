@@ -87,8 +87,7 @@ long GridFile::append(const QString columnName,
     //if the new data column is to be a categorical variable
     if( cd ){
         // get the GEO-EAS index for new attribute
-        uint indexGEOEAS
-            = _data[0].size(); // assumes the first row has the correct number of data columns
+        uint indexGEOEAS = _data.getColumnCount();
 
         // if the added column was deemed categorical, adds its GEO-EAS index and name of the
         // category definition
@@ -122,7 +121,8 @@ void GridFile::setDataIJK(uint column, uint i, uint j, uint k, double value)
 {
 	//TODO: verify any data update flags (specially in DataFile class)
 	uint dataRow = i + j*m_nI + k*m_nJ*m_nI;
-	_data[dataRow][column] = value;
+	_data.set( dataRow, column, value );
+	invalidateColumnStatistics( column );
 }
 
 void GridFile::indexToIJK(uint index, uint & i, uint & j, uint & k) const
@@ -122,6 +122,9 @@ public:
 protected:
 	uint m_nI, m_nJ, m_nK, m_nreal;
 
+	// DataFile interface
+	virtual bool canBeInSinglePrecision( uint /*column*/ ) const { return true; }
+
 	/**
 	 * Sets a value in the data column (0 = 1st column) given a grid topological coordinate (IJK).
 	 * @param i must be between 0 and NX-1.
@@ -310,7 +310,7 @@ PointSet *PointSet::createPointSetByFiltering(uint column, double vMin, double v
     //Get filtered data frame.
     std::vector< std::vector< double > > filteredData = getDataFilteredBy( column, vMin, vMax );
     //Assign it as the new point set's data.
-    newPS->_data = filteredData;
+    newPS->_data = ColumnarDataTable::fromRows( filteredData );
     //Set the same metadata.
     newPS->setInfoFromOtherPointSet( this );
     //Return the new filtered data set.
@@ -108,6 +108,9 @@ public:
 
 
 protected:
+    // DataFile interface
+    virtual bool canBeInSinglePrecision( uint column ) const { return ! isCoordinate( column ); }
+
     int _x_field_index; //index start at 1. Zero means not set.
     int _y_field_index;
     int _z_field_index;
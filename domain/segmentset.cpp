@@ -287,7 +287,7 @@ SegmentSet* SegmentSet::createSegmentSetByFiltering(uint column, double vMin, do
     //Get filtered data frame.
     std::vector< std::vector< double > > filteredData = getDataFilteredBy( column, vMin, vMax );
     //Assign it as the new point set's data.
-    newSS->_data = filteredData;
+    newSS->_data = ColumnarDataTable::fromRows( filteredData );
     //Set the same metadata.
     newSS->setInfoFromAnotherSegmentSet( this );
     //Return the new filtered data set.
@@ -27,7 +27,8 @@ double UnivariateDistribution::getValueFromCumulativeFrequency(double cumulative
     int pValueIndex = getTheColumnWithProbabilityRole()-1;
 
     //sanity checks
-    if( m_data.getDataTable().empty() ){
+    const ColumnarDataTable& dataTable = m_data.getColumnarDataTable();
+    if( dataTable.empty() ){
         Application::instance()->logError("UnivariateDistribution::getValueFromCumulativeFrequency(): distribution data not loaded. "
                                           "Make sure there is a prior call to UnivariateDistribution::readFromFS().");
         return result;
@@ -47,10 +48,9 @@ double UnivariateDistribution::getValueFromCumulativeFrequency(double cumulative
     double previousPValue = 0.0;
     double previousCumulativeP = 0.0;
     double cumulativeP = 0.0;
-    for( int i = 0; i < m_data.getDataTable().size(); ++i ){
-        const std::vector<double>& record = m_data.getDataTable()[i];
-        double zValue = record[ zValueIndex ];
-        double pValue = record[ pValueIndex ];
+    for( int i = 0; i < dataTable.getRowCount(); ++i ){
+        double zValue = dataTable( i, zValueIndex );
+        double pValue = dataTable( i, pValueIndex );
         cumulativeP += pValue;
         if( i > 0 ){ //1st point is the start of the distribution, that is, we don't have a ramp yet.
             if( cumulativeProbability < cumulativeP ){
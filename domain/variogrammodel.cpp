@@ -7,6 +7,7 @@
 #include "gslib/gslibparameterfiles/gslibparameterfile.h"
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "util.h"
+#include "geostats/compiledvariogrammodel.h"
 
 VariogramModel::VariogramModel(const QString path) : File( path ),
     _forceReread (true)
@@ -194,6 +195,9 @@ void VariogramModel::readParameters()
     //record the current datetime of file change
     _lastModifiedDateTimeLastRead = info.lastModified();
 
+    //the compiled model must be remade with the new parameters
+    std::atomic_store( &m_compiled, std::shared_ptr<const CompiledVariogramModel>() );
+
     //reset the ranges and angles collections
     m_it.clear();
     m_cc.clear();
@@ -260,6 +264,17 @@ VariogramModel VariogramModel::makeVModelWithoutNugget()
 	return result;
 }
 
+std::shared_ptr<const CompiledVariogramModel> VariogramModel::getCompiled()
+{
+    if(_forceReread) readParameters();
+    std::shared_ptr<const CompiledVariogramModel> compiled = std::atomic_load( &m_compiled );
+    if( ! compiled ){
+        compiled = std::make_shared<const CompiledVariogramModel>( this );
+        std::atomic_store( &m_compiled, compiled );
+    }
+    return compiled;
+}
+
 bool VariogramModel::forceReread() const
 {
     return _forceReread;
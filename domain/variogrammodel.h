@@ -4,6 +4,9 @@
 #include "file.h"
 #include <QList>
 #include <QDateTime>
+#include <memory>
+
+class CompiledVariogramModel;
 
 /*! Variogram structure types. */
 enum class VariogramStructureType : int {
@@ -129,6 +132,17 @@ public:
     /** Reads the variogram model parameters from file. */
     void readParameters();
 
+    /** Returns an immutable copy of the parameters prepared for fast evaluation (see CompiledVariogramModel).
+     * It is made on the first call and reused until the parameters are reread from a changed file.
+     * The returned object is safe to use in many threads, so performance critical code should get it once and
+     * use it instead of this object's getters.
+     * @note This method itself is thread-safe only if the parameters are not reread while it runs: with
+     *       forceReread() true, it calls readParameters(), which changes the member variables without
+     *       synchronization.  Call it concurrently only after setForceReread( false ) (and readParameters(),
+     *       if the file may have changed).
+     */
+    std::shared_ptr<const CompiledVariogramModel> getCompiled();
+
 	/** Returns a VariogramModel object from one all its structures but without the nugget effect.
 	 */
 	VariogramModel makeVModelWithoutNugget( );
@@ -175,6 +189,11 @@ private:
      * outdated values.  By default this variable is true.
      */
     bool _forceReread;
+
+    /** The compiled version of the current parameters, made on demand by getCompiled(). Access it only with
+     * std::atomic_load() and std::atomic_store().  This makes only the pointer thread-safe, not the rereads
+     * of the parameters (see getCompiled()). */
+    std::shared_ptr<const CompiledVariogramModel> m_compiled;
 };
 
 #endif // VARIOGRAMMODEL_H
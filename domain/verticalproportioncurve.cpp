@@ -375,7 +375,7 @@ void VerticalProportionCurve::writeToFS()
         record.push_back( entry.relativeDepth );
         for( double proportion : entry.proportions )
             record.push_back( proportion );
-        _data.push_back( record );
+        _data.appendRow( record );
     }
 
     //save the proportions
@@ -384,6 +384,7 @@ void VerticalProportionCurve::writeToFS()
     //after saving, we can discard the data frame, which is only necessary
     //to reuse DataFile's IO functionalities.
     _data.clear();
+    invalidateColumnStatistics();
 }
 
 void VerticalProportionCurve::readFromFS()
@@ -413,6 +414,7 @@ void VerticalProportionCurve::readFromFS()
 
     //The data table is no longer needed.
     _data.clear();
+    invalidateColumnStatistics();
 }
 
 void VerticalProportionCurve::getSpatialAndTopologicalCoordinates(int iRecord, double &x, double &y, double &z, int &i, int &j, int &k)
@@ -0,0 +1,27 @@
+#include "cartesiangridcovariancetable.h"
+#include "compiledvariogrammodel.h"
+
+CartesianGridCovarianceTable::CartesianGridCovarianceTable( const CompiledVariogramModel &model,
+                                                            double dX, double dY, double dZ,
+                                                            uint maxLagI, uint maxLagJ, uint maxLagK ) :
+    m_maxLagI( maxLagI ), m_maxLagJ( maxLagJ ), m_maxLagK( maxLagK ),
+    m_nLagsI( 2 * maxLagI + 1 ), m_nLagsJ( 2 * maxLagJ + 1 )
+{
+    m_covariances.resize( getNumberOfLags( maxLagI, maxLagJ, maxLagK ) );
+    size_t index = 0;
+    for( int dk = -m_maxLagK; dk <= m_maxLagK; ++dk )
+        for( int dj = -m_maxLagJ; dj <= m_maxLagJ; ++dj )
+            for( int di = -m_maxLagI; di <= m_maxLagI; ++di, ++index ){
+                //the variogram is symmetric, so the second half of the table mirrors the first one.
+                size_t mirrorIndex = m_covariances.size() - 1 - index;
+                if( mirrorIndex < index )
+                    m_covariances[ index ] = m_covariances[ mirrorIndex ];
+                else
+                    m_covariances[ index ] = model.getSill() - model.getGamma( di * dX, dj * dY, dk * dZ );
+            }
+}
+
+size_t CartesianGridCovarianceTable::getNumberOfLags( uint maxLagI, uint maxLagJ, uint maxLagK )
+{
+    return static_cast<size_t>( 2 * maxLagI + 1 ) * ( 2 * maxLagJ + 1 ) * ( 2 * maxLagK + 1 );
+}
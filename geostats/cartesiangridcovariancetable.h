@@ -0,0 +1,45 @@
+#ifndef CARTESIANGRIDCOVARIANCETABLE_H
+#define CARTESIANGRIDCOVARIANCETABLE_H
+
+#include <QtGlobal>
+#include <vector>
+#include <cstddef>
+
+class CompiledVariogramModel;
+
+/**
+ * The covariances of a variogram model between the cells of a Cartesian grid.  In a regular grid, the covariance
+ * between two cells depends only on the difference between their IJK indexes (the lag), so the covariances of all lags
+ * up to given maximums are computed once and the kriging systems just look them up (see getCovariance()) instead of
+ * evaluating the variogram model for each pair of cells.
+ * A table is immutable after it is built, so many threads can use the same object.
+ */
+class CartesianGridCovarianceTable
+{
+public:
+    /** Computes the covariances (sill minus the variogram value) of all the lags from -maxLagI,-maxLagJ,-maxLagK
+     * to maxLagI,maxLagJ,maxLagK.
+     * @param dX, dY, dZ The cell sizes of the grid.
+     */
+    CartesianGridCovarianceTable( const CompiledVariogramModel& model,
+                                  double dX, double dY, double dZ,
+                                  uint maxLagI, uint maxLagJ, uint maxLagK );
+
+    /** Returns the covariance between two cells separated by the given lag, which must be within the
+     * maximum lags passed to the constructor. */
+    double getCovariance( int di, int dj, int dk ) const {
+        return m_covariances[ ( static_cast<size_t>( dk + m_maxLagK ) * m_nLagsJ + ( dj + m_maxLagJ ) ) * m_nLagsI +
+                              ( di + m_maxLagI ) ];
+    }
+
+    /** Returns the number of covariances in a table with the given maximum lags (e.g. to check the memory
+     * needed before making one). */
+    static size_t getNumberOfLags( uint maxLagI, uint maxLagJ, uint maxLagK );
+
+private:
+    int m_maxLagI, m_maxLagJ, m_maxLagK;
+    size_t m_nLagsI, m_nLagsJ;
+    std::vector<double> m_covariances;
+};
+
+#endif // CARTESIANGRIDCOVARIANCETABLE_H
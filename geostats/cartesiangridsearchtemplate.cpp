@@ -0,0 +1,93 @@
+#include "cartesiangridsearchtemplate.h"
+#include "compiledvariogrammodel.h"
+#include "ijkdelta.h"
+
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <set>
+#include <cstdlib>
+
+CartesianGridSearchTemplate::CartesianGridSearchTemplate( uint nI, uint nJ, uint nK,
+                                                          int nColsAround, int nRowsAround, int nSlicesAround ) :
+    m_nI( nI ), m_nJ( nJ ), m_nK( nK ),
+    m_maxDi( 0 ), m_maxDj( 0 ), m_maxDk( 0 )
+{
+    //the deltas ordered by topological distance (see the less-than operator of IJKDelta).
+    std::set<IJKDelta> deltas;
+    for( int dk = 0; dk <= nSlicesAround/2; ++dk )
+        for( int dj = 0; dj <= nRowsAround/2; ++dj )
+            for( int di = 0; di <= nColsAround/2; ++di )
+                deltas.insert( IJKDelta( di, dj, dk ) );
+    //the first element is always delta 0,0,0 (target cell itself)
+    deltas.erase( deltas.begin() );
+
+    //expand each delta into its 2, 4 or 8 signed offsets.
+    IJKIndex origin( 0, 0, 0 );
+    IJKIndex indexes[8];
+    for( const IJKDelta& delta : deltas ){
+        int countIndexes = delta.getIndexes( origin, indexes );
+        for( int iIndex = 0; iIndex < countIndexes; ++iIndex ){
+            Offset offset;
+            offset.di = indexes[iIndex]._i;
+            offset.dj = indexes[iIndex]._j;
+            offset.dk = indexes[iIndex]._k;
+            offset.linear = ( static_cast<std::ptrdiff_t>( offset.dk ) * nJ + offset.dj ) *
+                            static_cast<std::ptrdiff_t>( nI ) + offset.di;
+            m_offsets.push_back( offset );
+        }
+    }
+    updateExtents();
+}
+
+void CartesianGridSearchTemplate::sortByVariogram( const CompiledVariogramModel &model, double dX, double dY, double dZ )
+{
+    std::vector<double> keys;
+    keys.reserve( m_offsets.size() );
+    for( const Offset& offset : m_offsets )
+        keys.push_back( model.getGamma( offset.di * dX, offset.dj * dY, offset.dk * dZ ) );
+    sortByKeys( keys, std::numeric_limits<double>::max() );
+}
+
+void CartesianGridSearchTemplate::sortByNormalizedDistance( const Matrix3X3<double> &normalizingTransform,
+                                                            double dX, double dY, double dZ,
+                                                            bool dropOutside )
+{
+    const Matrix3X3<double>& t = normalizingTransform;
+    std::vector<double> keys;
+    keys.reserve( m_offsets.size() );
+    for( const Offset& offset : m_offsets ){
+        double x = offset.di * dX;
+        double y = offset.dj * dY;
+        double z = offset.dk * dZ;
+        double nx = t._a11 * x + t._a12 * y + t._a13 * z;
+        double ny = t._a21 * x + t._a22 * y + t._a23 * z;
+        double nz = t._a31 * x + t._a32 * y + t._a33 * z;
+        keys.push_back( nx * nx + ny * ny + nz * nz );
+    }
+    sortByKeys( keys, dropOutside ? 1.0 : std::numeric_limits<double>::max() );
+}
+
+void CartesianGridSearchTemplate::sortByKeys( const std::vector<double> &keys, double maxKey )
+{
+    std::vector<size_t> order( m_offsets.size() );
+    std::iota( order.begin(), order.end(), 0 );
+    std::stable_sort( order.begin(), order.end(), [&keys]( size_t a, size_t b ){ return keys[a] < keys[b]; } );
+    std::vector< Offset > sorted;
+    sorted.reserve( order.size() );
+    for( size_t index : order )
+        if( keys[index] <= maxKey )
+            sorted.push_back( m_offsets[index] );
+    m_offsets.swap( sorted );
+    updateExtents();
+}
+
+void CartesianGridSearchTemplate::updateExtents()
+{
+    m_maxDi = m_maxDj = m_maxDk = 0;
+    for( const Offset& offset : m_offsets ){
+        m_maxDi = std::max<uint>( m_maxDi, std::abs( offset.di ) );
+        m_maxDj = std::max<uint>( m_maxDj, std::abs( offset.dj ) );
+        m_maxDk = std::max<uint>( m_maxDk, std::abs( offset.dk ) );
+    }
+}
@@ -0,0 +1,147 @@
+#ifndef CARTESIANGRIDSEARCHTEMPLATE_H
+#define CARTESIANGRIDSEARCHTEMPLATE_H
+
+#include <QtGlobal>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include "matrix3x3.h"
+
+class CompiledVariogramModel;
+
+/**
+ * A precompiled search neighborhood for the cells of a Cartesian grid: the list of the IJK offsets from a target
+ * cell to its neighbors, in the order they are visited, along with the equivalent offsets of the linear cell indexes
+ * (see GridFile::IJKtoIndex()).  The list is built once for a given grid and neighborhood, so the searches
+ * (see gather()) just walk a flat array and do not allocate memory.
+ * The offsets are first made in topological order (see the less-than operator of IJKDelta), which can
+ * then be replaced with an anisotropic order (see sortByVariogram() and sortByNormalizedDistance()).
+ * A template is immutable after it is sorted, so many threads can search with the same object.
+ */
+class CartesianGridSearchTemplate
+{
+public:
+    /** An offset from a target cell to a neighbor. */
+    struct Offset {
+        int di, dj, dk;
+        /** The difference between the linear indexes of the neighbor and of the target cell. */
+        std::ptrdiff_t linear;
+    };
+
+    /** Makes a template with the cells of a box of nColsAround x nRowsAround x nSlicesAround cells centered
+     * at the target cell (which is not included), ordered by topological distance.
+     * @param nI, nJ, nK The dimensions of the grid the template will be used with.
+     */
+    CartesianGridSearchTemplate( uint nI, uint nJ, uint nK,
+                                 int nColsAround, int nRowsAround, int nSlicesAround );
+
+    /** Reorders the offsets by their variogram value (increasing), so the neighbors most correlated with the
+     * target cell come first, honoring the anisotropy of the model.  Offsets with the same value (e.g. beyond the
+     * ranges) keep the topological order.
+     * @param dX, dY, dZ The cell sizes of the grid.
+     */
+    void sortByVariogram( const CompiledVariogramModel& model, double dX, double dY, double dZ );
+
+    /** Reorders the offsets by their distance in the normalized space of a search neighborhood (see
+     * SearchNeighborhood::getNormalizingTransform()), which honors its rotation and semi-axes.  Offsets at the
+     * same distance keep the topological order.
+     * @param dropOutside If true, the offsets outside the neighborhood (normalized distance greater than 1.0)
+     *                    are removed.
+     */
+    void sortByNormalizedDistance( const Matrix3X3<double>& normalizingTransform,
+                                   double dX, double dY, double dZ,
+                                   bool dropOutside );
+
+    /** Collects the linear indexes of up to maxCount valued neighbors of the given cell, in the order of
+     * the template.  Neighbors outside the grid are skipped.
+     * @param isValued A callable taking a linear cell index and returning whether that cell has a value.
+     * @param result An array with room for at least maxCount elements.
+     * @param offsetIndexes If not null, an array with room for at least maxCount elements that receives the
+     *                      indexes of the offsets (see getOffset()) of the neighbors found.
+     * @return The number of first elements of result with the neighbors found.
+     */
+    template< typename IsValued >
+    size_t gather( uint i, uint j, uint k, size_t maxCount, const IsValued& isValued, uint* result,
+                   uint* offsetIndexes = nullptr ) const;
+
+    /** Same as the other gather(), with the valued cells given by a bitmap indexed by the linear cell indexes. */
+    size_t gather( uint i, uint j, uint k, size_t maxCount, const std::vector<bool>& isValued, uint* result,
+                   uint* offsetIndexes = nullptr ) const {
+        return gather( i, j, k, maxCount, [&isValued]( uint index ){ return isValued[index]; }, result, offsetIndexes );
+    }
+
+    /** Returns the number of offsets (the maximum number of neighbors a search can find). */
+    size_t size() const { return m_offsets.size(); }
+
+    const Offset& getOffset( size_t index ) const { return m_offsets[index]; }
+
+    //!@{
+    //! Returns the greatest absolute offset along each direction.
+    uint getMaxDi() const { return m_maxDi; }
+    uint getMaxDj() const { return m_maxDj; }
+    uint getMaxDk() const { return m_maxDk; }
+    //!@}
+
+private:
+    uint m_nI, m_nJ, m_nK;
+    std::vector< Offset > m_offsets;
+
+    //!@{
+    //! The greatest absolute offsets along each direction.  Cells at least these numbers of cells away
+    //! from the grid's boundaries have all their neighbors inside the grid.
+    uint m_maxDi, m_maxDj, m_maxDk;
+    //!@}
+
+    /** Reorders the offsets by the given keys (one per offset), keeping the current order of equal keys, and
+     * removes those with keys greater than maxKey. */
+    void sortByKeys( const std::vector<double>& keys, double maxKey );
+
+    /** Updates m_maxDi, m_maxDj and m_maxDk. */
+    void updateExtents();
+};
+
+template< typename IsValued >
+size_t CartesianGridSearchTemplate::gather( uint i, uint j, uint k, size_t maxCount,
+                                            const IsValued& isValued, uint* result, uint* offsetIndexes ) const
+{
+    size_t count = 0;
+    if( maxCount == 0 )
+        return count;
+    std::ptrdiff_t center = ( static_cast<std::ptrdiff_t>( k ) * m_nJ + j ) * m_nI + i;
+    //away from the grid's boundaries, no bounds checking is needed.
+    if( i >= m_maxDi && i + m_maxDi < m_nI &&
+        j >= m_maxDj && j + m_maxDj < m_nJ &&
+        k >= m_maxDk && k + m_maxDk < m_nK ){
+        for( size_t iOffset = 0; iOffset < m_offsets.size(); ++iOffset ){
+            uint index = static_cast<uint>( center + m_offsets[iOffset].linear );
+            if( isValued( index ) ){
+                if( offsetIndexes )
+                    offsetIndexes[count] = static_cast<uint>( iOffset );
+                result[count++] = index;
+                if( count == maxCount )
+                    break;
+            }
+        }
+    } else {
+        for( size_t iOffset = 0; iOffset < m_offsets.size(); ++iOffset ){
+            const Offset& offset = m_offsets[iOffset];
+            int ii = static_cast<int>( i ) + offset.di;
+            int jj = static_cast<int>( j ) + offset.dj;
+            int kk = static_cast<int>( k ) + offset.dk;
+            if( ii < 0 || jj < 0 || kk < 0 ||
+                ii >= static_cast<int>( m_nI ) || jj >= static_cast<int>( m_nJ ) || kk >= static_cast<int>( m_nK ) )
+                continue;
+            uint index = static_cast<uint>( center + offset.linear );
+            if( isValued( index ) ){
+                if( offsetIndexes )
+                    offsetIndexes[count] = static_cast<uint>( iOffset );
+                result[count++] = index;
+                if( count == maxCount )
+                    break;
+            }
+        }
+    }
+    return count;
+}
+
+#endif // CARTESIANGRIDSEARCHTEMPLATE_H
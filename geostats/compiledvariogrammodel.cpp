@@ -0,0 +1,55 @@
+#include "compiledvariogrammodel.h"
+#include "geostatsutils.h"
+#include "domain/variogrammodel.h"
+#include "domain/application.h"
+
+#include <cmath>
+
+CompiledVariogramModel::CompiledVariogramModel( VariogramModel *model ) :
+    m_sill( model->getSill() ),
+    m_nugget( model->getNugget() )
+{
+    uint nst = model->getNst();
+    m_structures.reserve( nst );
+    for( uint i = 0; i < nst; ++i ){
+        Structure structure;
+        switch( model->getIt( i ) ){
+        case VariogramStructureType::SPHERIC:
+            structure.gammaFunction = GeostatsUtils::getGammaSpheric; break;
+        case VariogramStructureType::EXPONENTIAL:
+            structure.gammaFunction = GeostatsUtils::getGammaExponential; break;
+        case VariogramStructureType::GAUSSIAN:
+            structure.gammaFunction = GeostatsUtils::getGammaGaussian; break;
+        case VariogramStructureType::POWER_LAW:
+            Application::instance()->logWarn("CompiledVariogramModel::CompiledVariogramModel(): Power model using a constant power == 1.5");
+            structure.gammaFunction = GeostatsUtils::getGammaPowerLaw; break;
+        case VariogramStructureType::COSINE_HOLE_EFFECT:
+            structure.gammaFunction = GeostatsUtils::getGammaCosineHoleEffect; break;
+        default:
+            Application::instance()->logError("CompiledVariogramModel::CompiledVariogramModel(): Unknown structure type.  Assuming spheric.");
+            structure.gammaFunction = GeostatsUtils::getGammaSpheric;
+        }
+        structure.anisoTransform = GeostatsUtils::getAnisoTransform( model->get_a_hMax( i ), model->get_a_hMin( i ),
+                                                                     model->get_a_vert( i ), model->getAzimuth( i ),
+                                                                     model->getDip( i ), model->getRoll( i ) );
+        structure.range = model->get_a_hMax( i );
+        structure.inverseRange = 1.0 / structure.range;
+        structure.contribution = model->getCC( i );
+        m_structures.push_back( structure );
+    }
+}
+
+double CompiledVariogramModel::getGamma( double dx, double dy, double dz ) const
+{
+    double result = m_nugget;
+    for( const Structure& structure : m_structures ){
+        //get the separation corrected by anisotropy
+        const Matrix3X3<double>& t = structure.anisoTransform;
+        double tx = t._a11 * dx + t._a12 * dy + t._a13 * dz;
+        double ty = t._a21 * dx + t._a22 * dy + t._a23 * dz;
+        double tz = t._a31 * dx + t._a32 * dy + t._a33 * dz;
+        double h = std::sqrt( tx*tx + ty*ty + tz*tz );
+        result += structure.gammaFunction( h, h * structure.inverseRange, structure.range, structure.contribution );
+    }
+    return result;
+}
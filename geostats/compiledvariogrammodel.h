@@ -0,0 +1,58 @@
+#ifndef COMPILEDVARIOGRAMMODEL_H
+#define COMPILEDVARIOGRAMMODEL_H
+
+#include "matrix3x3.h"
+#include "spatiallocation.h"
+#include <vector>
+
+class VariogramModel;
+
+/**
+ * An immutable copy of the parameters of a VariogramModel prepared for fast evaluation: the anisotropy transforms
+ * and the inverses of the ranges are computed once and the function of each structure type is chosen once,
+ * so computing a variogram value does not read files, does not call the model's getters nor branch on the
+ * structure types.  A compiled model does not change after it is made, so many threads can use the same object.
+ * Get one with VariogramModel::getCompiled().
+ */
+class CompiledVariogramModel
+{
+public:
+    /** Makes a compiled version of the current parameters of the given model. */
+    explicit CompiledVariogramModel( VariogramModel* model );
+
+    /** Returns the total variance (nugget effect plus the contributions of the structures). */
+    double getSill() const { return m_sill; }
+
+    /** Returns the nugget effect. */
+    double getNugget() const { return m_nugget; }
+
+    /** Returns whether the model has no structures but the nugget effect. */
+    bool isPureNugget() const { return m_structures.empty(); }
+
+    /** Returns the variogram value (including the nugget effect) of the separation dx, dy, dz. */
+    double getGamma( double dx, double dy, double dz ) const;
+
+    /** Returns the variogram value (including the nugget effect) between two locations. */
+    double getGamma( const SpatialLocation& locA, const SpatialLocation& locB ) const {
+        return getGamma( locB._x - locA._x, locB._y - locA._y, locB._z - locA._z );
+    }
+
+private:
+    /** The variogram value of a structure as a function of the anisotropy-corrected separation h and
+     * of h over the range (one of GeostatsUtils' variogram structure functions). */
+    typedef double (*GammaFunction)( double h, double hOverRange, double range, double contribution );
+
+    struct Structure {
+        GammaFunction gammaFunction;
+        Matrix3X3<double> anisoTransform;
+        double range;
+        double inverseRange;
+        double contribution;
+    };
+
+    double m_sill;
+    double m_nugget;
+    std::vector< Structure > m_structures;
+};
+
+#endif // COMPILEDVARIOGRAMMODEL_H
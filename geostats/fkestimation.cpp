@@ -28,18 +28,22 @@ FKEstimation::FKEstimation() :
     m_spatialIndexPoints( new SpatialIndex() ),
     m_inputDataFile( nullptr ),
     m_factorNumber( 0 ), //0 == nugget effect.
-    m_searchAlogorithmOption( SearchAlogorithmOption::GENERIC_RTREE_BASED )
+    m_searchAlogorithmOption( SearchAlogorithmOption::GENERIC_RTREE_BASED ),
+    m_samplesOfSlice( new SpatialIndexNeighborhoods() ),
+    m_kOfSamplesOfSlice( -1 )
 {
 }
 
 FKEstimation::~FKEstimation()
 {
 	delete m_spatialIndexPoints;
+    delete m_samplesOfSlice;
 }
 
 void FKEstimation::setSearchStrategy(SearchStrategyPtr searchStrategy)
 {
     m_searchStrategy = searchStrategy;
+    m_kOfSamplesOfSlice = -1;
 }
 
 void FKEstimation::setVariogramModel(VariogramModel *variogramModel)
@@ -62,16 +66,18 @@ void FKEstimation::setKrigingType(KrigingType ktype)
 void FKEstimation::setInputVariable(Attribute *at_input)
 {
     m_at_input = at_input;
+    m_kOfSamplesOfSlice = -1;
 	//Update the pointer to the data file;
 	m_inputDataFile = static_cast<DataFile*>( m_at_input->getContainingFile() );
 	//Build a spatial index according to the type of the data file.
 	if( m_inputDataFile->isRegular() ){
 		CartesianGrid* cg = static_cast<CartesianGrid*>( m_inputDataFile );
-		m_spatialIndexPoints->fill( cg );
+		//the cells are evenly spread and of the same size: a uniform grid is the fastest to build and to search.
+		m_spatialIndexPoints->fill( cg, SpatialIndexBackend::UNIFORM_GRID );
 		Application::instance()->logInfo( "Spatial index created for " + m_inputDataFile->getName() + " regular grid." );
 	} else {
 		PointSet* ps = static_cast<PointSet*>( m_inputDataFile );
-		m_spatialIndexPoints->fill( ps, 0.000001 );
+		m_spatialIndexPoints->fill( ps, 0.000001, SpatialIndexBackend::KD_TREE );
 		Application::instance()->logInfo( "Spatial index created for " + m_inputDataFile->getName() + " point set." );
 	}
 }
@@ -79,6 +85,7 @@ void FKEstimation::setInputVariable(Attribute *at_input)
 void FKEstimation::setEstimationGrid(CartesianGrid *cg_estimation)
 {
     m_cg_estimation = cg_estimation;
+    m_kOfSamplesOfSlice = -1;
 }
 
 void FKEstimation::setFactorNumber(int factorNumber)
@@ -93,13 +100,22 @@ DataCellPtrMultiset FKEstimation::getSamples(const GridCell & estimationCell )
 
         //Fetch the indexes of the samples to be used in the estimation.
         QList<uint> samplesIndexes;
-        switch ( m_searchAlogorithmOption ) {
+        if( estimationCell._indexIJK._k == m_kOfSamplesOfSlice ){
+            //the samples were already searched in searchSamplesOfSlice().
+            size_t iCell = estimationCell._indexIJK._j * m_cg_estimation->getNX() + estimationCell._indexIJK._i;
+            const uint* indexes = m_samplesOfSlice->getIndexes( iCell );
+            for( size_t iSample = 0; iSample < m_samplesOfSlice->getCount( iCell ); ++iSample )
+                samplesIndexes.push_back( indexes[iSample] );
+        } else switch ( m_searchAlogorithmOption ) {
         case SearchAlogorithmOption::GENERIC_RTREE_BASED:
             samplesIndexes = m_spatialIndexPoints->getNearestWithinGenericRTreeBased( estimationCell, *m_searchStrategy );
             break;
         case SearchAlogorithmOption::OPTIMIZED_FOR_LARGE_HIGH_DENSITY_DATASETS:
             samplesIndexes = m_spatialIndexPoints->getNearestWithinTunedForLargeDataSets( estimationCell, *m_searchStrategy );
             break;
+        case SearchAlogorithmOption::ANISOTROPIC_DISTANCE_RANKED:
+            samplesIndexes = m_spatialIndexPoints->getNearestWithinAnisotropicDistanceRanked( estimationCell, *m_searchStrategy );
+            break;
         }
         QList<uint>::iterator it = samplesIndexes.begin();
 
@@ -136,6 +152,43 @@ DataCellPtrMultiset FKEstimation::getSamples(const GridCell & estimationCell )
 	return result;
 }
 
+void FKEstimation::searchSamplesOfSlice(uint k)
+{
+    m_kOfSamplesOfSlice = -1;
+    if( ! m_searchStrategy || ! m_at_input || ! m_cg_estimation )
+        return;
+
+    //collect the centers of the cells in the slice.
+    uint nI = m_cg_estimation->getNX();
+    uint nJ = m_cg_estimation->getNY();
+    std::vector<double> x, y, z;
+    x.reserve( nI * nJ );
+    y.reserve( nI * nJ );
+    z.reserve( nI * nJ );
+    for( uint j = 0; j < nJ; ++j )
+        for( uint i = 0; i < nI; ++i ){
+            GridCell cell( m_cg_estimation, -1, i, j, k );
+            x.push_back( cell._center._x );
+            y.push_back( cell._center._y );
+            z.push_back( cell._center._z );
+        }
+
+    NeighborhoodSearchAlgorithm algorithm = NeighborhoodSearchAlgorithm::GENERIC_RTREE_BASED;
+    switch ( m_searchAlogorithmOption ) {
+    case SearchAlogorithmOption::GENERIC_RTREE_BASED:
+        algorithm = NeighborhoodSearchAlgorithm::GENERIC_RTREE_BASED;
+        break;
+    case SearchAlogorithmOption::OPTIMIZED_FOR_LARGE_HIGH_DENSITY_DATASETS:
+        algorithm = NeighborhoodSearchAlgorithm::TUNED_FOR_LARGE_DATA_SETS;
+        break;
+    case SearchAlogorithmOption::ANISOTROPIC_DISTANCE_RANKED:
+        algorithm = NeighborhoodSearchAlgorithm::ANISOTROPIC_DISTANCE_RANKED;
+        break;
+    }
+    m_spatialIndexPoints->getNearestWithinBatch( x, y, z, *m_searchStrategy, algorithm, *m_samplesOfSlice );
+    m_kOfSamplesOfSlice = k;
+}
+
 std::vector<double> FKEstimation::run( )
 {
     if( ! m_variogramModel ){
@@ -213,6 +266,9 @@ std::vector<double> FKEstimation::run( )
         QCoreApplication::processEvents(); //let Qt repaint widgets
     }
 
+    //the searched samples are only valid during the run.
+    m_kOfSamplesOfSlice = -1;
+
     //flushes any messages that have been generated for logging.
     Application::instance()->logWarningOn();
     Application::instance()->logErrorOn();
@@ -252,6 +308,7 @@ SearchAlogorithmOption FKEstimation::getSearchAlogorithmOption() const
 void FKEstimation::setSearchAlogorithmOption(SearchAlogorithmOption searchAlogorithmOption)
 {
     m_searchAlogorithmOption = searchAlogorithmOption;
+    m_kOfSamplesOfSlice = -1;
 }
 
 
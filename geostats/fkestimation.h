@@ -10,10 +10,12 @@ class Attribute;
 class CartesianGrid;
 class DataCell;
 class SpatialIndex;
+struct SpatialIndexNeighborhoods;
 
 enum class SearchAlogorithmOption : uint {
     GENERIC_RTREE_BASED,
-    OPTIMIZED_FOR_LARGE_HIGH_DENSITY_DATASETS
+    OPTIMIZED_FOR_LARGE_HIGH_DENSITY_DATASETS,
+    ANISOTROPIC_DISTANCE_RANKED
 };
 
 /** This class encpsulates the factorial kriging estimation.
@@ -55,6 +57,12 @@ public:
 	 */
 	DataCellPtrMultiset getSamples(const GridCell & estimationCell );
 
+    /** Searches the samples around all the cells in the given K slice of the estimation grid at once
+     * (in parallel).  The getSamples() calls for cells in that slice then use these results instead of
+     * searching the samples cell by cell.
+     */
+    void searchSamplesOfSlice( uint k );
+
     /** Performs the factorial kriging. Make sure all parameters have been set properly.
      * @param factorNumber The number of factor to get: -1 (mean); 0 (nugget); 1 and onwards (each variographic structure).
      */
@@ -86,6 +94,10 @@ private:
     int m_factorNumber;
 	std::vector< uint > m_numberOfSamples;
     SearchAlogorithmOption m_searchAlogorithmOption;
+    /** The indexes of the samples around each cell of the slice set in searchSamplesOfSlice(). */
+    SpatialIndexNeighborhoods* m_samplesOfSlice;
+    /** The K index of the slice in m_samplesOfSlice (-1 == none). */
+    int m_kOfSamplesOfSlice;
 };
 
 #endif // FKESTIMATION_H
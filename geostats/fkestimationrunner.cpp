@@ -62,6 +62,8 @@ void FKEstimationRunner::doRun()
     int nKriging = 0;
     int nFailed = 0;
     for( uint k = 0; k <nK; ++k){
+        //the samples of all cells in the slice are searched at once, in parallel.
+        m_fkEstimation->searchSamplesOfSlice( k );
         for( uint j = 0; j <nJ; ++j){
             emit setLabel("Running FK:\n" +
                           QString::number(nKriging) + " kriging operations (" +
@@ -4,22 +4,16 @@
 #include "domain/cartesiangrid.h"
 #include "domain/application.h"
 #include "spatiallocation.h"
-#include "ijkdelta.h"
 #include "util.h"
-#include "ijkdeltascache.h"
+#include "compiledvariogrammodel.h"
 #include "imagejockey/imagejockeyutils.h"
 
 #include <cmath>
+#include <algorithm>
 #include <limits>
 #include <iostream>
 #include <random>
 
-//the aniso transforms only change if variogram model changes
-struct AnisoCache{
-    VariogramModel* vModel;
-    std::vector<Matrix3X3<double>> anisoTransforms;
-} g_anisoCache;
-
 GeostatsUtils::GeostatsUtils()
 {
 }
@@ -82,72 +76,61 @@ double GeostatsUtils::getGamma(VariogramStructureType permissiveModel, double h,
 	double h_over_a = h/range;
     switch( permissiveModel ){
     case VariogramStructureType::SPHERIC:
-        if( h > range )
-            return contribution;
-		return contribution * ( 1.5*h_over_a - 0.5*(h_over_a*h_over_a*h_over_a) );
+        return getGammaSpheric( h, h_over_a, range, contribution );
     case VariogramStructureType::EXPONENTIAL:
-        if( Util::almostEqual2sComplement( h, 0.0, 1 ) )
-            return 0.0;
-        return contribution * ( 1.0 - std::exp(-3.0 * h_over_a) );
+        return getGammaExponential( h, h_over_a, range, contribution );
     case VariogramStructureType::GAUSSIAN:
-        if( Util::almostEqual2sComplement( h, 0.0, 1 ) )
-            return 0.0;
-        return contribution * ( 1.0 - std::exp(-9.0*(h_over_a*h_over_a)) );
+        return getGammaGaussian( h, h_over_a, range, contribution );
     case VariogramStructureType::POWER_LAW:
-        //TODO: using a constant power (1.5) since I don't know how it is entered in GSLib par files.
         Application::instance()->logWarn("GeostatsUtils::getGamma(): Power model using a constant power == 1.5");
-        return contribution * std::pow(h, 1.5);
+        return getGammaPowerLaw( h, h_over_a, range, contribution );
     case VariogramStructureType::COSINE_HOLE_EFFECT:
-        return contribution * ( 1.0 - std::cos( h_over_a * Util::PI ) );
+        return getGammaCosineHoleEffect( h, h_over_a, range, contribution );
     default:
         Application::instance()->logError("GeostatsUtils::getGamma(): Unknown structure type.  Assuming spheric.");
-        if( h > range )
-            return contribution;
-        return contribution * ( 1.5*h_over_a - 0.5*(h_over_a*h_over_a*h_over_a) );
+        return getGammaSpheric( h, h_over_a, range, contribution );
     }
     return std::numeric_limits<double>::quiet_NaN();
 }
 
-double GeostatsUtils::getGamma(VariogramModel *model, const SpatialLocation &locA, const SpatialLocation &locB)
+double GeostatsUtils::getGammaSpheric(double h, double hOverRange, double range, double contribution)
 {
-    //lesser bottleneck
-    double result = model->getNugget();
-    int nst = model->getNst();
-
-    double h;
-
-    for( int i = 0; i < nst; ++i){
-
-        Matrix3X3<double> anisoTransform;
-        //improving performance by saving the aniso transforms in a cache, assuming the anisotropy
-        //      is the same in all locations.
-		if( g_anisoCache.vModel != model){
-			if( i == 0 ) //making sure the cache doesn't grow indefinitely
-				g_anisoCache.anisoTransforms.clear();
-            anisoTransform = GeostatsUtils::getAnisoTransform(
-                        model->get_a_hMax(i), model->get_a_hMin(i), model->get_a_vert(i),
-                        model->getAzimuth(i), model->getDip(i), model->getRoll(i));
-			g_anisoCache.anisoTransforms.push_back( anisoTransform );
-        } else {
-			anisoTransform = g_anisoCache.anisoTransforms[i];
-        }
+    if( h > range )
+        return contribution;
+    return contribution * ( 1.5*hOverRange - 0.5*(hOverRange*hOverRange*hOverRange) );
+}
 
-        //get the separation corrected by anisotropy
-		h = GeostatsUtils::getH( locA._x, locA._y, locA._z,
-                                 locB._x, locB._y, locB._z,
-                                 anisoTransform );
+double GeostatsUtils::getGammaExponential(double h, double hOverRange, double, double contribution)
+{
+    if( Util::almostEqual2sComplement( h, 0.0, 1 ) )
+        return 0.0;
+    return contribution * ( 1.0 - std::exp(-3.0 * hOverRange) );
+}
 
-        result += GeostatsUtils::getGamma( model->getIt(i),
-                                           h,
-                                           model->get_a_hMax(i),
-                                           model->getCC(i) );
-    }
+double GeostatsUtils::getGammaGaussian(double h, double hOverRange, double, double contribution)
+{
+    if( Util::almostEqual2sComplement( h, 0.0, 1 ) )
+        return 0.0;
+    return contribution * ( 1.0 - std::exp(-9.0*(hOverRange*hOverRange)) );
+}
 
-    //sets the cache's key (variogram model pointer) so we know whether we can reuse the aniso transforms
-    //saved in the cache
-	g_anisoCache.vModel = model;
+double GeostatsUtils::getGammaPowerLaw(double h, double, double, double contribution)
+{
+    //TODO: using a constant power (1.5) since I don't know how it is entered in GSLib par files.
+    return contribution * std::pow(h, 1.5);
+}
 
-    return result;
+double GeostatsUtils::getGammaCosineHoleEffect(double, double hOverRange, double, double contribution)
+{
+    return contribution * ( 1.0 - std::cos( hOverRange * Util::PI ) );
+}
+
+double GeostatsUtils::getGamma(VariogramModel *model, const SpatialLocation &locA, const SpatialLocation &locB)
+{
+    //the compiled model has the aniso transforms and the structure functions ready, so this does not
+    //call the model's getters for each structure.  Performance critical code should get the compiled
+    //model once and call its getGamma() directly.
+    return model->getCompiled()->getGamma( locA, locB );
 }
 
 double GeostatsUtils::getTransiogramProbability( TransiogramType transiogramType,
@@ -195,6 +178,10 @@ MatrixNXM<double> GeostatsUtils::makeCovMatrix(DataCellPtrMultiset &samples,
     samplesV.reserve( samples.size() );
     std::copy(samples.begin(), samples.end(), std::back_inserter(samplesV));
 
+    //get the compiled variogram model once for all the sample pairs.
+    std::shared_ptr<const CompiledVariogramModel> compiledModel = variogramModel->getCompiled();
+    bool isPureNugget = compiledModel->isPureNugget();
+
     //For each sample.
 	std::vector<DataCellPtr>::iterator rowsIt = samplesV.begin();
     for( int i = 0; rowsIt != samplesV.end(); ++rowsIt, ++i ){
@@ -204,10 +191,10 @@ MatrixNXM<double> GeostatsUtils::makeCovMatrix(DataCellPtrMultiset &samples,
         for( int j = 0; colsIt != samplesV.end(); ++colsIt, ++j ){
 			DataCellPtr colCell = *colsIt;
             //get semi-variance value from the separation between two samples in a pair
-			double gamma = GeostatsUtils::getGamma( variogramModel, rowCell->_center, colCell->_center );
+			double gamma = compiledModel->getGamma( rowCell->_center, colCell->_center );
             //to remove singularity...
             //TODO: this needs to be verified.
-            if( variogramModel->isPureNugget() && i != j )
+            if( isPureNugget && i != j )
                 gamma = 0.0;
 			if( returnGamma )
 				covMatrix(i, j) = gamma;
@@ -275,12 +262,15 @@ MatrixNXM<double> GeostatsUtils::makeGammaMatrix(DataCellPtrMultiset &samples,
 	samplesV.reserve( samples.size() );
 	std::copy(samples.begin(), samples.end(), std::back_inserter(samplesV));
 
+	//get the compiled variogram model once for all the samples.
+	std::shared_ptr<const CompiledVariogramModel> compiledModel = variogramModel->getCompiled();
+
 	//For each sample.
 	std::vector<DataCellPtr>::iterator rowsIt = samplesV.begin();
 	for( int i = 0; rowsIt != samplesV.end(); ++rowsIt, ++i ){
 		DataCellPtr rowCell = *rowsIt;
         //get semi-variance value
-		double gamma = GeostatsUtils::getGamma( variogramModel, rowCell->_center, estimationLocation._center + epsilon );
+		double gamma = compiledModel->getGamma( rowCell->_center, estimationLocation._center + epsilon );
         //get covariance
 		if( returnGamma )
 			result(i, 0) = gamma;
@@ -309,113 +299,6 @@ MatrixNXM<double> GeostatsUtils::makeGammaMatrix(DataCellPtrMultiset &samples,
     return result;
 }
 
-void GeostatsUtils::getValuedNeighborsTopoOrdered(const GridCell &cell,
-                                                        int numberOfSamples,
-                                                        int nColsAround,
-                                                        int nRowsAround,
-                                                        int nSlicesAround,
-                                                        bool hasNDV,
-                                                        double NDV,
-                                                        GridCellPtrMultiset &list,
-                                                        const std::vector<double> *simulatedData)
-{
-    CartesianGrid* cg = cell._grid;
-    if( ! cg ){
-        Application::instance()->logError("GeostatsUtils::getValuedNeighborsTopoOrdered(): null grid.  Returning empty list.");
-    }
-
-    assert( ( cell._dataIndex >= 0 || simulatedData ) && "GeostatsUtils::getValuedNeighborsTopoOrdered(): "
-                                                             "the data index of cell is -1, but no "
-                                                             "separate computed data was provided (simulatedData == nullptr).");
-
-    //get the grid limits
-    int row_limit = cg->getNY();
-    int column_limit = cg->getNX();
-    int slice_limit = cg->getNZ();
-
-    //generate all possible ijk deltas up to the neighborhood limits
-    //the list of deltas is ordered by resulting distance with respect to a target cell
-    //////////the block of code below is considered optimal (speed)
-    std::vector<IJKDelta> *deltasV = nullptr;
-    //try to reuse a list from the cache since making one anew is costly and the neighborhood does not change
-    IJKDeltasCacheMap::iterator itcache =
-            IJKDeltasCache::cache.find( IJKDeltasCacheKey( nColsAround, nRowsAround, nSlicesAround ) );
-    if( itcache != IJKDeltasCache::cache.end() ){ //cache hit
-        deltasV = itcache->second;
-    } else { //cache miss, have to build the list
-        //build the list as a set to get free ordering
-        std::set<IJKDelta> *deltas = new std::set<IJKDelta>();
-        for( int dk = 0; dk <= nSlicesAround/2; ++dk){
-			for( int dj = 0; dj <= nRowsAround/2; ++dj ){
-				for( int di = 0; di <= nColsAround/2; ++di){
-                    deltas->insert( IJKDelta( di, dj, dk) );
-                }
-            }
-        }
-        //the first element is always delta 0,0,0 (target cell itself)
-        deltas->erase( deltas->begin() );
-        //now that std::set assured an ordered collection, transform it into an std::vector
-        //which is faster to iterate because there is no pointer chasing and std::vector elements
-        //are stored in continuous blocks of memory (memory locality increases cache hits)
-        deltasV = new std::vector<IJKDelta>();
-        deltasV->reserve( deltas->size() );
-        std::copy(deltas->begin(), deltas->end(), std::back_inserter(*deltasV));
-        //store the list in the cache for later reuse.
-        IJKDeltasCache::cache.emplace( IJKDeltasCacheKey( nColsAround,
-														  nRowsAround,
-														  nSlicesAround ), deltasV );
-        //we don't need the std::set anymore
-        delete deltas;
-    }
-
-    if( !deltasV || deltasV->empty() ){ //hope the second is not evaluated if deltas == nullptr
-        Application::instance()->logError("GeostatsUtils::getValuedNeighborsTopoOrdered(): null neighborhood.  Returning empty list.");
-    }
-    //////////////////////////////////////////////////
-
-    //for each delta...
-    std::vector<IJKDelta>::const_iterator it = deltasV->cbegin();
-    IJKIndex indexes[8]; //eight indexes is the most possible (3 degrees of freedom)
-    for(; it != deltasV->end(); ++it){
-        const IJKDelta &delta = (*it);
-        //...get all the indexes from a delta (can yield 2, 4 or 8 coordinates, depending on the delta's degrees of freedom).
-        // TODO: Performance: that getIndexes() function has improved, but maybe there is still some room for improvement
-        int countIndexes = delta.getIndexes( cell._indexIJK, indexes );
-        //for each topological coordinate (IJK index)...
-        for( int iIndex = 0; iIndex < countIndexes; ++iIndex){
-            int ii = indexes[iIndex]._i;
-            int jj = indexes[iIndex]._j;
-            int kk = indexes[iIndex]._k;
-            //...if the index is within the grid limits...
-            if( ii >= 0 && ii < column_limit &&
-                jj >= 0 && jj < row_limit &&
-                kk >= 0 && kk < slice_limit ){
-                //...get the value corresponding to the cell index.
-                double value;
-                int dataIndex;
-                if ( cell._dataIndex >= 0 ) {  // data column is provided: fetch value from the grid
-                    dataIndex = cell._dataIndex;
-                    value = cg->dataIJK( dataIndex, ii, jj, kk );
-                } else { // data column is NOT provided: fetch value from a client-given data container
-                    dataIndex = cg->IJKtoIndex( ii, jj, kk );
-                    value = (*simulatedData)[ dataIndex ];
-                }
-                //if the cell is valued... DataFile::hasNDV() is slow.
-                if( !hasNDV || !Util::almostEqual2sComplement( NDV, value, 1 ) ){
-                    //...it is a valid neighbor.
-                    GridCellPtr currentCell( new GridCell( cg, dataIndex, ii, jj, kk ) );
-                    currentCell->computeTopoDistance( cell );
-                    list.insert( currentCell );
-                    //if the number of neighbors is reached...
-                    if( list.size() == (unsigned)numberOfSamples )
-                        //...interrupt the search
-                        return;
-                }
-            }
-        }
-    }
-}
-
 MatrixNXM<double> GeostatsUtils::makePmatrixForFK(int nsamples, int nst, KrigingType kType )
 {
 	int append = 0;
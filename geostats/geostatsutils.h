@@ -60,9 +60,25 @@ public:
      */
     static double getGamma( VariogramStructureType permissiveModel, double h, double range, double contribution );
 
+    /** @name Variogram structure functions
+     * The functions of each structure type used by getGamma() and by CompiledVariogramModel.  They take h over
+     * the range as well, so callers that evaluate a structure many times can precompute the inverse of the range.
+     */
+    ///@{
+    static double getGammaSpheric( double h, double hOverRange, double range, double contribution );
+    static double getGammaExponential( double h, double hOverRange, double range, double contribution );
+    static double getGammaGaussian( double h, double hOverRange, double range, double contribution );
+    static double getGammaPowerLaw( double h, double hOverRange, double range, double contribution );
+    static double getGammaCosineHoleEffect( double h, double hOverRange, double range, double contribution );
+    ///@}
+
     /**
      * Returns the total covariance according to a variogram model between two locations.
      * Includes the nugget effet contribution, if any.
+     * This evaluates the compiled version of the model (see VariogramModel::getCompiled()).
+     * @note It can be called from many threads only if the model does not reread its parameters meanwhile,
+     *       that is, after model->setForceReread( false ).  Multithreaded code should rather fetch
+     *       the compiled model once, before starting the threads.
      */
 	static double getGamma(VariogramModel* model, const SpatialLocation& locA, const SpatialLocation& locB );
 
@@ -113,21 +129,6 @@ public:
 											 bool returnGamma = false,
 											 double epsilon = 0.0 );
 
-    /**
-     *  Returns a list of valued grid cells, ordered by topological proximity to the target cell.
-     * @param simulatedData This should be set if this method is being called by computations that do not
-     *                      immediately commit the results to the grid (e.g. simulation routines), otherwise an index
-     *                      crash will ensue as the index in cell object parameter is invalid or is -1.
-     */
-    static void getValuedNeighborsTopoOrdered(const GridCell &cell,
-															int numberOfSamples,
-															int nColsAround,
-															int nRowsAround,
-															int nSlicesAround,
-															bool hasNDV,
-															double NDV,
-                                                            GridCellPtrMultiset & list,
-                                                            const std::vector<double> *simulatedData = nullptr );
 	/** Creates the P matrix for Factorial Kriging.
 	 * see theory in Ma et al. (2014) - Factorial kriging for multiscale modelling.
 	 * @param nsamples Number of samples for the kriging operation.
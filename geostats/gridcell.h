@@ -70,18 +70,4 @@ public:
     }
 };
 
-typedef std::shared_ptr<GridCell> GridCellPtr;
-
-/** The GridCellPtr comparator class. */
-struct GridCellPtrComparator
-{
-	bool operator()(const GridCellPtr &d1, const GridCellPtr &d2) const {
-		return d1->_topoDistance < d2->_topoDistance;
-	}
-};
-
-/** An ordered container by the GridCell's topological distance. */
-typedef std::multiset<GridCellPtr, GridCellPtrComparator> GridCellPtrMultiset;
-
-
 #endif // GRIDCELL_H
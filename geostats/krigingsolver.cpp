@@ -0,0 +1,73 @@
+#include "krigingsolver.h"
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+
+namespace {
+
+/** Copies a MatrixNXM into an Eigen matrix. */
+Eigen::MatrixXd toEigen( const MatrixNXM<double>& matrix )
+{
+    Eigen::MatrixXd result( static_cast<int>( matrix.getN() ), static_cast<int>( matrix.getM() ) );
+    for( int i = 0; i < result.rows(); ++i )
+        for( int j = 0; j < result.cols(); ++j )
+            result( i, j ) = matrix( i, j );
+    return result;
+}
+
+/** Copies a column vector into a column MatrixNXM. */
+MatrixNXM<double> fromEigen( const Eigen::VectorXd& vector )
+{
+    MatrixNXM<double> result( static_cast<unsigned int>( vector.size() ), 1 );
+    for( int i = 0; i < vector.size(); ++i )
+        result( i, 0 ) = vector( i );
+    return result;
+}
+
+/** Returns whether the estimate of the reciprocal of the condition number means the matrix is ill-conditioned. */
+bool isIllConditioned( double rcond, double maxConditionNumber )
+{
+    return !( rcond > 0.0 ) || 1.0 / rcond > maxConditionNumber;
+}
+
+/** Solves the system with Eigen's LDLT (diagonal pivoting only), which also works with semidefinite symmetric
+ * matrices and with the indefinite ordinary kriging matrices (see KrigingSolver::solveOK()). */
+bool solveWithLDLT( const Eigen::MatrixXd& A, const Eigen::VectorXd& b, MatrixNXM<double>& weights )
+{
+    Eigen::LDLT< Eigen::MatrixXd > ldlt( A );
+    if( ldlt.info() != Eigen::Success )
+        return false;
+    weights = fromEigen( ldlt.solve( b ) );
+    return true;
+}
+
+}
+
+KrigingSolverStatus KrigingSolver::solveSK( const MatrixNXM<double> &covMat,
+                                            const MatrixNXM<double> &gammaMat,
+                                            double maxConditionNumber,
+                                            MatrixNXM<double> &weights )
+{
+    Eigen::MatrixXd A = toEigen( covMat );
+    Eigen::VectorXd b = toEigen( gammaMat ).col( 0 );
+    Eigen::LLT< Eigen::MatrixXd > llt( A );
+    //Cholesky fails if the matrix is not (numerically) positive definite.
+    if( llt.info() != Eigen::Success ){
+        if( ! solveWithLDLT( A, b, weights ) )
+            return KrigingSolverStatus::FAILED;
+        return KrigingSolverStatus::ILL_CONDITIONED;
+    }
+    weights = fromEigen( llt.solve( b ) );
+    if( isIllConditioned( llt.rcond(), maxConditionNumber ) )
+        return KrigingSolverStatus::ILL_CONDITIONED;
+    return KrigingSolverStatus::SOLVED;
+}
+
+KrigingSolverStatus KrigingSolver::solveOK( const MatrixNXM<double> &covMatOK,
+                                            const MatrixNXM<double> &gammaMatOK,
+                                            MatrixNXM<double> &weights )
+{
+    if( ! solveWithLDLT( toEigen( covMatOK ), toEigen( gammaMatOK ).col( 0 ), weights ) )
+        return KrigingSolverStatus::FAILED;
+    return KrigingSolverStatus::SOLVED;
+}
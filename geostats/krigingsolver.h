@@ -0,0 +1,48 @@
+#ifndef KRIGINGSOLVER_H
+#define KRIGINGSOLVER_H
+
+#include "matrixmxn.h"
+
+/** The outcomes of KrigingSolver's methods. */
+enum class KrigingSolverStatus : int {
+    SOLVED,          //!< the weights were computed.
+    ILL_CONDITIONED, //!< the weights were computed, but the matrix is near-singular, so they may be inaccurate.
+    FAILED           //!< the matrix could not be factorized (e.g. it has NaNs) and the weights were not computed.
+};
+
+/**
+ * Solves kriging systems ([Cov][w] = [gamma]) by factorizing the covariance matrix with Eigen instead of
+ * inverting it.  The factorizations also give a cheap estimate of the condition number of the matrix (the reciprocal
+ * of Eigen's rcond(), an estimate of the condition number in the 1-norm), so the costly remedies for near-singular
+ * matrices (e.g. eigendecomposition-based regularization) are only needed when it is too large.
+ */
+class KrigingSolver
+{
+public:
+    /** Solves a simple kriging system.  The covariance matrix (see GeostatsUtils::makeCovMatrix()) is symmetric
+     * positive definite, so it is factorized with Cholesky (LLT).  If the matrix is not positive definite in
+     * practice (it is numerically singular), the system is solved with LDLT and ILL_CONDITIONED is returned.
+     * @param maxConditionNumber Estimated condition numbers above this make the method return ILL_CONDITIONED.
+     * @param weights Output: the kriging weights (a column matrix).
+     */
+    static KrigingSolverStatus solveSK( const MatrixNXM<double>& covMat,
+                                        const MatrixNXM<double>& gammaMat,
+                                        double maxConditionNumber,
+                                        MatrixNXM<double>& weights );
+
+    /** Solves an ordinary kriging system.  The covariance matrix has the extra row and column of the Lagrangian
+     * multiplier (see GeostatsUtils::makeCovMatrix()), which makes it indefinite.  It is factorized with Eigen's
+     * LDLT, which pivots only on the diagonal (it is not a Bunch-Kaufman factorization) and is documented for
+     * semidefinite matrices.  It works here because the covariance block is positive definite: the zero in the
+     * diagonal of the Lagrangian is never the largest pivot left, and by the time it is taken it has become
+     * the (negative, nonzero) Schur complement of the covariance block.
+     * This does not check the conditioning: that of the covariance block is checked by solveSK().
+     * @param weights Output: the kriging weights followed by the Lagrangian multiplier (a column matrix).
+     * @return SOLVED or FAILED.
+     */
+    static KrigingSolverStatus solveOK( const MatrixNXM<double>& covMatOK,
+                                        const MatrixNXM<double>& gammaMatOK,
+                                        MatrixNXM<double>& weights );
+};
+
+#endif // KRIGINGSOLVER_H
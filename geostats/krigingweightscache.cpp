@@ -0,0 +1,57 @@
+#include "krigingweightscache.h"
+
+KrigingWeightsCache::KrigingWeightsCache( size_t maxBytes ) :
+    m_bytes( 0 ),
+    m_maxBytes( maxBytes )
+{
+}
+
+const KrigingWeights *KrigingWeightsCache::find( const Key &key )
+{
+    auto it = m_entriesByKey.find( key );
+    if( it == m_entriesByKey.end() )
+        return nullptr;
+    //move the entry to the front (most recently used).
+    m_entries.splice( m_entries.begin(), m_entries, it->second );
+    return &it->second->second;
+}
+
+const KrigingWeights *KrigingWeightsCache::insert( const Key &key, KrigingWeights &&weights )
+{
+    auto it = m_entriesByKey.find( key );
+    if( it != m_entriesByKey.end() ){
+        m_bytes -= getBytes( *it->second );
+        m_entries.erase( it->second );
+        m_entriesByKey.erase( it );
+    }
+    m_entries.emplace_front( key, std::move( weights ) );
+    m_entriesByKey.emplace( key, m_entries.begin() );
+    m_bytes += getBytes( m_entries.front() );
+    //discard the least recently used entries, but never the new one.
+    while( m_bytes > m_maxBytes && m_entries.size() > 1 ){
+        const Entry& last = m_entries.back();
+        m_bytes -= getBytes( last );
+        m_entriesByKey.erase( last.first );
+        m_entries.pop_back();
+    }
+    return &m_entries.front().second;
+}
+
+size_t KrigingWeightsCache::KeyHash::operator()( const Key &key ) const
+{
+    //FNV-1a over the offset indexes.
+    size_t hash = 14695981039346656037ULL;
+    for( uint value : key ){
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+size_t KrigingWeightsCache::getBytes( const Entry &entry )
+{
+    //the key is stored twice (in the list and in the map), plus the overheads of the nodes.
+    return 2 * entry.first.size() * sizeof( uint ) +
+           ( entry.second.weightsSK.size() + entry.second.weightsOK.size() ) * sizeof( double ) +
+           sizeof( Entry ) + 64;
+}
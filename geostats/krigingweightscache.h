@@ -0,0 +1,80 @@
+#ifndef KRIGINGWEIGHTSCACHE_H
+#define KRIGINGWEIGHTSCACHE_H
+
+#include <QtGlobal>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <cstddef>
+
+/** The kriging weights of a configuration of samples (see KrigingWeightsCache). */
+struct KrigingWeights
+{
+    /** The simple kriging weights of the samples.  If the system was ill-conditioned, these are the weights
+     * equivalent to the regularized solution (they give the same estimates). */
+    std::vector<double> weightsSK;
+
+    /** Whether the simple kriging system was ill-conditioned. */
+    bool isIllConditioned;
+
+    /** The ordinary kriging weights of the samples (without the Lagrangian), if they were computed. */
+    std::vector<double> weightsOK;
+
+    /** Whether the ordinary kriging weights are unusable (e.g. they are all zero after the correction
+     * of negative weights). */
+    bool isOKDegenerate;
+
+    KrigingWeights() : isIllConditioned( false ), isOKDegenerate( false ) {}
+};
+
+/**
+ * A cache of kriging weights for searches in regular grids.  On a Cartesian grid, the kriging system of an
+ * estimation location depends only on the relative positions of its samples, which are given by the indexes of their
+ * offsets in the search template (see CartesianGridSearchTemplate), so the same systems repeat for many cells.
+ * With the cache, only the first cell of a configuration solves it and the others just apply its weights to their
+ * sample values.  The memory used is bounded: the least recently used entries are discarded when it is exceeded.
+ * The cache is not thread-safe, so each thread should have its own.
+ */
+class KrigingWeightsCache
+{
+public:
+    /** The indexes of the offsets of the samples, in the order of the samples in the kriging system. */
+    typedef std::vector< uint > Key;
+
+    /** @param maxBytes The approximate maximum amount of memory used by the entries. */
+    explicit KrigingWeightsCache( size_t maxBytes );
+
+    /** Returns the weights stored with the given key, or null if there are none.  The returned object is
+     * valid until the next call to insert(). */
+    const KrigingWeights* find( const Key& key );
+
+    /** Stores the weights of the given key, discarding the least recently used entries if needed.
+     * Returns the stored object, valid until the next call to insert(). */
+    const KrigingWeights* insert( const Key& key, KrigingWeights&& weights );
+
+    /** Returns the number of entries. */
+    size_t size() const { return m_entries.size(); }
+
+private:
+    typedef std::pair< Key, KrigingWeights > Entry;
+    typedef std::list< Entry >::iterator EntryIterator;
+
+    struct KeyHash {
+        size_t operator()( const Key& key ) const;
+    };
+
+    /** The entries, from the most recently used to the least recently used. */
+    std::list< Entry > m_entries;
+
+    /** The entries by their keys. */
+    std::unordered_map< Key, EntryIterator, KeyHash > m_entriesByKey;
+
+    size_t m_bytes;
+    size_t m_maxBytes;
+
+    /** Returns the approximate amount of memory used by an entry. */
+    static size_t getBytes( const Entry& entry );
+};
+
+#endif // KRIGINGWEIGHTSCACHE_H
@@ -15,9 +15,13 @@
 #include "geostats/segmentsetcell.h"
 #include "geostats/pointsetcell.h"
 #include "spatialindex/spatialindex.h"
+#include "spatialindex/simulatednodesindex.h"
+#include "geostats/cartesiangridsearchtemplate.h"
 #include "util.h"
 
 #include <thread>
+#include <cmath>
+#include <memory>
 #include <QApplication>
 #include <QProgressDialog>
 
@@ -160,17 +164,14 @@ bool MCRFSim::isOKtoRun()
             m_lastError = "Number of realizations must be between 1 and 99.";
             return false;
         }
-    }
-
-    //if the user opts to use the Cartesian grid-tuned algorithm, then the neighborhood
-    //becomes a parallelepiped and not a ellipsoid for searches in the simulation grid
-    //hence, any angles set to it are illegal.
-    if( m_commonSimulationParameters->getSearchAlgorithmOptionForSimGrid() == 2){
-        if( m_commonSimulationParameters->getSearchEllipAzimuth() != 0.0 ||
-            m_commonSimulationParameters->getSearchEllipDip() != 0.0 ||
-            m_commonSimulationParameters->getSearchEllipRoll() != 0.0  ){
-            m_lastError = "Cannot set rotation angles if the search algorithm option is 'tuned for Cartesian grids' as the"
-                          " search neighborhood becomes a parallelepiped for searches in the simulation grid.";
+        //the search algorithm option 2 lists the simulation grid cells inside the search ellipsoid by their
+        //anisotropic distances, which do not exist if the ellipsoid is degenerate.
+        if( m_commonSimulationParameters->getSearchAlgorithmOptionForSimGrid() == 2 &&
+            ( m_commonSimulationParameters->getSearchEllipHMax() <= 0.0 ||
+              m_commonSimulationParameters->getSearchEllipHMin() <= 0.0 ||
+              m_commonSimulationParameters->getSearchEllipHVert() <= 0.0 ) ){
+            m_lastError = "The semi-axes of the search ellipsoid must be greater than zero if the search algorithm option"
+                          " is 'tuned for Cartesian grids'.";
             return false;
         }
     }
@@ -184,7 +185,8 @@ bool MCRFSim::useSecondaryData() const
 }
 
 double MCRFSim::simulateOneCellMT(uint i, uint j, uint k,
-                                  std::mt19937 &randomNumberGenerator, const spectral::array& simulatedData ) const
+                                  std::mt19937 &randomNumberGenerator, const spectral::array& simulatedData,
+                                  SimulatedNodesIndex* simulatedNodes ) const
 {
     //compute the vertical cell anisotropy, which is important to normalize the vertical separations.
     //this is important when the sim grid is in depositional domain, which normally has a vertical cell
@@ -203,7 +205,7 @@ double MCRFSim::simulateOneCellMT(uint i, uint j, uint k,
 
     //collect neighboring simulation grid cells ordered by their distance with respect
     //to the simulation cell.
-    DataCellPtrMultiset vNeighboringSimGridCells = getNeighboringSimGridCellsMT( simulationCell, simulatedData );
+    DataCellPtrMultiset vNeighboringSimGridCells = getNeighboringSimGridCellsMT( simulationCell, simulatedData, simulatedNodes );
 
     //make a local copy of the Tau Model (this is potentially a multi-threaded code)
     TauModel tauModelCopy( *m_tauModel );
@@ -471,6 +473,13 @@ void simulateSomeRealizationsThread( uint nRealsForOneThread,
     ulong numberOfSimulationsExecuted = 0;
     ulong reportProgressEveryNumberOfSimulations = 1000;
 
+    //the thread-local index of the cells simulated so far in the current realization, if the user opted
+    //to search only the simulated nodes.
+    std::unique_ptr< SimulatedNodesIndex > simulatedNodes;
+    if( mcrfSim->m_commonSimulationParameters->getSearchAlgorithmOptionForSimGrid() == 3 )
+        simulatedNodes.reset( new SimulatedNodesIndex( cgSim ) );
+    double simGridNDV = cgSim->getNoDataValueAsDouble();
+
     // A lambda function for the random walk generation
     // Note: the "mutable" keyword is in the lambda declaration because we need to capture the distribution and random
     // number generator objects as non-const references, as inherently using them changes their state.
@@ -482,7 +491,9 @@ void simulateSomeRealizationsThread( uint nRealsForOneThread,
     for( uint iRealization = 0; iRealization < nRealsForOneThread; ++iRealization ){
 
         //init realization data with the sim grid's NDV
-        spectral::arrayPtr simulatedData = spectral::arrayPtr( new spectral::array( nI, nJ, nK, cgSim->getNoDataValueAsDouble() ) );
+        spectral::arrayPtr simulatedData = spectral::arrayPtr( new spectral::array( nI, nJ, nK, simGridNDV ) );
+        if( simulatedNodes )
+            simulatedNodes->clear();
 
         //prepare a vector with the random walk (sequence of linear cell indexes to simulate)
         std::vector<ulong> linearIndexesRandomWalk;
@@ -500,9 +511,12 @@ void simulateSomeRealizationsThread( uint nRealsForOneThread,
             uint i, j, k;
             cgSim->indexToIJK( iCellLinearIndex, i, j, k );
             //simulate the cell (attention: may return the simulation grid's no-data value)
-            double catCode = mcrfSim->simulateOneCellMT( i, j, k, randomNumberGenerator, *simulatedData );
+            double catCode = mcrfSim->simulateOneCellMT( i, j, k, randomNumberGenerator, *simulatedData, simulatedNodes.get() );
             //save the value to the data array of the realization
             (*simulatedData)( i, j, k ) = catCode;
+            //cells left unsimulated are not conditioning data for the next ones.
+            if( simulatedNodes && ! Util::almostEqual2sComplement( simGridNDV, catCode, 1 ) )
+                simulatedNodes->add( i, j, k );
             //keep track of simulation progress
             ++numberOfSimulationsExecuted;
             if( ! ( numberOfSimulationsExecuted % reportProgressEveryNumberOfSimulations ) )
@@ -603,6 +617,35 @@ bool MCRFSim::run()
                     );
         m_searchStrategyPrimary = SearchStrategyPtr( new SearchStrategy( searchNeighborhood, nb_samples, 0.0, min_nb_samples ) );
         m_searchStrategySimGrid = SearchStrategyPtr( new SearchStrategy( searchNeighborhood, nbSimNodesConditioning, minDistanceBetweensamples, 0 ) );
+
+        //with the search algorithm option 2, the simulation grid cells in the search ellipsoid are listed once
+        //in the order of their anisotropic distance (honoring the rotation) to the cell being simulated.
+        m_simGridSearchTemplate.reset();
+        if( m_commonSimulationParameters->getSearchAlgorithmOptionForSimGrid() == 2 ){
+            double minX, minY, minZ, maxX, maxY, maxZ;
+            searchNeighborhood->getBBox( 0.0, 0.0, 0.0, minX, minY, minZ, maxX, maxY, maxZ );
+            int nCellsIDirection = 2 * static_cast<int>( std::ceil( maxX / m_cgSim->getDX() ) );
+            int nCellsJDirection = 2 * static_cast<int>( std::ceil( maxY / m_cgSim->getDY() ) );
+            int nCellsKDirection = 2 * static_cast<int>( std::ceil( maxZ / m_cgSim->getDZ() ) );
+            CartesianGridSearchTemplate* searchTemplate = new CartesianGridSearchTemplate( m_cgSim->getNX(),
+                                                                                           m_cgSim->getNY(),
+                                                                                           m_cgSim->getNZ(),
+                                                                                           nCellsIDirection,
+                                                                                           nCellsJDirection,
+                                                                                           nCellsKDirection );
+            Matrix3X3<double> normalizingTransform;
+            if( ! searchNeighborhood->getNormalizingTransform( normalizingTransform ) ){
+                //isOKtoRun() rejects degenerate search ellipsoids, so this is not supposed to happen.
+                delete searchTemplate;
+                Application::instance()->logError( "MCRFSim::run(): the search neighborhood has no normalizing transform"
+                                                   " (degenerate search ellipsoid?).  Simulation aborted." );
+                return false;
+            }
+            searchTemplate->sortByNormalizedDistance( normalizingTransform,
+                                                      m_cgSim->getDX(), m_cgSim->getDY(), m_cgSim->getDZ(),
+                                                      true );
+            m_simGridSearchTemplate.reset( searchTemplate );
+        }
     }
 
     // Build spatial indexes
@@ -621,7 +664,8 @@ bool MCRFSim::run()
             //for the primary data
             if( m_dfPrimary->getFileType() == "POINTSET" ){
                 PointSet* psPrimary = dynamic_cast<PointSet*>( m_dfPrimary );
-                m_spatialIndexOfPrimaryData->fill( psPrimary, m_cgSim->getDX() ); //use cell size as tolerance
+                //the index is saved, so later runs do not rebuild it.
+                m_spatialIndexOfPrimaryData->fillPersistent( psPrimary, m_cgSim->getDX() ); //use cell size as tolerance
             } else if (m_dfPrimary->getFileType() == "SEGMENTSET") {
                 SegmentSet* ssPrimary = dynamic_cast<SegmentSet*>( m_dfPrimary );
                 m_spatialIndexOfPrimaryData->fill( ssPrimary, m_cgSim->getDX() ); //use cell size as tolerance
@@ -631,7 +675,10 @@ bool MCRFSim::run()
             }
         }
         m_spatialIndexOfSimGrid->clear();
-        m_spatialIndexOfSimGrid->fill( m_cgSim );
+        //the index of simulated nodes (option 3) is built by the simulation threads as they go and
+        //the Cartesian grid-tuned search (option 2) does not need an index.
+        if( m_commonSimulationParameters->getSearchAlgorithmOptionForSimGrid() < 2 )
+            m_spatialIndexOfSimGrid->fillPersistent( m_cgSim );
     }
 
 
@@ -800,7 +847,8 @@ DataCellPtrMultiset MCRFSim::getSamplesFromPrimaryMT(const GridCell &simulationC
 }
 
 DataCellPtrMultiset MCRFSim::getNeighboringSimGridCellsMT(const GridCell &simulationCell,
-                                                          const spectral::array& simulatedData) const
+                                                          const spectral::array& simulatedData,
+                                                          SimulatedNodesIndex* simulatedNodes) const
 {
     DataCellPtrMultiset result;
     if( m_searchStrategySimGrid && m_cgSim ){
@@ -815,22 +863,28 @@ DataCellPtrMultiset MCRFSim::getNeighboringSimGridCellsMT(const GridCell &simula
             samplesIndexes = m_spatialIndexOfSimGrid->getNearestWithinGenericRTreeBased( simulationCell, *m_searchStrategySimGrid );
         else if( m_commonSimulationParameters->getSearchAlgorithmOptionForSimGrid() == 1 )
             samplesIndexes = m_spatialIndexOfSimGrid->getNearestWithinTunedForLargeDataSets( simulationCell, *m_searchStrategySimGrid );
-        else{
-            uint nCellsIDirection = m_commonSimulationParameters->getSearchEllipHMin() / m_cgSim->getDX() * 2.0;
-            uint nCellsJDirection = m_commonSimulationParameters->getSearchEllipHMax() / m_cgSim->getDY() * 2.0;
-            uint nCellsKDirection = m_commonSimulationParameters->getSearchEllipHVert() / m_cgSim->getDZ() * 2.0;
-            if( nCellsIDirection < 1 ) nCellsIDirection = 1;
-            if( nCellsJDirection < 1 ) nCellsJDirection = 1;
-            if( nCellsKDirection < 1 ) nCellsKDirection = 1;
-            //The simulation grid is necessarily a Cartesian grid
-            samplesIndexes = m_spatialIndexOfSimGrid->getNearestFromCartesianGrid( simulationCell,
-                                                                                   *m_searchStrategySimGrid,
-                                                                                   true,
-                                                                                   m_simGridNDV,
-                                                                                   nCellsIDirection,
-                                                                                   nCellsJDirection,
-                                                                                   nCellsKDirection,
-                                                                                   &simulatedData.d_ );
+        else if( m_commonSimulationParameters->getSearchAlgorithmOptionForSimGrid() == 3 ){
+            //only the cells simulated so far are visited.
+            std::vector<uint> simulatedIndexes;
+            simulatedNodes->getNearestWithin( simulationCell._indexIJK._i, simulationCell._indexIJK._j, simulationCell._indexIJK._k,
+                                              *m_searchStrategySimGrid, simulatedIndexes );
+            for( uint index : simulatedIndexes )
+                samplesIndexes.push_back( index );
+        } else {
+            //The simulation grid is necessarily a Cartesian grid: walk the precompiled neighborhood.
+            std::vector<uint> neighbors( std::min<size_t>( m_searchStrategySimGrid->m_nb_samples, m_simGridSearchTemplate->size() ) );
+            const std::vector<double>& values = simulatedData.d_;
+            double simGridNDV = m_simGridNDV;
+            size_t nNeighbors = m_simGridSearchTemplate->gather( simulationCell._indexIJK._i,
+                                                                 simulationCell._indexIJK._j,
+                                                                 simulationCell._indexIJK._k,
+                                                                 neighbors.size(),
+                                                                 [&values, simGridNDV]( uint index ){
+                                                                     return ! Util::almostEqual2sComplement( simGridNDV, values[index], 1 );
+                                                                 },
+                                                                 neighbors.data() );
+            for( size_t iNeighbor = 0; iNeighbor < nNeighbors; ++iNeighbor )
+                samplesIndexes.push_back( neighbors[iNeighbor] );
         }
 
         QList<uint>::iterator it = samplesIndexes.begin();
@@ -18,6 +18,8 @@ class VerticalTransiogramModel;
 class CommonSimulationParameters;
 class QProgressDialog;
 class SpatialIndex;
+class SimulatedNodesIndex;
+class CartesianGridSearchTemplate;
 
 /** Enum used to avoid the slow File::getFileType() in performance-critical code. */
 enum class PrimaryDataType : int {
@@ -112,9 +114,12 @@ public:
      * @param randomNumberGenerator The random number generator ( one per thread is advisable ).
      * @param simulatedData Pointer to the realization data so it is possible to retrieve the previously
      *                      simulated values.
+     * @param simulatedNodes The index of the cells simulated so far in the realization, which is required if
+     *                       the search algorithm option for the simulation grid is 3 (simulated nodes only).
      */
     double simulateOneCellMT( uint i, uint j , uint k,
-                              std::mt19937& randomNumberGenerator, const spectral::array& simulatedData ) const;
+                              std::mt19937& randomNumberGenerator, const spectral::array& simulatedData,
+                              SimulatedNodesIndex* simulatedNodes ) const;
 
     /** Sets or increases the current simulation progress counter to the given ammount.
      * Mind that this function updates a progress bar, which is a costly operation.
@@ -164,6 +169,9 @@ private:
     std::shared_ptr<SpatialIndex> m_spatialIndexOfSimGrid;
     //!@}
 
+    /** The neighborhood of the simulation grid cells used with the search algorithm option 2. */
+    std::shared_ptr<const CartesianGridSearchTemplate> m_simGridSearchTemplate;
+
     /** An enum value to avoid iterative calls to slow File::getFileType(). */
     PrimaryDataType m_primaryDataType;
 
@@ -194,9 +202,11 @@ private:
      * required parameter for the search to work is missing.  The data cells are ordered
      * by their distance to the passed simulation cell.
      * This method also needs to query the previously simulated data, which is passed as a parameter.
+     * With the search algorithm option 3, only the simulated cells (those in simulatedNodes) are visited.
      */
     DataCellPtrMultiset getNeighboringSimGridCellsMT(const GridCell& simulationCell ,
-                                                     const spectral::array &simulatedData) const;
+                                                     const spectral::array &simulatedData,
+                                                     SimulatedNodesIndex* simulatedNodes ) const;
 
 };
 
@@ -6,10 +6,45 @@
 #include "gridcell.h"
 #include "geostatsutils.h"
 #include "ndvestimation.h"
+#include "cartesiangridsearchtemplate.h"
+#include "cartesiangridcovariancetable.h"
+#include "krigingsolver.h"
+#include "krigingweightscache.h"
+#include "compiledvariogrammodel.h"
 #include "util.h"
 #include "imagejockey/imagejockeyutils.h"
 #include "spectral/spectral.h"
 
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+/** Covariance matrices with estimated condition numbers above this are deemed ill-conditioned (near-singular):
+ * their factorizations lose about half of the significant digits of a double. */
+const double MAX_CONDITION_NUMBER = 1.0e8;
+
+/** The maximum number of lags in the covariance table (about 128MB).  Larger search neighborhoods evaluate
+ * the variogram model for each pair of samples instead. */
+const size_t MAX_COVARIANCE_TABLE_LAGS = 16 * 1024 * 1024;
+
+/** The total memory budget for the caches of kriging weights (split among the estimation threads). */
+const size_t KRIGING_WEIGHTS_CACHE_BYTES = 256 * 1024 * 1024;
+
+/** The buffers and the cache of kriging weights used by each estimation thread. */
+struct KrigingWorkspace {
+    std::vector<uint> neighbors;
+    std::vector<uint> offsetIndexes;
+    std::vector<double> values;
+    KrigingWeightsCache::Key key;
+    KrigingWeightsCache weightsCache;
+
+    KrigingWorkspace( size_t maxNumSamples, size_t cacheBytes ) :
+        neighbors( maxNumSamples ),
+        offsetIndexes( maxNumSamples ),
+        weightsCache( cacheBytes )
+    {}
+};
+
 enum class FlagState : char {
     NOT_SET = 0,
     TO_SET,
@@ -21,7 +56,12 @@ NDVEstimationRunner::NDVEstimationRunner(NDVEstimation *ndvEstimation, Attribute
     QObject(parent),
     _finished( false ),
     _at(at),
-    _ndvEstimation(ndvEstimation)
+    _ndvEstimation(ndvEstimation),
+    _dX( 0.0 ), _dY( 0.0 ), _dZ( 0.0 )
+{
+}
+
+NDVEstimationRunner::~NDVEstimationRunner()
 {
 }
 
@@ -45,6 +85,9 @@ void NDVEstimationRunner::doRun()
     std::vector<FlagState> mask;
     mask.reserve(nI * nJ * nK);
 
+    //the valued cells are also flagged in a bitmap for the sample searches.
+    _isValued.assign( nI * nJ * nK, false );
+
     //sets the flags for valued cells
     for( uint k = 0; k <nK; ++k){
         for( uint j = 0; j <nJ; ++j){
@@ -52,8 +95,10 @@ void NDVEstimationRunner::doRun()
                 double value = cg->dataIJK( atIndex, i, j, k );
                 if( cg->isNDV( value ) )
                     mask.push_back( FlagState::NOT_SET );
-                else
+                else {
                     mask.push_back( FlagState::SET );
+                    _isValued[ i + j*nI + k*nJ*nI ] = true;
+                }
             }
         }
     }
@@ -102,15 +147,9 @@ set_flag:               mask[ i + j*nI + k*nJ*nI ] = flagToSet;
                         mask[ i + j*nI + k*nJ*nI ] = FlagState::SET;
     }
 
-    //prepare the vector with the results (to not overwrite the original data)
-    _results.clear();
-    _results.reserve( nI * nJ * nK );
-
-    //get the no-data-value configuration
-    bool hasNDV = cg->hasNoDataValue();
-    double NDV = -999.0;
-    if( hasNDV )
-        NDV = cg->getNoDataValueAsDouble();
+    //prepare the vector with the results (to not overwrite the original data).
+    //each cell has its own element, so the estimation threads write their results directly.
+    _results.assign( nI * nJ * nK, 0.0 );
 
     //define what value to assign to an estimated cell in absence of values in the search neighborhood
     double valueForNoValuesInNeighborhood;
@@ -121,309 +160,189 @@ set_flag:               mask[ i + j*nI + k*nJ*nI ] = flagToSet;
         //...or assign a no-data-value.
         valueForNoValuesInNeighborhood = _ndvEstimation->ndv();
 
-    //get the sill in a separate variable because VariogramModel::getSill() is slow.
-    double variogramSill = _ndvEstimation->vmodel()->getSill();
-
-    //reads variogram parameters from file
+    //reads variogram parameters from file and compiles them: the estimation uses only the compiled
+    //model, which is faster than the model's getters and can be shared by the threads.  The threads must
+    //not call GeostatsUtils::getGamma(VariogramModel*,...), which fetches the model's current compilation:
+    //the one held by this run stays the same even if the model is changed or reread meanwhile.
     _ndvEstimation->vmodel()->readParameters();
-
-    //disable reread in model's getters to improve performance
-    _ndvEstimation->vmodel()->setForceReread( false );
-
-    //for all grid cells
-    int nCopies = 0;
-    int nTrivial = 0;
-    int nKriging = 0;
-	int nIllConditioned = 0;
-	int nFailed = 0;
-    for( uint k = 0; k <nK; ++k)
-        for( uint j = 0; j <nJ; ++j){
-			emit setLabel("Running estimation:\n" + QString::number(nCopies) + " copies of values.\n" +
-						  QString::number(nTrivial) + " trivial cases.\n" +
-						  QString::number(nKriging) + " actual kriging operations (" +
-						  QString::number(nIllConditioned) + " ill-conditioned, " +
-						  QString::number(nFailed) + " failed). " );
-            emit progress( j * nI + k * nI * nJ );
-			for( uint i = 0; i <nI; ++i){
-                double value = cg->dataIJK( atIndex, i, j, k );
-                if( cg->isNDV( value ) ){
+    _vmodel = _ndvEstimation->vmodel()->getCompiled();
+    double variogramSill = _vmodel->getSill();
+
+    //make the search neighborhood once: the cells in it are ordered by the variogram, so the samples
+    //most correlated to the estimation location (honoring the anisotropy) are taken first.
+    _searchTemplate.reset( new CartesianGridSearchTemplate( nI, nJ, nK,
+                                                            _ndvEstimation->searchNumCols(),
+                                                            _ndvEstimation->searchNumRows(),
+                                                            _ndvEstimation->searchNumSlices() ) );
+    _dX = cg->getDX();
+    _dY = cg->getDY();
+    _dZ = cg->getDZ();
+    _searchTemplate->sortByVariogram( *_vmodel, _dX, _dY, _dZ );
+    //the covariances between any two cells of the search neighborhood (lags up to twice its extents).
+    _covarianceTable.reset();
+    uint maxLagI = 2 * _searchTemplate->getMaxDi();
+    uint maxLagJ = 2 * _searchTemplate->getMaxDj();
+    uint maxLagK = 2 * _searchTemplate->getMaxDk();
+    if( CartesianGridCovarianceTable::getNumberOfLags( maxLagI, maxLagJ, maxLagK ) <= MAX_COVARIANCE_TABLE_LAGS )
+        _covarianceTable.reset( new CartesianGridCovarianceTable( *_vmodel, _dX, _dY, _dZ,
+                                                                  maxLagI, maxLagJ, maxLagK ) );
+    //a non-positive maximum number of samples means no limit.
+    size_t maxNumSamples = _searchTemplate->size();
+    if( _ndvEstimation->searchMaxNumSamples() > 0 )
+        maxNumSamples = std::min<size_t>( _ndvEstimation->searchMaxNumSamples(), maxNumSamples );
+
+    //the rows of cells are handed to the threads as they finish the previous ones.  Each cell is estimated
+    //only from the original values, so the results do not depend on the number of threads nor on which
+    //thread estimates which cell.
+    size_t nRows = static_cast<size_t>( nJ ) * nK;
+    std::atomic< size_t > nextRow( 0 );
+    std::atomic< size_t > nRowsDone( 0 );
+    std::atomic< int > nCopies( 0 );
+    std::atomic< int > nTrivial( 0 );
+    std::atomic< int > nKriging( 0 );
+    std::atomic< int > nIllConditioned( 0 );
+    std::atomic< int > nFailed( 0 );
+    double meanSK = _ndvEstimation->meanForSK();
+    unsigned int nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+    auto estimateRows = [&](){
+        //the workspace of this thread.  Each thread has its own cache of kriging weights, so
+        //no locking is needed.
+        KrigingWorkspace workspace( maxNumSamples, KRIGING_WEIGHTS_CACHE_BYTES / nThreads );
+        for( size_t iRow = nextRow++; iRow < nRows; iRow = nextRow++ ){
+            uint j = iRow % nJ;
+            uint k = iRow / nJ;
+            int rowCopies = 0, rowTrivial = 0, rowKriging = 0, rowIllConditioned = 0, rowFailed = 0;
+            for( uint i = 0; i <nI; ++i){
+                size_t cellIndex = i + j*nI + k*nJ*nI;
+                if( ! _isValued[ cellIndex ] ){
                     //found an unvalued cell, call krige() only if we're sure we have at least one valued
                     //cell in the neighborhood.
-                    if( mask[ i + j*nI + k*nJ*nI ] == FlagState::SET ){
-						GridCell cell(cg, atIndex, i,j,k);
+                    if( mask[ cellIndex ] == FlagState::SET ){
+                        GridCell cell(cg, atIndex, i,j,k);
                         //estimate if at least one value exists in the neighborhood
-                        ++nKriging;
-						_results.push_back( krige( cell , _ndvEstimation->meanForSK(), hasNDV, NDV, variogramSill, nIllConditioned, nFailed ) );
+                        ++rowKriging;
+                        _results[ cellIndex ] = krige( cell , meanSK, variogramSill, workspace, rowIllConditioned, rowFailed );
                     } else {
-                        ++nTrivial;
-                        _results.push_back( valueForNoValuesInNeighborhood );
+                        ++rowTrivial;
+                        _results[ cellIndex ] = valueForNoValuesInNeighborhood;
                     }
                 }
                 else{
-                    ++nCopies;
-                    _results.push_back( value ); //simple copy from valued cells
+                    ++rowCopies;
+                    _results[ cellIndex ] = cg->dataIJKConst( atIndex, i, j, k ); //simple copy from valued cells
                 }
             }
+            nCopies += rowCopies;
+            nTrivial += rowTrivial;
+            nKriging += rowKriging;
+            nIllConditioned += rowIllConditioned;
+            nFailed += rowFailed;
+            ++nRowsDone;
         }
+    };
+    std::vector< std::thread > threads;
+    for( unsigned int iThread = 0; iThread < nThreads && iThread < nRows; ++iThread )
+        threads.emplace_back( estimateRows );
+
+    //report the progress while the threads work.
+    while( nRowsDone < nRows ){
+        emit setLabel("Running estimation:\n" + QString::number(nCopies) + " copies of values.\n" +
+                      QString::number(nTrivial) + " trivial cases.\n" +
+                      QString::number(nKriging) + " actual kriging operations (" +
+                      QString::number(nIllConditioned) + " ill-conditioned, " +
+                      QString::number(nFailed) + " failed). " );
+        emit progress( nRowsDone * nI );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+    }
+    for( std::thread& thread : threads )
+        thread.join();
 
-    //restore automatic reread in model's getters
-    _ndvEstimation->vmodel()->setForceReread( true );
+    if( nFailed > 0 )
+        Application::instance()->logWarn( "NDVEstimationRunner::doRun(): " + QString::number( nFailed ) +
+                                          " kriging operation(s) failed (resulted in NaN or infinity).  " +
+                                          QString::number( valueForNoValuesInNeighborhood ) +
+                                          " was assigned to protect the output data file." );
 
     //inform the calling thread computation has finished
     _finished = true;
 }
 
-double NDVEstimationRunner::krige(GridCell cell, double meanSK, bool hasNDV, double NDV, double variogramSill,
-								  int& nIllConditioned, int& nFailed )
+double NDVEstimationRunner::krige(GridCell cell, double meanSK, double variogramSill,
+								  KrigingWorkspace& workspace, int& nIllConditioned, int& nFailed ) const
 {
-    double result = std::numeric_limits<double>::quiet_NaN();
-
-    //collects valued n-neighbors ordered by their topological distance with respect
-    //to the target cell
-	GridCellPtrMultiset vCells;
+	double result = std::numeric_limits<double>::quiet_NaN();
 
 	//collects the data samples (depend on the search neighborhood)
-    GeostatsUtils::getValuedNeighborsTopoOrdered( cell,
-                                                           _ndvEstimation->searchMaxNumSamples(),
-                                                           _ndvEstimation->searchNumCols(),
-                                                           _ndvEstimation->searchNumRows(),
-                                                           _ndvEstimation->searchNumSlices(),
-                                                           hasNDV,
-                                                           NDV,
-                                                           vCells);
-
-	//Make a copy of the sample collection but with generic versions of the objects for the methods transparent to grid information.
-	DataCellPtrMultiset vDataCells( vCells.begin(), vCells.end() );
-
-    //if no sample was found, either...
-	if( vCells.empty() ){
-        if( _ndvEstimation->useDefaultValue() )
-            //...return a default value (e.g. a global mean or expected value).
-            return _ndvEstimation->defaultValue();
-        else
-            //...or return a no-data-value.
-            return _ndvEstimation->ndv();
-    }
+	size_t nSamples = _searchTemplate->gather( cell._indexIJK._i, cell._indexIJK._j, cell._indexIJK._k,
+											   workspace.neighbors.size(), _isValued,
+											   workspace.neighbors.data(), workspace.offsetIndexes.data() );
 
-	//get the matrix of the theoretical covariances between the data sample locations and themselves.
-	// TODO PERFORMANCE: the cov matrix needs only to be computed once.
-	MatrixNXM<double> covMat = GeostatsUtils::makeCovMatrix( vDataCells,
-															 _ndvEstimation->vmodel(),
-                                                             variogramSill );
-
-	//get the gamma matrix (theoretical covariances between sample locations and estimation location)
-	MatrixNXM<double> gammaMat = GeostatsUtils::makeGammaMatrix( vDataCells, cell, _ndvEstimation->vmodel(), variogramSill );
-
-	//The eta (after greek letter eta) number is the threshold below which the eigenvalues are rounded off to zero
-	//The eta number and the value are both in Mohammadi et al (2016) paper (see complete reference further below).
-	double eta = 0.001;
-
-	//test whether the covariance matrix is ill-conditioned (near-singular).
-	//an ill-conditioned matrix has a bad numerical invert.
-	bool is_cov_matrix_ill_conditioned = false;
-	int cov_matrix_rank = 0;
-	spectral::array eigenvectors, eigenvalues;
-	std::tie( eigenvectors, eigenvalues ) = spectral::eig( covMat.toSpectralArray() );
-	{
-		double smallestEigenValue = std::numeric_limits<double>::max();
-		double largestEigenValue = 0; //since the cov table is positive definite, the smallest value possible is zero.
-		for( int i = 0; i < eigenvalues.size(); ++i ){
-			double eigenvalue = eigenvalues(i);
-			//since the cov table is positive definite, there is no need to compute the absolute value.
-			if( eigenvalue < smallestEigenValue )
-				smallestEigenValue = eigenvalue;
-			if( eigenvalue > largestEigenValue )
-				largestEigenValue = eigenvalue;
-			if( eigenvalue > eta )
-				cov_matrix_rank = i;
-		}
-		++cov_matrix_rank;
-		double condition_number = largestEigenValue / smallestEigenValue;
-		if( condition_number > 10 ){
-			is_cov_matrix_ill_conditioned = true;
-			++nIllConditioned;
-		}
-	}
-
-	//make the kriging weights matrix (solve the kriging system).
-	MatrixNXM<double> weightsSK( vCells.size() );
-	if( is_cov_matrix_ill_conditioned ){
-		spectral::array weightsSKSpectral = weightsSK.toSpectralArray();
-		//make a spectral::array matrix from the data values (response values).
-		spectral::array y( vCells.size() );
-		{ //make the response-value (sample values) vector y.
-			GridCellPtrMultiset::iterator vit = vCells.begin();
-			for( int i = 0; vit != vCells.end(); ++vit, ++i )
-				y(i) = (*vit)->readValueFromGrid() - meanSK; //these values are actually the residuals with respect to the SK mean.
-		}
-		//Compute the kriging weights with the Pseudoinverse Regularization proposed by Mohammadi et al (2016) - Equation 12.
-		// "An analytic comparison of regularization methods for Gaussian Processes" - https://arxiv.org/pdf/1602.00853.pdf
-		for( int i = 0; i < cov_matrix_rank; ++i) {
-			spectral::array eigenvector = eigenvectors.getVectorColumn( i );
-			spectral::array eigenvectorT = spectral::transpose( eigenvector );
-			weightsSKSpectral += ( (eigenvectorT * y) / eigenvalues(i) )(0) * eigenvector; //the (0) is to take the single matrix element as a scalar an not as an product-incompatible matrix.
-		}
-		weightsSK = MatrixNXM<double>( weightsSKSpectral );
-	} else { // if the cov matrix is well conditioned, the kriging weights are computed the traditional way.
-		//invert the covariance matrix.
-		covMat.invertWithGaussJordan();
-		//get the kriging weights vector: [w] = [Cov]^-1 * [gamma]
-		weightsSK = covMat * gammaMat;  //covMat is inverted
+	//if no sample was found, either...
+	if( nSamples == 0 ){
+		if( _ndvEstimation->useDefaultValue() )
+			//...return a default value (e.g. a global mean or expected value).
+			return _ndvEstimation->defaultValue();
+		else
+			//...or return a no-data-value.
+			return _ndvEstimation->ndv();
 	}
 
-    //finally, compute the kriging
-    if( _ndvEstimation->ktype() == KrigingType::SK ){
-        //for SK mode
-        result = meanSK;
-		if( is_cov_matrix_ill_conditioned ){
-			//see Mohammadi et al (2016) - Equation 13.
-			result += (gammaMat.getTranspose() * weightsSK)(0,0); //(0,0) is to get the single element as a scalar and not as a matrix object.
-		} else {
-			//computing SK the normal way.
-			GridCellPtrMultiset::iterator itSamples = vCells.begin();
-			for( uint i = 0; i < vCells.size(); ++i, ++itSamples){
-				result += weightsSK(i,0) * ( (*itSamples)->readValueFromGrid() - meanSK );
-			}
-		}
-    } else {
+	//get the kriging weights of this configuration of samples, solving the kriging system only if
+	//it is not in the cache.
+	workspace.key.assign( workspace.offsetIndexes.begin(), workspace.offsetIndexes.begin() + nSamples );
+	const KrigingWeights* weights = workspace.weightsCache.find( workspace.key );
+	if( ! weights )
+		weights = workspace.weightsCache.insert( workspace.key, computeWeights( workspace.key, variogramSill ) );
+	if( weights->isIllConditioned )
+		++nIllConditioned;
+
+	//fetch the sample values.
+	workspace.values.resize( nSamples );
+	for( size_t i = 0; i < nSamples; ++i )
+		workspace.values[i] = cell._grid->dataConst( workspace.neighbors[i], cell._dataIndex );
+	const std::vector<double>& values = workspace.values;
+	const std::vector<double>& weightsSK = weights->weightsSK;
+
+	//finally, compute the kriging
+	if( _ndvEstimation->ktype() == KrigingType::SK ){
+		//for SK mode (with ill-conditioned matrices, the weights are those of the regularized solution,
+		//see Mohammadi et al (2016) - Equation 13).
+		result = meanSK;
+		for( size_t i = 0; i < nSamples; ++i )
+			result += weightsSK[i] * ( values[i] - meanSK );
+	} else {
 		//for OK mode
 
-		//get the OK gamma matrix (theoretical covariances between sample locations and estimation location)
-		//TODO: improve performance: Just append 1 to gammaMat.
-		MatrixNXM<double> gammaMatOK = GeostatsUtils::makeGammaMatrix( vDataCells, cell, _ndvEstimation->vmodel(), variogramSill, KrigingType::OK );
-
-		//make the OK cov matrix (theoretical covariances between sample locations and themselves)
-		//TODO: improve performance: Just expand SK matrices with the 1.0s and 0.0s instead of computing new ones.
-		// TODO PERFORMANCE: the cov matrix needs only to be computed once.
-		MatrixNXM<double> covMatOK = GeostatsUtils::makeCovMatrix( vDataCells,
-                                                                   _ndvEstimation->vmodel(),
-                                                                   variogramSill,
-                                                                   KrigingType::OK );
-
-		//get rank, eigenvalues and eigenvectors of the OK covariance matrix
-		int cov_matrix_rankOK = 0;
-		spectral::array eigenvectorsOK, eigenvaluesOK;
-		std::tie( eigenvectorsOK, eigenvaluesOK ) = spectral::eig( covMatOK.toSpectralArray() );
-		{
-			for( int i = 0; i < eigenvaluesOK.size(); ++i ){
-				double eigenvalue = eigenvaluesOK(i);
-				if( std::abs(eigenvalue) > eta )
-					cov_matrix_rankOK = i;
-			}
-			++cov_matrix_rankOK;
-		}
-
-		//make the OK kriging weights matrix (solve the ordinary kriging system).
-		MatrixNXM<double> weightsOK( vCells.size()+1 ); //+1 is due to the extra lagrangean element in the cov matrix.
-		//invert the covariance matrix.
-		covMatOK.invertWithGaussJordan();
-		//compute the OK weights the normal way (follows the same rationale of SK)
-		weightsOK = covMatOK * gammaMatOK;  //covMatOK is inverted
-
-
-		//Correct OK weights according to Deutsch (1995) - "Correcting for negative weights in ordinary kriging"
-		{
-			// Compute means of: a) covariances between the estimation location and locations with neg weights.
-			//                   b) absolute values of negative weights.
-			double mean_of_abs_value_of_neg_weights = 0.0;
-			double mean_of_cov_between_neg_weights_and_est_location = 0.0;
-			int n_neg_weights = 0;
-			for( int i = 0; i < weightsOK.getN()-1; ++i ){ //N-1 is to not "correct" the lagrangean (the last element in the weights matrix).
-				if( weightsOK(i,0) < 0.0 ){
-					mean_of_abs_value_of_neg_weights += std::abs( weightsOK(i,0) );
-					mean_of_cov_between_neg_weights_and_est_location += gammaMatOK(i,0);
-					++n_neg_weights;
-				}
-			}
-			if( n_neg_weights ){
-				MatrixNXM<double> weightsOKcorrected = weightsOK;
-				mean_of_abs_value_of_neg_weights /= n_neg_weights;
-				mean_of_cov_between_neg_weights_and_est_location /= n_neg_weights;
-
-				// Zero off negative and small positive weights.
-				for( int i = 0; i < weightsOKcorrected.getN()-1; ++i ){
-					if( weightsOKcorrected(i,0) < 0.0 )
-						weightsOKcorrected(i,0) = 0.0;
-					else if( weightsOKcorrected(i,0) > 0.0 ){
-						double cov = gammaMatOK(i,0);
-						double weight = weightsOKcorrected(i,0);
-						if( cov < mean_of_cov_between_neg_weights_and_est_location &&
-							weight < mean_of_abs_value_of_neg_weights )
-							weightsOKcorrected(i,0) = 0.0;
-					}
-				}
-				// Re-standardize weights so they sum up to 1.0 again.
-				double sum_from_i_to_end = 0.0;
-				for( int a = 0; a < weightsOKcorrected.getN()-1; ++a )
-					sum_from_i_to_end += weightsOKcorrected(a, 0);
-				for( int i = 0; i < weightsOKcorrected.getN()-1; ++i ){
-					if( sum_from_i_to_end > 0.0 )
-						weightsOKcorrected(i, 0) /= sum_from_i_to_end;
-					else
-						weightsOKcorrected(i, 0) = 0.0;
-				}
-				// Replace the original weights with the corrected ones.
-				weightsOK = weightsOKcorrected;
-				//Check
-				double sum = 0.0;
-				for( int i = 0; i < weightsOK.getN()-1; ++i )
-					sum += weightsOK(i, 0);
-				if( sum < 0.0001 ){
-					if( _ndvEstimation->useDefaultValue() )
-						return _ndvEstimation->defaultValue();
-					else
-						return _ndvEstimation->ndv();
-				}
-			}
+		//the OK weights may be unusable after the correction for negative weights.
+		if( weights->isOKDegenerate ){
+			if( _ndvEstimation->useDefaultValue() )
+				return _ndvEstimation->defaultValue();
+			else
+				return _ndvEstimation->ndv();
 		}
 
 		//Estimate the OK local mean (use OK weights)
 		double mOK = 0.0;
-		GridCellPtrMultiset::iterator itSamples = vCells.begin();
-		for( int i = 0; i < weightsOK.getN()-1; ++i, ++itSamples){ //the last element in weightsOK is the Lagrangian (mu)
-			mOK += weightsOK(i,0) * (*itSamples)->readValueFromGrid();
-		}
-
-		// re-make the SK kriging weights matrix (solve the kriging system)
-		// but using mOK as the simple kriging mean.
-		if( is_cov_matrix_ill_conditioned ){
-			weightsSK = MatrixNXM<double>( vCells.size() );
-			spectral::array weightsSKSpectral = weightsSK.toSpectralArray();
-			//make a spectral::array matrix from the data values (response values).
-			spectral::array y( vCells.size() );
-			{ //make the response-value (sample values) vector y.
-				GridCellPtrMultiset::iterator vit = vCells.begin();
-				for( int i = 0; vit != vCells.end(); ++vit, ++i )
-					y(i) = (*vit)->readValueFromGrid() - mOK; //these values are actually the residuals with respect to the SK mean.
-			}
-			//Compute the kriging weights with the Pseudoinverse Regularization proposed by Mohammadi et al (2016) - Equation 12.
-			// "An analytic comparison of regularization methods for Gaussian Processes" - https://arxiv.org/pdf/1602.00853.pdf
-			for( int i = 0; i < cov_matrix_rank; ++i) {
-				spectral::array eigenvector = eigenvectors.getVectorColumn( i );
-				spectral::array eigenvectorT = spectral::transpose( eigenvector );
-				weightsSKSpectral += ( (eigenvectorT * y) / eigenvalues(i) )(0) * eigenvector; //the (0) is to take the single matrix element as a scalar an not as an product-incompatible matrix.
-			}
-			weightsSK = MatrixNXM<double>( weightsSKSpectral );
-		}
+		for( size_t i = 0; i < nSamples; ++i )
+			mOK += weights->weightsOK[i] * values[i];
 
 		//compute the kriging weight for the local OK mean (use SK weights)
-        double wmOK = 1.0;
+		double wmOK = 1.0;
 		//for( int i = 0; i < weightsSK.getN(); ++i){
 			//wmOK -= weightsSK(i,0);   //TODO: somehow only when the OK mean weight is 1.0, results are good.
 		//}
 
 		//krige (with SK weights plus the OK mean (with OK mean weight))
 		result = 0.0;
-		if( is_cov_matrix_ill_conditioned ){
-			//see Mohammadi et al (2016) - Equation 13.
-			result += (gammaMat.getTranspose() * weightsSK)(0,0); //(0,0) is to get the single element as a scalar and not as a matrix object.
+		if( weights->isIllConditioned ){
+			//the regularized SK weights applied to the residuals with respect to the local OK mean.
+			for( size_t i = 0; i < nSamples; ++i )
+				result += weightsSK[i] * ( values[i] - mOK );
 			result += wmOK * mOK;
 		} else {
 			//computing kriging the normal way.
-			GridCellPtrMultiset::iterator itSamples = vCells.begin();
-			for( uint i = 0; i < vCells.size(); ++i, ++itSamples){
-				result += weightsSK(i,0) * ( (*itSamples)->readValueFromGrid() );
-			}
+			for( size_t i = 0; i < nSamples; ++i )
+				result += weightsSK[i] * values[i];
 			result += wmOK * mOK;
 		}
 	}
@@ -437,10 +356,165 @@ double NDVEstimationRunner::krige(GridCell cell, double meanSK, bool hasNDV, dou
 			failValue = _ndvEstimation->defaultValue();
 		else
 			failValue = _ndvEstimation->ndv();
-		Application::instance()->logWarn( "NDVEstimationRunner::krige(): at least one kriging operation failed (resulted in NaN or infinity).  Returning " +
-										  QString::number(failValue) + " to protect the output data file." );
+		//the failures are reported by doRun(), since this runs in many threads.
 		result = failValue;
 	}
 
-    return result;
+	return result;
+}
+
+KrigingWeights NDVEstimationRunner::computeWeights( const std::vector<uint> &offsetIndexes, double variogramSill ) const
+{
+	KrigingWeights weights;
+	bool isPureNugget = _vmodel->isPureNugget();
+	int n = offsetIndexes.size();
+
+	//the sample offsets relative to the estimation location.  Since the covariances depend only
+	//on the separations, the system is the same for every cell with the same configuration of samples.
+	std::vector<const CartesianGridSearchTemplate::Offset*> offsets;
+	offsets.reserve( n );
+	for( uint offsetIndex : offsetIndexes )
+		offsets.push_back( &_searchTemplate->getOffset( offsetIndex ) );
+
+	//the covariance between cells separated by the given lag, looked up in the table if there is one.
+	auto getCovariance = [this, variogramSill]( int di, int dj, int dk ) -> double {
+		if( _covarianceTable )
+			return _covarianceTable->getCovariance( di, dj, dk );
+		return variogramSill - _vmodel->getGamma( di * _dX, dj * _dY, dk * _dZ );
+	};
+
+	//get the matrix of the theoretical covariances between the data sample locations and themselves.
+	MatrixNXM<double> covMat( n, n );
+	for( int i = 0; i < n; ++i )
+		for( int j = 0; j < n; ++j ){
+			//to remove singularity (as in GeostatsUtils::makeCovMatrix()).
+			if( isPureNugget && i != j )
+				covMat(i, j) = variogramSill;
+			else
+				covMat(i, j) = getCovariance( offsets[i]->di - offsets[j]->di,
+											  offsets[i]->dj - offsets[j]->dj,
+											  offsets[i]->dk - offsets[j]->dk );
+		}
+
+	//get the gamma matrix (theoretical covariances between sample locations and estimation location)
+	MatrixNXM<double> gammaMat( n, 1 );
+	for( int i = 0; i < n; ++i )
+		gammaMat(i, 0) = getCovariance( offsets[i]->di, offsets[i]->dj, offsets[i]->dk );
+
+	//The eta (after greek letter eta) number is the threshold below which the eigenvalues are rounded off to zero
+	//The eta number and the value are both in Mohammadi et al (2016) paper (see complete reference further below).
+	double eta = 0.001;
+
+	//solve the kriging system by factorizing the covariance matrix, which also tells whether it is
+	//ill-conditioned (near-singular).  An ill-conditioned matrix has a bad numerical solution.
+	MatrixNXM<double> weightsSK( n, 1 );
+	weights.isIllConditioned =
+			KrigingSolver::solveSK( covMat, gammaMat, MAX_CONDITION_NUMBER, weightsSK ) != KrigingSolverStatus::SOLVED;
+	weights.weightsSK.resize( n );
+	if( weights.isIllConditioned ){
+		//only near-singular matrices (or those that could not be factorized) need the eigendecomposition
+		//for the regularization.  Otherwise, the weights of the factorization are used.
+		spectral::array eigenvectors, eigenvalues;
+		std::tie( eigenvectors, eigenvalues ) = spectral::eig( covMat.toSpectralArray() );
+		int cov_matrix_rank = 0;
+		for( int i = 0; i < eigenvalues.size(); ++i ){
+			//since the cov table is positive definite, there is no need to compute the absolute value.
+			if( eigenvalues(i) > eta )
+				cov_matrix_rank = i;
+		}
+		++cov_matrix_rank;
+		//The Pseudoinverse Regularization proposed by Mohammadi et al (2016) - Equations 12 and 13 - estimates
+		//gamma^T * sum( v * v^T * y / lambda ) over the eigenvectors v and eigenvalues lambda of the cov matrix,
+		//with y being the residuals.  This is a linear combination of the residuals, whose coefficients are
+		//sum( v * ( v^T * gamma ) / lambda ).
+		// "An analytic comparison of regularization methods for Gaussian Processes" - https://arxiv.org/pdf/1602.00853.pdf
+		for( int e = 0; e < cov_matrix_rank; ++e ){
+			double vTgamma = 0.0;
+			for( int i = 0; i < n; ++i )
+				vTgamma += eigenvectors(i, e) * gammaMat(i, 0);
+			for( int i = 0; i < n; ++i )
+				weights.weightsSK[i] += eigenvectors(i, e) * vTgamma / eigenvalues(e);
+		}
+	} else {
+		for( int i = 0; i < n; ++i )
+			weights.weightsSK[i] = weightsSK(i, 0);
+	}
+
+	if( _ndvEstimation->ktype() == KrigingType::SK )
+		return weights;
+
+	//make the OK cov and gamma matrices by expanding the SK ones with the 1.0s and 0.0s of the Lagrangian.
+	MatrixNXM<double> covMatOK( n+1, n+1 );
+	MatrixNXM<double> gammaMatOK( n+1, 1 );
+	for( int i = 0; i < n; ++i ){
+		for( int j = 0; j < n; ++j )
+			covMatOK(i, j) = covMat(i, j);
+		covMatOK(n, i) = 1.0; //last row with ones
+		covMatOK(i, n) = 1.0; //last column with ones
+		gammaMatOK(i, 0) = gammaMat(i, 0);
+	}
+	covMatOK(n, n) = 0.0; //last element is zero
+	gammaMatOK(n, 0) = 1.0; //last element is one
+
+	//make the OK kriging weights matrix (solve the ordinary kriging system).
+	//the matrix is symmetric but indefinite (due to the Lagrangian), so it is factorized with LDLT.
+	MatrixNXM<double> weightsOK( n+1, 1 ); //+1 is due to the extra lagrangean element in the cov matrix.
+	//if the system cannot be solved, the NaN weights make the estimates be handled as failures.
+	//the conditioning of the covariance block was already checked (and handled) when solving for the SK weights.
+	if( KrigingSolver::solveOK( covMatOK, gammaMatOK, weightsOK ) == KrigingSolverStatus::FAILED )
+		weightsOK = MatrixNXM<double>( n+1, 1, std::numeric_limits<double>::quiet_NaN() );
+	weights.weightsOK.resize( n );
+	for( int i = 0; i < n; ++i ) //the last element in weightsOK is the Lagrangian (mu)
+		weights.weightsOK[i] = weightsOK(i, 0);
+
+	//Correct OK weights according to Deutsch (1995) - "Correcting for negative weights in ordinary kriging"
+	{
+		std::vector<double>& w = weights.weightsOK;
+		// Compute means of: a) covariances between the estimation location and locations with neg weights.
+		//                   b) absolute values of negative weights.
+		double mean_of_abs_value_of_neg_weights = 0.0;
+		double mean_of_cov_between_neg_weights_and_est_location = 0.0;
+		int n_neg_weights = 0;
+		for( int i = 0; i < n; ++i ){
+			if( w[i] < 0.0 ){
+				mean_of_abs_value_of_neg_weights += std::abs( w[i] );
+				mean_of_cov_between_neg_weights_and_est_location += gammaMatOK(i,0);
+				++n_neg_weights;
+			}
+		}
+		if( n_neg_weights ){
+			mean_of_abs_value_of_neg_weights /= n_neg_weights;
+			mean_of_cov_between_neg_weights_and_est_location /= n_neg_weights;
+
+			// Zero off negative and small positive weights.
+			for( int i = 0; i < n; ++i ){
+				if( w[i] < 0.0 )
+					w[i] = 0.0;
+				else if( w[i] > 0.0 ){
+					double cov = gammaMatOK(i,0);
+					if( cov < mean_of_cov_between_neg_weights_and_est_location &&
+						w[i] < mean_of_abs_value_of_neg_weights )
+						w[i] = 0.0;
+				}
+			}
+			// Re-standardize weights so they sum up to 1.0 again.
+			double sum_from_i_to_end = 0.0;
+			for( int a = 0; a < n; ++a )
+				sum_from_i_to_end += w[a];
+			for( int i = 0; i < n; ++i ){
+				if( sum_from_i_to_end > 0.0 )
+					w[i] /= sum_from_i_to_end;
+				else
+					w[i] = 0.0;
+			}
+			//Check
+			double sum = 0.0;
+			for( int i = 0; i < n; ++i )
+				sum += w[i];
+			if( sum < 0.0001 )
+				weights.isOKDegenerate = true;
+		}
+	}
+
+	return weights;
 }
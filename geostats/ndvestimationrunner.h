@@ -2,10 +2,17 @@
 #define NDVESTIMATIONRUNNER_H
 
 #include <QObject>
+#include <memory>
+#include <vector>
 
 class Attribute;
 class GridCell;
 class NDVEstimation;
+class CartesianGridSearchTemplate;
+class CartesianGridCovarianceTable;
+class CompiledVariogramModel;
+struct KrigingWeights;
+struct KrigingWorkspace;
 
 /** This is an auxiliary class used in NDVEstimation::run() to enable the progress dialog.
  * The estimation takes place in a separate thread, so the progress bar updates.
@@ -17,6 +24,7 @@ class NDVEstimationRunner : public QObject
 
 public:
     explicit NDVEstimationRunner(NDVEstimation* ndvEstimation, Attribute* at, QObject *parent = 0);
+    ~NDVEstimationRunner();
 
     bool isFinished(){ return _finished; }
 
@@ -35,12 +43,36 @@ private:
     NDVEstimation* _ndvEstimation;
     std::vector<double> _results;
 
+    /** The variogram model used in the estimation, compiled once per run.  Its anisotropy transforms belong
+     * to this run, so the estimation threads share no state with other users of the variogram model.
+     */
+    std::shared_ptr<const CompiledVariogramModel> _vmodel;
+
+    /** The search neighborhood, ordered by the variogram model. */
+    std::unique_ptr<CartesianGridSearchTemplate> _searchTemplate;
+
+    /** The covariances between the cells of the search neighborhood, if the table is not too large. */
+    std::unique_ptr<CartesianGridCovarianceTable> _covarianceTable;
+
+    /** Flags the grid cells with values (those that can be samples). */
+    std::vector<bool> _isValued;
+
+    /** The cell sizes of the grid. */
+    double _dX, _dY, _dZ;
+
 	/** Estimate, by kriging, a single cell.
+	 * It can be called by many threads at once.
+	 * @param workspace The calling thread's buffers and cache of kriging weights.
 	 * @param nIllConditioned its value is increased by the number of ill-conditioned kriging matrices encountered.
 	 * @param nFailed its value is increased by the number of kriging operations that failed (resulted in NaN or inifinity).
 	 */
-	double krige(GridCell cell , double meanSK, bool hasNDV, double NDV, double variogramSill,
-				 int& nIllConditioned, int & nFailed);
+	double krige(GridCell cell , double meanSK, double variogramSill,
+				 KrigingWorkspace& workspace, int& nIllConditioned, int & nFailed) const;
+
+	/** Solves the kriging system for samples at the given offsets (see CartesianGridSearchTemplate::getOffset())
+	 * from the estimation location.
+	 */
+	KrigingWeights computeWeights( const std::vector<uint>& offsetIndexes, double variogramSill ) const;
 };
 
 #endif // NDVESTIMATIONRUNNER_H
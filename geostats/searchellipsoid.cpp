@@ -2,6 +2,7 @@
 #include "imagejockey/imagejockeyutils.h"
 #include "searchstrategy.h"
 #include <utility>
+#include <algorithm>
 #include <iostream>
 
 typedef std::pair<IndexedSpatialLocationPtr, double> IndexedSpatialLocationPtr_and_Distance_Pair;
@@ -159,28 +160,64 @@ bool SearchEllipsoid::isInside( double centerX, double centerY, double centerZ,
     return dx*dx + dy*dy + dz*dz <= 1.0;
 }
 
+bool SearchEllipsoid::getNormalizingTransform( Matrix3X3<double>& transform ) const
+{
+	//a degenerate ellipsoid has no such transform.
+	if( m_hMin <= 0.0 || m_hMax <= 0.0 || m_hVert <= 0.0 )
+		return false;
+	//Same as isInside(): the rotated X, Y and Z are divided by hMin, hMax and hVert, respectively.
+	Matrix3X3<double> scaling( 1.0 / m_hMin, 0.0,          0.0,
+							   0.0,          1.0 / m_hMax, 0.0,
+							   0.0,          0.0,          1.0 / m_hVert );
+	transform = scaling * m_rotationTransform;
+	return true;
+}
+
+bool SearchEllipsoid::getSectorFilter(uint &numberOfSectors, uint &minSamplesPerSector, uint &maxSamplesPerSector) const
+{
+    if( ! hasSpatialFiltering() )
+        return false;
+    numberOfSectors = m_numberOfSectors;
+    minSamplesPerSector = m_minSamplesPerSector;
+    maxSamplesPerSector = m_maxSamplesPerSector;
+    return true;
+}
+
+uint SearchEllipsoid::getSector(double centerX, double centerY, double x, double y) const
+{
+    //Get the azimuth with respect to the reference location.
+    double azimuth = ImageJockeyUtils::getAzimuth( x, y, centerX, centerY );
+    //Compute the azimth span (it is the same for all the sectors).
+    int azimuthSpan = std::max( 1, static_cast<int>( 360.0 / m_numberOfSectors ) );
+    //The truncated span does not divide 360 exactly for some numbers of sectors (e.g. 7), so the last
+    //sector takes the remainder.
+    int sector = static_cast<int>(azimuth) / azimuthSpan; //integer division
+    return std::min<uint>( std::max( 0, sector ), m_numberOfSectors - 1 );
+}
+
 void SearchEllipsoid::performSpatialFilter(double centerX, double centerY, double centerZ,
 										   std::vector<IndexedSpatialLocationPtr>& samplesLocations,
-										   const SearchStrategy & parentSearchStrategy) const
+										   const SearchStrategy & parentSearchStrategy,
+										   bool rankByNormalizedDistance ) const
 {
-	Q_UNUSED( centerZ );
+	//The samples may be ranked by their distances in the normalized space of the ellipsoid.
+	Matrix3X3<double> normalizingTransform;
+	bool useNormalizedDistance = rankByNormalizedDistance && getNormalizingTransform( normalizingTransform );
 	//Create the azimuth bins.
 	std::vector< std::vector<IndexedSpatialLocationPtr_and_Distance_Pair> > bins( m_numberOfSectors );
-	//Compute the azimth span (it is the same for all the bins).
-	double azimuthSpan = 360.0 / m_numberOfSectors;
 	//For each sample location.
 	{
 		std::vector<IndexedSpatialLocationPtr>::iterator it = samplesLocations.begin();
 		for( ; it != samplesLocations.end(); ++it ){
 			IndexedSpatialLocationPtr sampleLocation = *it;
-			//Get its azimuth with respect to the reference location.
-			double azimuth = ImageJockeyUtils::getAzimuth( sampleLocation->_x, sampleLocation->_y, centerX, centerY );
-			//Compute the index of the bin corresponding to the azimuth.
-			int binIndex = static_cast<int>(azimuth) / static_cast<int>(azimuthSpan); //integer division
+			//Compute the index of the bin corresponding to its azimuth with respect to the reference location.
+			uint binIndex = getSector( centerX, centerY, sampleLocation->_x, sampleLocation->_y );
 			//Compute the distance between the location and the reference location
 			double dx = sampleLocation->_x - centerX;
 			double dy = sampleLocation->_y - centerY;
 			double dz = sampleLocation->_z - centerZ;
+			if( useNormalizedDistance )
+				GeostatsUtils::transform( normalizingTransform, dx, dy, dz );
 			double distance = std::sqrt( dx*dx + dy*dy + dz*dz );
 			//assign the location (with the distance to the reference location)  to its bin.
 			bins[binIndex].emplace_back( sampleLocation, distance );
@@ -24,18 +24,29 @@ public:
 	virtual bool isInside(double centerX, double centerY, double centerZ,
 						  double x, double y, double z ) const;
 
+	/** The transform is the rotation (m_rotationTransform) followed by the division by the semi-axes. */
+	virtual bool getNormalizingTransform( Matrix3X3<double>& transform ) const;
+
 	/** If the user set just one sector (entire azimuth span) then effectivelly there is no filtering. */
 	virtual bool hasSpatialFiltering() const { return m_numberOfSectors > 1; }
 
+	/** Returns the sector parameters if there is more than one sector. */
+	virtual bool getSectorFilter( uint& numberOfSectors, uint& minSamplesPerSector, uint& maxSamplesPerSector ) const;
+
+	/** The sectors are equal azimuth spans clockwise from north. */
+	virtual uint getSector( double centerX, double centerY, double x, double y ) const;
+
 	/** The search ellipsoid's spatial filter divides the azimuth range into a number of sectors (given by m_numberOfSectors),
 	 * then the locations are put into azimuth bins (each corresponding to a sector).  If the minimum number of samples (given by
 	 * m_minSamplesPerSector) is not reached in one of the bins, the list is emptied (search fails).  If a bin has more samples
 	 * than allowed (given by m_maxSamplesPerSector) then the most distant samples are removed from the respective bin so this
 	 * maximum remains.  Partition only occurs in XY plane, thus the Z coordinate is ignored.
+	 * The distances are the anisotropic ones (see getNormalizingTransform()) if rankByNormalizedDistance is true.
 	 */
 	virtual void performSpatialFilter( double centerX, double centerY, double centerZ,
 									   std::vector< IndexedSpatialLocationPtr >& samplesLocations,
-									   const SearchStrategy& parentSearchStrategy ) const;
+									   const SearchStrategy& parentSearchStrategy,
+									   bool rankByNormalizedDistance ) const;
 ////-------------------------------------------------------------------------------------
 
 
@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 #include "indexedspatiallocation.h"
+#include "matrix3x3.h"
 
 class SearchStrategy;
 
@@ -22,21 +23,46 @@ public:
 	virtual bool isInside(double centerX, double centerY, double centerZ,
 						  double x, double y, double z ) const = 0;
 
+    /** If this neighborhood is an ellipsoid, sets transform with the matrix that maps the offsets from its center
+     * to a space where it is the unit sphere and returns true.  Spatial indexes use it to search directly in that
+     * (anisotropic) space.  The default implementation returns false.
+     */
+    virtual bool getNormalizingTransform( Matrix3X3<double>& transform ) const { Q_UNUSED( transform ); return false; }
+
     /** Returns whether the search neighborhood has some additional spatial filtering
      * other than the simple n-nearest points (e.g. octant/sector search).  That is,
      * whether the implementation has something to do in performSpatialFilter() method.
      */
     virtual bool hasSpatialFiltering() const = 0;
 
+    /** If the spatial filter of this neighborhood is a sector search, sets its parameters and returns true, so
+     * spatial indexes can fill the sectors while they search (see getSector()) instead of calling
+     * performSpatialFilter() on all the samples inside the neighborhood.  The default implementation returns false.
+     * @param minSamplesPerSector If non-zero, the search fails if a sector has fewer samples.
+     * @param maxSamplesPerSector The maximum number of samples (the nearest ones) taken from each sector.
+     */
+    virtual bool getSectorFilter( uint& numberOfSectors, uint& minSamplesPerSector, uint& maxSamplesPerSector ) const {
+        Q_UNUSED( numberOfSectors ); Q_UNUSED( minSamplesPerSector ); Q_UNUSED( maxSamplesPerSector ); return false; }
+
+    /** Returns the sector (in [0, numberOfSectors) as set by getSectorFilter()) of the given location
+     * with respect to the neighborhood centered at (centerX, centerY).  The default implementation returns zero.
+     */
+    virtual uint getSector( double centerX, double centerY, double x, double y ) const {
+        Q_UNUSED( centerX ); Q_UNUSED( centerY ); Q_UNUSED( x ); Q_UNUSED( y ); return 0; }
+
     /**
 	 * Spatially filters the samples locations in the passed vector (e.g. octant/sector search).
      * The result are the locations that remain in the passed vector itself.
 	 * The filtering occurs with the neighborhood centered at the given position.
 	 * @param parentSearchStrategy The search strategy being used in the context where this method is being called.
+	 * @param rankByNormalizedDistance If true, the samples are ranked by their distances in the normalized space of the
+	 *                                 neighborhood (see getNormalizingTransform()), if it has one, instead of
+	 *                                 by their Cartesian distances.
      */
 	virtual void performSpatialFilter( double centerX, double centerY, double centerZ,
 									   std::vector< IndexedSpatialLocationPtr >& samplesLocations,
-									   const SearchStrategy& parentSearchStrategy ) const = 0;
+									   const SearchStrategy& parentSearchStrategy,
+									   bool rankByNormalizedDistance ) const = 0;
 };
 
 typedef std::shared_ptr<SearchNeighborhood> SearchNeighborhoodPtr;
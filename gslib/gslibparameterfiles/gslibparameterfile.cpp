@@ -456,6 +456,7 @@ void GSLibParameterFile::makeParamatersForFactorialKriging()
     GSLibParOption* par_searchAlgorithmOption = new GSLibParOption("", "", "Search algorithm option:");
     par_searchAlgorithmOption->addOption( 0, "Generic R-Tree based (performs well for most data sets on average)");
     par_searchAlgorithmOption->addOption( 1, "Tuned for large, high-density data sets (may run slow for small data sets)");
+    par_searchAlgorithmOption->addOption( 2, "Nearest by anisotropic distance (best for elongated search ellipsoids)");
     par_searchAlgorithmOption->_selected_value = 0;
     _params.append( par_searchAlgorithmOption );
 }
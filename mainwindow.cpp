@@ -518,6 +518,8 @@ void MainWindow::onProjectContextMenu(const QPoint &mouse_location)
             }
 			if( _right_clicked_file->getFileType() == "GEOGRID" ){
 				_projectContextMenu->addAction("Compute cell volumes", this, SLOT(onGeoGridCellVolumes()));
+				_projectContextMenu->addAction("Export mesh as text...", this, SLOT(onGeoGridExportMeshAsText()));
+				_projectContextMenu->addAction("Import mesh from text...", this, SLOT(onGeoGridImportMeshFromText()));
 			}
             if( _right_clicked_file->getFileType() == "FACIESTRANSITIONMATRIX" ){
                 _projectContextMenu->addAction("Set/Change associated category definition", this, SLOT(onSetCategoryDefinitionOfAFasciesTransitionMatrix()));
@@ -1475,7 +1477,7 @@ void MainWindow::onLookForDuplicates()
     if( ok ){
         PointSet* ps = (PointSet*)_right_clicked_file;
 		SpatialIndex sip;
-		sip.fill( ps, tolerance );
+		sip.fill( ps, tolerance, SpatialIndexBackend::UNIFORM_GRID );
         uint totFileDataLines = ps->getDataLineCount();
         uint headerLineCount = Util::getHeaderLineCount( ps->getPath() );
         Application::instance()->logInfo( "=======BEGIN OF REPORT============" );
@@ -2491,6 +2493,30 @@ void MainWindow::onGeoGridCellVolumes()
     }
 }
 
+void MainWindow::onGeoGridExportMeshAsText()
+{
+	GeoGrid* gg = dynamic_cast<GeoGrid*>( _right_clicked_file );
+	if( gg ){
+		QString path = QFileDialog::getSaveFileName(this, "Export mesh as:", Util::getLastBrowsedDirectory());
+		if( path.isEmpty() )
+			return;
+		if( ! gg->exportMeshAsText( path ) )
+			QMessageBox::critical( this, "Error", "Failed to export the mesh.  Check the message panel for details." );
+	}
+}
+
+void MainWindow::onGeoGridImportMeshFromText()
+{
+	GeoGrid* gg = dynamic_cast<GeoGrid*>( _right_clicked_file );
+	if( gg ){
+		QString path = QFileDialog::getOpenFileName(this, "Choose mesh file in text format:", Util::getLastBrowsedDirectory());
+		if( path.isEmpty() )
+			return;
+		if( ! gg->importMeshFromText( path ) )
+			QMessageBox::critical( this, "Error", "Failed to import the mesh.  Check the message panel for details." );
+	}
+}
+
 void MainWindow::onEMD()
 {
     //Get the Cartesian grid (assumes the Attribute's parent file is one)
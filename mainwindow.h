@@ -199,6 +199,8 @@ private slots:
 	void onSISIMContinuous();
 	void onSISIMCategorical();
 	void onGeoGridCellVolumes();
+	void onGeoGridExportMeshAsText();
+	void onGeoGridImportMeshFromText();
     void onEMD();
     void onGabor();
     void onWavelet();
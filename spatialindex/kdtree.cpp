@@ -0,0 +1,324 @@
+#include "kdtree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+/** Returns the squared distance between a coordinate and an interval [center - halfSize, center + halfSize]. */
+inline double squaredGap( double coordinate, double center, double halfSize )
+{
+    double gap = std::abs( coordinate - center ) - halfSize;
+    return gap > 0.0 ? gap * gap : 0.0;
+}
+
+}
+
+KdTree::KdTree() :
+    m_tolerance{ 0.0, 0.0, 0.0 },
+    m_maxHalfSize{ 0.0, 0.0, 0.0 }
+{
+}
+
+void KdTree::reserve( size_t nItems )
+{
+    m_nodes.reserve( nItems );
+}
+
+void KdTree::add( double x, double y, double z, uint32_t index )
+{
+    m_nodes.push_back( Node{ { x, y, z }, index, 0 } );
+    //the half sizes of points are only stored once a box is added.
+    if( ! m_halfSizes.empty() )
+        m_halfSizes.insert( m_halfSizes.end(), 3, 0.0 );
+}
+
+void KdTree::add( double x, double y, double z, double halfSizeX, double halfSizeY, double halfSizeZ, uint32_t index )
+{
+    if( m_halfSizes.empty() )
+        m_halfSizes.resize( m_nodes.size() * 3, 0.0 );
+    m_nodes.push_back( Node{ { x, y, z }, index, 0 } );
+    m_halfSizes.push_back( halfSizeX );
+    m_halfSizes.push_back( halfSizeY );
+    m_halfSizes.push_back( halfSizeZ );
+}
+
+void KdTree::build( double tolerance )
+{
+    build( tolerance, tolerance, tolerance );
+}
+
+void KdTree::build( double toleranceX, double toleranceY, double toleranceZ )
+{
+    m_tolerance[0] = toleranceX;
+    m_tolerance[1] = toleranceY;
+    m_tolerance[2] = toleranceZ;
+    for( int axis = 0; axis < 3; ++axis )
+        m_maxHalfSize[axis] = m_tolerance[axis];
+    for( size_t i = 0; i < m_halfSizes.size(); ++i )
+        m_maxHalfSize[i % 3] = std::max( m_maxHalfSize[i % 3], m_halfSizes[i] + m_tolerance[i % 3] );
+
+    //the tree is built as a permutation of the items, which are then gathered in tree order.
+    std::vector< uint32_t > order( m_nodes.size() );
+    for( size_t i = 0; i < order.size(); ++i )
+        order[i] = static_cast<uint32_t>( i );
+    std::vector< uint32_t > axes( m_nodes.size(), 0 );
+    buildRange( order, axes, 0, m_nodes.size() );
+
+    std::vector< Node > nodes( m_nodes.size() );
+    for( size_t i = 0; i < order.size(); ++i ){
+        nodes[i] = m_nodes[ order[i] ];
+        nodes[i].axis = axes[i];
+    }
+    m_nodes.swap( nodes );
+    if( ! m_halfSizes.empty() ){
+        std::vector< double > halfSizes( m_halfSizes.size() );
+        for( size_t i = 0; i < order.size(); ++i )
+            for( int axis = 0; axis < 3; ++axis )
+                halfSizes[ i * 3 + axis ] = m_halfSizes[ order[i] * 3 + axis ];
+        m_halfSizes.swap( halfSizes );
+    }
+}
+
+void KdTree::buildRange( std::vector<uint32_t> &order, std::vector<uint32_t> &axes, size_t begin, size_t end )
+{
+    while( end - begin > 1 ){
+        //split along the axis of largest spread
+        double min[3], max[3];
+        for( int axis = 0; axis < 3; ++axis ){
+            min[axis] = max[axis] = m_nodes[ order[begin] ].center[axis];
+        }
+        for( size_t i = begin + 1; i < end; ++i ){
+            const double* center = m_nodes[ order[i] ].center;
+            for( int axis = 0; axis < 3; ++axis ){
+                min[axis] = std::min( min[axis], center[axis] );
+                max[axis] = std::max( max[axis], center[axis] );
+            }
+        }
+        uint32_t splitAxis = 0;
+        for( uint32_t axis = 1; axis < 3; ++axis )
+            if( max[axis] - min[axis] > max[splitAxis] - min[splitAxis] )
+                splitAxis = axis;
+
+        size_t middle = begin + ( end - begin ) / 2;
+        const std::vector< Node >& nodes = m_nodes;
+        std::nth_element( order.begin() + begin, order.begin() + middle, order.begin() + end,
+                          [&nodes, splitAxis]( uint32_t a, uint32_t b ){
+                              return nodes[a].center[splitAxis] < nodes[b].center[splitAxis]; } );
+        axes[middle] = splitAxis;
+
+        //recurse on the smaller side and loop on the other to bound the stack depth.
+        if( middle - begin < end - middle - 1 ){
+            buildRange( order, axes, begin, middle );
+            begin = middle + 1;
+        } else {
+            buildRange( order, axes, middle + 1, end );
+            end = middle;
+        }
+    }
+}
+
+double KdTree::getHalfSize( size_t node, int axis ) const
+{
+    if( m_halfSizes.empty() )
+        return m_tolerance[axis];
+    return m_halfSizes[ node * 3 + axis ] + m_tolerance[axis];
+}
+
+void KdTree::findNearest( double x, double y, double z, size_t n, std::vector<DistanceAndIndex> &result ) const
+{
+    result.clear();
+    if( n == 0 || m_nodes.empty() )
+        return;
+    result.reserve( n );
+    const double location[3] = { x, y, z };
+    //result is used as a max-heap of the n best items so far.
+    findNearestInRange( 0, m_nodes.size(), location, n, result );
+    std::sort_heap( result.begin(), result.end() );
+}
+
+void KdTree::findNearestInRange( size_t begin, size_t end, const double (&location)[3], size_t n,
+                                 std::vector<DistanceAndIndex> &heap ) const
+{
+    while( begin < end ){
+        size_t middle = begin + ( end - begin ) / 2;
+        const Node& node = m_nodes[middle];
+
+        //test the node's item
+        DistanceAndIndex candidate( squaredGap( location[0], node.center[0], getHalfSize( middle, 0 ) ) +
+                                    squaredGap( location[1], node.center[1], getHalfSize( middle, 1 ) ) +
+                                    squaredGap( location[2], node.center[2], getHalfSize( middle, 2 ) ),
+                                    node.index );
+        if( heap.size() < n ){
+            heap.push_back( candidate );
+            std::push_heap( heap.begin(), heap.end() );
+        } else if( candidate < heap.front() ){
+            std::pop_heap( heap.begin(), heap.end() );
+            heap.back() = candidate;
+            std::push_heap( heap.begin(), heap.end() );
+        }
+
+        if( end - begin == 1 )
+            return;
+
+        //visit the side of the location first
+        uint32_t axis = node.axis;
+        double offset = location[axis] - node.center[axis];
+        size_t nearBegin = begin, nearEnd = middle, farBegin = middle + 1, farEnd = end;
+        if( offset > 0.0 ){
+            std::swap( nearBegin, farBegin );
+            std::swap( nearEnd, farEnd );
+        }
+        findNearestInRange( nearBegin, nearEnd, location, n, heap );
+
+        //the far side can only have better items if its boxes can be closer than the worst item so far.
+        double farGap = squaredGap( location[axis], node.center[axis], m_maxHalfSize[axis] );
+        if( heap.size() == n && farGap > heap.front().first )
+            return;
+        begin = farBegin;
+        end = farEnd;
+    }
+}
+
+void KdTree::findNearestAnisotropic(double x, double y, double z, const double (&transform)[3][3],
+                                    size_t n, double maxDistance, std::vector<DistanceAndIndex> &result) const
+{
+    result.clear();
+    if( n == 0 || m_nodes.empty() )
+        return;
+    result.reserve( std::min( n, m_nodes.size() ) );
+    const double location[3] = { x, y, z };
+
+    double gapFactors[3];
+    getAnisotropicGapFactors( transform, gapFactors );
+    findNearestAnisotropicInRange( 0, m_nodes.size(), location, transform, gapFactors, n,
+                                   maxDistance * maxDistance, result );
+    std::sort_heap( result.begin(), result.end() );
+}
+
+void KdTree::getAnisotropicGapFactors(const double (&transform)[3][3], double (&gapFactors)[3])
+{
+    //An offset of g along an axis has an anisotropic length of at least g / |row of the inverse transform|, which
+    //is the extent along that axis of the unit sphere mapped back to world space (e.g. the half sizes of the
+    //bounding box of a search ellipsoid).
+    const double (&t)[3][3] = transform;
+    double cofactors[3][3] = {
+        { t[1][1] * t[2][2] - t[1][2] * t[2][1], t[1][2] * t[2][0] - t[1][0] * t[2][2], t[1][0] * t[2][1] - t[1][1] * t[2][0] },
+        { t[0][2] * t[2][1] - t[0][1] * t[2][2], t[0][0] * t[2][2] - t[0][2] * t[2][0], t[0][1] * t[2][0] - t[0][0] * t[2][1] },
+        { t[0][1] * t[1][2] - t[0][2] * t[1][1], t[0][2] * t[1][0] - t[0][0] * t[1][2], t[0][0] * t[1][1] - t[0][1] * t[1][0] } };
+    double determinant = t[0][0] * cofactors[0][0] + t[0][1] * cofactors[0][1] + t[0][2] * cofactors[0][2];
+    for( int axis = 0; axis < 3; ++axis ){
+        //the inverse is the transposed cofactor matrix over the determinant, so its rows are the cofactor columns.
+        double rowNorm = std::sqrt( cofactors[0][axis] * cofactors[0][axis] +
+                                    cofactors[1][axis] * cofactors[1][axis] +
+                                    cofactors[2][axis] * cofactors[2][axis] ) / std::abs( determinant );
+        gapFactors[axis] = 1.0 / rowNorm;
+        //a degenerate transform disables pruning along the axis.
+        if( ! std::isfinite( gapFactors[axis] ) )
+            gapFactors[axis] = 0.0;
+    }
+}
+
+void KdTree::findNearestAnisotropicInRange(size_t begin, size_t end, const double (&location)[3],
+                                           const double (&transform)[3][3], const double (&gapFactors)[3],
+                                           size_t n, double maxSquaredDistance,
+                                           std::vector<DistanceAndIndex> &heap) const
+{
+    while( begin < end ){
+        size_t middle = begin + ( end - begin ) / 2;
+        const Node& node = m_nodes[middle];
+
+        //test the node's item
+        double offset[3] = { node.center[0] - location[0], node.center[1] - location[1], node.center[2] - location[2] };
+        double squaredDistance = 0.0;
+        for( int row = 0; row < 3; ++row ){
+            double component = transform[row][0] * offset[0] + transform[row][1] * offset[1] + transform[row][2] * offset[2];
+            squaredDistance += component * component;
+        }
+        DistanceAndIndex candidate( squaredDistance, node.index );
+        if( squaredDistance <= maxSquaredDistance ){
+            if( heap.size() < n ){
+                heap.push_back( candidate );
+                std::push_heap( heap.begin(), heap.end() );
+            } else if( candidate < heap.front() ){
+                std::pop_heap( heap.begin(), heap.end() );
+                heap.back() = candidate;
+                std::push_heap( heap.begin(), heap.end() );
+            }
+        }
+
+        if( end - begin == 1 )
+            return;
+
+        //visit the side of the location first
+        uint32_t axis = node.axis;
+        double axisOffset = location[axis] - node.center[axis];
+        size_t nearBegin = begin, nearEnd = middle, farBegin = middle + 1, farEnd = end;
+        if( axisOffset > 0.0 ){
+            std::swap( nearBegin, farBegin );
+            std::swap( nearEnd, farEnd );
+        }
+        findNearestAnisotropicInRange( nearBegin, nearEnd, location, transform, gapFactors, n, maxSquaredDistance, heap );
+
+        //the far side can only have better items if the anisotropic length of the offset to the split can be
+        //smaller than the worst distance so far (or the maximum distance).
+        double farGap = axisOffset * gapFactors[axis];
+        double worstSquaredDistance = heap.size() == n ? heap.front().first : maxSquaredDistance;
+        if( farGap * farGap > worstSquaredDistance )
+            return;
+        begin = farBegin;
+        end = farEnd;
+    }
+}
+
+void KdTree::findIntersecting( double minX, double minY, double minZ,
+                               double maxX, double maxY, double maxZ,
+                               std::vector<uint32_t> &result ) const
+{
+    const double min[3] = { minX, minY, minZ };
+    const double max[3] = { maxX, maxY, maxZ };
+    findIntersectingInRange( 0, m_nodes.size(), min, max, result );
+}
+
+void KdTree::findIntersectingInRange( size_t begin, size_t end, const double (&min)[3], const double (&max)[3],
+                                      std::vector<uint32_t> &result ) const
+{
+    while( begin < end ){
+        size_t middle = begin + ( end - begin ) / 2;
+        const Node& node = m_nodes[middle];
+
+        //test the node's item
+        bool intersects = true;
+        for( int axis = 0; axis < 3 && intersects; ++axis ){
+            double halfSize = getHalfSize( middle, axis );
+            intersects = node.center[axis] + halfSize >= min[axis] && node.center[axis] - halfSize <= max[axis];
+        }
+        if( intersects )
+            result.push_back( node.index );
+
+        //items on the lower side have centers not greater than the node's and vice-versa.
+        uint32_t axis = node.axis;
+        bool visitLower = node.center[axis] + m_maxHalfSize[axis] >= min[axis];
+        bool visitUpper = node.center[axis] - m_maxHalfSize[axis] <= max[axis];
+        if( visitLower && visitUpper ){
+            findIntersectingInRange( begin, middle, min, max, result );
+            begin = middle + 1;
+        } else if( visitLower )
+            end = middle;
+        else if( visitUpper )
+            begin = middle + 1;
+        else
+            return;
+    }
+}
+
+void KdTree::clear()
+{
+    std::vector< Node >().swap( m_nodes );
+    std::vector< double >().swap( m_halfSizes );
+    for( int axis = 0; axis < 3; ++axis ){
+        m_tolerance[axis] = 0.0;
+        m_maxHalfSize[axis] = 0.0;
+    }
+}
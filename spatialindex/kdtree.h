@@ -0,0 +1,242 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <cmath>
+
+/**
+ * A static k-d tree of 3D items laid out in a single flat array (no pointers between nodes), used by
+ * SpatialIndex as a faster alternative to its R*-tree for point-like data (e.g. samples and short segments).
+ * Each item is an axis-aligned box given by its center and half sizes (zero for points), so queries have the same
+ * semantics as those on boxes in the R*-tree.  The array is ordered so that the node of a range of items is its middle
+ * element: the items before it are on its lower side along the node's split axis and those after it on its upper side.
+ * Searches are pruned with the largest half sizes, so the tree is effective when the boxes are small relative to
+ * the spacing between items.
+ */
+class KdTree
+{
+public:
+    /** A pair of squared distance and item index as returned by findNearest(). */
+    typedef std::pair< double, uint32_t > DistanceAndIndex;
+
+    KdTree();
+
+    /** Pre-allocates memory for the given number of items. */
+    void reserve( size_t nItems );
+
+    /** Adds a point to be indexed.  Call build() after adding all items. */
+    void add( double x, double y, double z, uint32_t index );
+
+    /** Adds a box given its center and half sizes.  Call build() after adding all items. */
+    void add( double x, double y, double z, double halfSizeX, double halfSizeY, double halfSizeZ, uint32_t index );
+
+    /** Builds the tree with the items added so far.
+     * @param tolerance Value added to the half sizes of every item (e.g. boxes around points).
+     */
+    void build( double tolerance );
+
+    /** Same as build( double ) with a different tolerance along each axis (e.g. the half sizes of
+     * Cartesian grid cells, so the cells need not be added as boxes). */
+    void build( double toleranceX, double toleranceY, double toleranceZ );
+
+    /** Returns the tolerance along the given axis passed to build(). */
+    double getTolerance( int axis ) const { return m_tolerance[axis]; }
+
+    /** Finds the n items nearest to the given location.  The distance to an item is that to its box, which is zero
+     * if the location is inside it.  Ties are broken by the lower index.
+     * @param result Output: squared distances and item indexes, nearest first.
+     */
+    void findNearest( double x, double y, double z, size_t n, std::vector< DistanceAndIndex >& result ) const;
+
+    /** Finds the n items nearest to the given location within maxDistance in an anisotropic metric: the distance
+     * to an item is the norm of transform * ( item center - location ).  With the transform that maps a search
+     * ellipsoid centered at the location to the unit sphere, the items inside the ellipsoid are those within
+     * distance 1.  The subtrees are pruned by that distance, so elongated ellipsoids do not visit the many items
+     * in their bounding boxes but outside them.  Ties are broken by the lower index.
+     * @param n The maximum number of items to return (e.g. std::numeric_limits<size_t>::max() for all).
+     * @param result Output: squared anisotropic distances and item indexes, nearest first.
+     */
+    void findNearestAnisotropic( double x, double y, double z, const double (&transform)[3][3],
+                                 size_t n, double maxDistance, std::vector< DistanceAndIndex >& result ) const;
+
+    /** Calls visitor( index ) for every item whose center is within maxDistance of the given location in the
+     * anisotropic metric of findNearestAnisotropic(), in no particular order.  This lets the caller rank or bin the
+     * items by its own criteria during the traversal instead of collecting all of them first.  Before descending into
+     * the far side of a split, the tree calls visitor.canSkip( gap ), where gap is the Euclidean distance from the
+     * location to the split plane, so a visitor that already has all the items it needs closer than that can prune it.
+     */
+    template< typename Visitor >
+    void visitAnisotropic( double x, double y, double z, const double (&transform)[3][3],
+                           double maxDistance, Visitor& visitor ) const;
+
+    /** Finds the items whose boxes intersect (or touch) the given box.  The indexes are appended to result
+     * in no particular order. */
+    void findIntersecting( double minX, double minY, double minZ,
+                           double maxX, double maxY, double maxZ,
+                           std::vector< uint32_t >& result ) const;
+
+    /** Writes the built tree with the given callable, bool write( const char* data, size_t nBytes ), so it can be
+     * restored by read() without rebuilding it.  Returns false if a write fails. */
+    template< typename Write >
+    bool write( Write write ) const;
+
+    /** Restores a tree of nItems items (indexes 0 to nItems-1) saved by write(), reading it with the given callable,
+     * bool read( char* data, size_t nBytes ).  Returns false, leaving the tree empty, if a read fails or the data
+     * is not that of such a tree. */
+    template< typename Read >
+    bool read( Read read, size_t nItems );
+
+    /** Returns the number of items in the tree. */
+    size_t size() const { return m_nodes.size(); }
+
+    bool empty() const { return m_nodes.empty(); }
+
+    /** Empties the tree and frees its memory. */
+    void clear();
+
+private:
+    struct Node {
+        double center[3];
+        uint32_t index;
+        /** The split axis (0 = X, 1 = Y, 2 = Z). */
+        uint32_t axis;
+    };
+
+    /** The nodes/items in tree order. */
+    std::vector< Node > m_nodes;
+    /** The half sizes of the items in tree order (three per node), empty if all items are points. */
+    std::vector< double > m_halfSizes;
+    /** The values added to all half sizes along each axis. */
+    double m_tolerance[3];
+    /** The largest half sizes (tolerance included) along each axis. */
+    double m_maxHalfSize[3];
+
+    /** The fixed-size part of the data saved by write(), which is followed by the nodes and then the half sizes. */
+    struct SerializedHeader {
+        uint64_t nNodes;
+        uint64_t nHalfSizes;
+        double tolerance[3];
+        double maxHalfSize[3];
+    };
+
+    /** Arranges the given range of the permutation of the items (order) as a subtree.  The split axes are
+     * set in axes, which is in tree order. */
+    void buildRange( std::vector< uint32_t >& order, std::vector< uint32_t >& axes, size_t begin, size_t end );
+    double getHalfSize( size_t node, int axis ) const;
+    void findNearestInRange( size_t begin, size_t end, const double (&location)[3], size_t n,
+                             std::vector< DistanceAndIndex >& heap ) const;
+    void findNearestAnisotropicInRange( size_t begin, size_t end, const double (&location)[3],
+                                        const double (&transform)[3][3], const double (&gapFactors)[3],
+                                        size_t n, double maxSquaredDistance,
+                                        std::vector< DistanceAndIndex >& heap ) const;
+    template< typename Visitor >
+    void visitAnisotropicInRange( size_t begin, size_t end, const double (&location)[3],
+                                  const double (&transform)[3][3], const double (&gapFactors)[3],
+                                  double maxSquaredDistance, Visitor& visitor ) const;
+    /** Computes, for each axis, the factor that converts an offset along it to a lower bound of its length
+     * in the anisotropic metric given by the transform. */
+    static void getAnisotropicGapFactors( const double (&transform)[3][3], double (&gapFactors)[3] );
+    void findIntersectingInRange( size_t begin, size_t end, const double (&min)[3], const double (&max)[3],
+                                  std::vector< uint32_t >& result ) const;
+};
+
+template< typename Write >
+bool KdTree::write( Write write ) const
+{
+    SerializedHeader header;
+    header.nNodes = m_nodes.size();
+    header.nHalfSizes = m_halfSizes.size();
+    for( int axis = 0; axis < 3; ++axis ){
+        header.tolerance[axis] = m_tolerance[axis];
+        header.maxHalfSize[axis] = m_maxHalfSize[axis];
+    }
+    return write( reinterpret_cast<const char*>( &header ), sizeof(header) ) &&
+           write( reinterpret_cast<const char*>( m_nodes.data() ), m_nodes.size() * sizeof(Node) ) &&
+           write( reinterpret_cast<const char*>( m_halfSizes.data() ), m_halfSizes.size() * sizeof(double) );
+}
+
+template< typename Read >
+bool KdTree::read( Read read, size_t nItems )
+{
+    clear();
+    SerializedHeader header;
+    //the sizes are checked before allocating anything, so corrupt data cannot cause huge allocations.
+    if( ! read( reinterpret_cast<char*>( &header ), sizeof(header) ) ||
+        header.nNodes != nItems ||
+        ( header.nHalfSizes != 0 && header.nHalfSizes != 3 * header.nNodes ) )
+        return false;
+    m_nodes.resize( header.nNodes );
+    m_halfSizes.resize( header.nHalfSizes );
+    bool ok = read( reinterpret_cast<char*>( m_nodes.data() ), m_nodes.size() * sizeof(Node) ) &&
+              read( reinterpret_cast<char*>( m_halfSizes.data() ), m_halfSizes.size() * sizeof(double) );
+    //the queries assume valid axes and return the indexes as is.
+    for( size_t i = 0; ok && i < m_nodes.size(); ++i )
+        ok = m_nodes[i].axis < 3 && m_nodes[i].index < nItems;
+    if( ! ok ){
+        clear();
+        return false;
+    }
+    for( int axis = 0; axis < 3; ++axis ){
+        m_tolerance[axis] = header.tolerance[axis];
+        m_maxHalfSize[axis] = header.maxHalfSize[axis];
+    }
+    return true;
+}
+
+template< typename Visitor >
+void KdTree::visitAnisotropic( double x, double y, double z, const double (&transform)[3][3],
+                               double maxDistance, Visitor& visitor ) const
+{
+    if( m_nodes.empty() )
+        return;
+    const double location[3] = { x, y, z };
+    double gapFactors[3];
+    getAnisotropicGapFactors( transform, gapFactors );
+    visitAnisotropicInRange( 0, m_nodes.size(), location, transform, gapFactors, maxDistance * maxDistance, visitor );
+}
+
+template< typename Visitor >
+void KdTree::visitAnisotropicInRange( size_t begin, size_t end, const double (&location)[3],
+                                      const double (&transform)[3][3], const double (&gapFactors)[3],
+                                      double maxSquaredDistance, Visitor& visitor ) const
+{
+    while( begin < end ){
+        size_t middle = begin + ( end - begin ) / 2;
+        const Node& node = m_nodes[middle];
+
+        //test the node's item
+        double offset[3] = { node.center[0] - location[0], node.center[1] - location[1], node.center[2] - location[2] };
+        double squaredDistance = 0.0;
+        for( int row = 0; row < 3; ++row ){
+            double component = transform[row][0] * offset[0] + transform[row][1] * offset[1] + transform[row][2] * offset[2];
+            squaredDistance += component * component;
+        }
+        if( squaredDistance <= maxSquaredDistance )
+            visitor( node.index );
+
+        if( end - begin == 1 )
+            return;
+
+        //visit the side of the location first
+        uint32_t axis = node.axis;
+        double axisOffset = location[axis] - node.center[axis];
+        size_t nearBegin = begin, nearEnd = middle, farBegin = middle + 1, farEnd = end;
+        if( axisOffset > 0.0 ){
+            std::swap( nearBegin, farBegin );
+            std::swap( nearEnd, farEnd );
+        }
+        visitAnisotropicInRange( nearBegin, nearEnd, location, transform, gapFactors, maxSquaredDistance, visitor );
+
+        //the far side is out of reach or of no use to the visitor.
+        double farGap = axisOffset * gapFactors[axis];
+        if( farGap * farGap > maxSquaredDistance || visitor.canSkip( std::abs( axisOffset ) ) )
+            return;
+        begin = farBegin;
+        end = farEnd;
+    }
+}
+
+#endif // KDTREE_H
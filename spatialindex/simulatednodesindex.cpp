@@ -0,0 +1,164 @@
+#include "simulatednodesindex.h"
+#include "domain/cartesiangrid.h"
+#include "geostats/searchstrategy.h"
+#include "geostats/searchneighborhood.h"
+
+#include <algorithm>
+
+SimulatedNodesIndex::SimulatedNodesIndex(const CartesianGrid *grid) :
+    m_nI( grid->getNX() ), m_nJ( grid->getNY() ), m_nK( grid->getNZ() ),
+    m_x0( grid->getX0() ), m_y0( grid->getY0() ), m_z0( grid->getZ0() ),
+    m_dX( grid->getDX() ), m_dY( grid->getDY() ), m_dZ( grid->getDZ() ),
+    m_isSimulated( static_cast<size_t>( m_nI ) * m_nJ * m_nK, false )
+{
+    //each level halves the resolution of the one below until a single block covers the grid.
+    Level level = { m_nI, m_nJ, m_nK, {} };
+    m_levels.push_back( level );
+    while( level.nI > 1 || level.nJ > 1 || level.nK > 1 ){
+        level.nI = ( level.nI + 1 ) / 2;
+        level.nJ = ( level.nJ + 1 ) / 2;
+        level.nK = ( level.nK + 1 ) / 2;
+        level.counts.assign( static_cast<size_t>( level.nI ) * level.nJ * level.nK, 0 );
+        m_levels.push_back( level );
+    }
+}
+
+void SimulatedNodesIndex::clear()
+{
+    m_isSimulated.assign( m_isSimulated.size(), false );
+    for( Level& level : m_levels )
+        std::fill( level.counts.begin(), level.counts.end(), 0 );
+}
+
+void SimulatedNodesIndex::add(uint i, uint j, uint k)
+{
+    size_t cellIndex = static_cast<size_t>( k ) * m_nJ * m_nI + j * m_nI + i;
+    if( m_isSimulated[cellIndex] )
+        return;
+    m_isSimulated[cellIndex] = true;
+    for( uint iLevel = 1; iLevel < m_levels.size(); ++iLevel ){
+        Level& level = m_levels[iLevel];
+        ++level.counts[ static_cast<size_t>( k >> iLevel ) * level.nJ * level.nI + ( j >> iLevel ) * level.nI + ( i >> iLevel ) ];
+    }
+}
+
+bool SimulatedNodesIndex::isSimulated(uint i, uint j, uint k) const
+{
+    return m_isSimulated[ static_cast<size_t>( k ) * m_nJ * m_nI + j * m_nI + i ];
+}
+
+void SimulatedNodesIndex::getNearestWithin(uint i, uint j, uint k,
+                                           const SearchStrategy &searchStrategy,
+                                           std::vector<uint> &result)
+{
+    result.clear();
+    uint n = searchStrategy.m_nb_samples;
+    if( n == 0 )
+        return;
+    const SearchNeighborhood& searchNeighborhood = *(searchStrategy.m_searchNB);
+    double minDist = searchStrategy.m_minDistanceBetweenSamples;
+
+    //the search neighborhood is centered at the cell.
+    double x = m_x0 + ( i + 0.5 ) * m_dX;
+    double y = m_y0 + ( j + 0.5 ) * m_dY;
+    double z = m_z0 + ( k + 0.5 ) * m_dZ;
+    double minX, minY, minZ, maxX, maxY, maxZ;
+    searchNeighborhood.getBBox( x, y, z, minX, minY, minZ, maxX, maxY, maxZ );
+
+    //Best-first traversal from the block covering the whole grid: the candidates come out of the heap by increasing
+    //distance (or its lower bound for blocks), so the cells are found nearest first.
+    m_heap.clear();
+    pushIfIntersects( m_levels.size() - 1, 0, 0, 0, x, y, z, minX, minY, minZ, maxX, maxY, maxZ );
+    while( ! m_heap.empty() ){
+        std::pop_heap( m_heap.begin(), m_heap.end() );
+        Candidate candidate = m_heap.back();
+        m_heap.pop_back();
+
+        const Level& level = m_levels[ candidate.level ];
+        uint bi = candidate.index % level.nI;
+        uint bj = ( candidate.index / level.nI ) % level.nJ;
+        uint bk = candidate.index / ( level.nI * level.nJ );
+
+        if( candidate.level == 0 ){
+            double xP = m_x0 + ( bi + 0.5 ) * m_dX;
+            double yP = m_y0 + ( bj + 0.5 ) * m_dY;
+            double zP = m_z0 + ( bk + 0.5 ) * m_dZ;
+            if( ! searchNeighborhood.isInside( x, y, z, xP, yP, zP ) )
+                continue;
+            //if it necessary to impose a minimum distance between samples, skip the cells
+            //too close to one already collected.
+            if( minDist > 0.0 ){
+                bool tooClose = false;
+                for( uint collectedIndex : result ){
+                    uint ci = collectedIndex % m_nI;
+                    uint cj = ( collectedIndex / m_nI ) % m_nJ;
+                    uint ck = collectedIndex / ( m_nI * m_nJ );
+                    double dx = ( static_cast<double>( ci ) - bi ) * m_dX;
+                    double dy = ( static_cast<double>( cj ) - bj ) * m_dY;
+                    double dz = ( static_cast<double>( ck ) - bk ) * m_dZ;
+                    if( dx*dx + dy*dy + dz*dz < minDist * minDist ){
+                        tooClose = true;
+                        break;
+                    }
+                }
+                if( tooClose )
+                    continue;
+            }
+            result.push_back( candidate.index );
+            if( result.size() == n )
+                break;
+            continue;
+        }
+
+        //expand the block into its (up to eight) blocks of the level below.
+        const Level& below = m_levels[ candidate.level - 1 ];
+        for( uint ck = bk * 2; ck < std::min( bk * 2 + 2, below.nK ); ++ck )
+            for( uint cj = bj * 2; cj < std::min( bj * 2 + 2, below.nJ ); ++cj )
+                for( uint ci = bi * 2; ci < std::min( bi * 2 + 2, below.nI ); ++ci )
+                    pushIfIntersects( candidate.level - 1, ci, cj, ck, x, y, z, minX, minY, minZ, maxX, maxY, maxZ );
+    }
+
+    //the search fails if fewer nodes than the minimum number of samples were found.
+    if( result.size() < searchStrategy.m_minNumberOfSamples )
+        result.clear();
+}
+
+void SimulatedNodesIndex::pushIfIntersects(uint level, uint bi, uint bj, uint bk,
+                                           double x, double y, double z,
+                                           double minX, double minY, double minZ,
+                                           double maxX, double maxY, double maxZ)
+{
+    const Level& blocks = m_levels[level];
+    uint index = bk * blocks.nJ * blocks.nI + bj * blocks.nI + bi;
+
+    //skip empty blocks
+    if( level == 0 ){
+        if( ! m_isSimulated[index] )
+            return;
+    } else if( ! blocks.counts[index] )
+        return;
+
+    //the ranges of the cell centers in the block
+    const uint first[3] = { bi << level, bj << level, bk << level };
+    const uint last[3] = { std::min( ( bi + 1 ) << level, m_nI ) - 1,
+                           std::min( ( bj + 1 ) << level, m_nJ ) - 1,
+                           std::min( ( bk + 1 ) << level, m_nK ) - 1 };
+    const double origin[3] = { m_x0, m_y0, m_z0 };
+    const double cellSize[3] = { m_dX, m_dY, m_dZ };
+    const double location[3] = { x, y, z };
+    const double min[3] = { minX, minY, minZ };
+    const double max[3] = { maxX, maxY, maxZ };
+    double squaredDistance = 0.0;
+    for( int axis = 0; axis < 3; ++axis ){
+        double low = origin[axis] + ( first[axis] + 0.5 ) * cellSize[axis];
+        double high = origin[axis] + ( last[axis] + 0.5 ) * cellSize[axis];
+        //no cell in the block is in the bounding box of the search neighborhood.
+        if( high < min[axis] || low > max[axis] )
+            return;
+        double gap = location[axis] < low ? low - location[axis] : ( location[axis] > high ? location[axis] - high : 0.0 );
+        squaredDistance += gap * gap;
+    }
+
+    m_heap.push_back( { squaredDistance, level, index } );
+    std::push_heap( m_heap.begin(), m_heap.end() );
+}
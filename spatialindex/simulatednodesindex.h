@@ -0,0 +1,88 @@
+#ifndef SIMULATEDNODESINDEX_H
+#define SIMULATEDNODESINDEX_H
+
+#include <QtGlobal>
+#include <vector>
+#include <cstdint>
+
+class CartesianGrid;
+class SearchStrategy;
+
+/**
+ * An index of the nodes of a Cartesian grid already simulated in a realization of a sequential simulation.
+ * It grows along the random path (see add()), so neighborhood searches only visit simulated nodes instead of
+ * querying all the grid cells and then rejecting those not simulated yet.  Early in the path, when most of the grid
+ * is empty, the searches end almost immediately.
+ * It is a multi-resolution occupancy grid: level 0 flags the simulated cells and each level above counts the
+ * simulated cells in blocks of 2x2x2 blocks of the level below, up to a single block covering the whole grid.
+ * The searches only descend into blocks with simulated cells, nearest first.
+ * Each realization being simulated (e.g. one per thread) should have its own object, so no locking is needed.
+ * The cell centers follow the convention of GridCell.
+ */
+class SimulatedNodesIndex
+{
+public:
+    explicit SimulatedNodesIndex( const CartesianGrid* grid );
+
+    /** Forgets all simulated nodes (e.g. before simulating another realization). */
+    void clear();
+
+    /** Marks the given cell as simulated. */
+    void add( uint i, uint j, uint k );
+
+    /** Returns whether the given cell was marked as simulated. */
+    bool isSimulated( uint i, uint j, uint k ) const;
+
+    /** Finds up to searchStrategy.m_nb_samples simulated nodes nearest (Euclidean distance) to the given cell
+     * within the search neighborhood centered at it, honoring the minimum distance between samples, if set.
+     * Nodes at the same distance are taken in the order of their linear indexes.
+     * The result is empty if fewer than searchStrategy.m_minNumberOfSamples nodes are found.
+     * @param result Output: the linear indexes (see GridFile::IJKtoIndex()) of the nodes found, nearest first.
+     */
+    void getNearestWithin( uint i, uint j, uint k, const SearchStrategy& searchStrategy, std::vector<uint>& result );
+
+private:
+    /** A search candidate: a cell (level 0) or a block and the lower bound of the squared distance to its cells. */
+    struct Candidate {
+        double squaredDistance;
+        uint level;
+        uint index;
+        /** Orders the heap so the nearest candidate is at the top.  At equal distances, blocks are expanded before
+         * cells are taken and the cells are taken in the order of their indexes. */
+        bool operator<( const Candidate& other ) const {
+            if( squaredDistance != other.squaredDistance )
+                return squaredDistance > other.squaredDistance;
+            if( level != other.level )
+                return level < other.level;
+            return index > other.index;
+        }
+    };
+
+    struct Level {
+        uint nI, nJ, nK;
+        /** Number of simulated cells in each block (empty for level 0, see m_isSimulated). */
+        std::vector< uint32_t > counts;
+    };
+
+    uint m_nI, m_nJ, m_nK;
+    double m_x0, m_y0, m_z0;
+    double m_dX, m_dY, m_dZ;
+
+    /** The simulated flags of the cells. */
+    std::vector< bool > m_isSimulated;
+
+    /** The levels from the cells (0) to the single block covering the grid. */
+    std::vector< Level > m_levels;
+
+    /** The search heap, kept between searches to avoid repeated allocations. */
+    std::vector< Candidate > m_heap;
+
+    /** Pushes the given block (or cell if level == 0) into the search heap if it may have cells inside the
+     * given box, computing the lower bound of the distance from the given location to its cells. */
+    void pushIfIntersects( uint level, uint bi, uint bj, uint bk,
+                           double x, double y, double z,
+                           double minX, double minY, double minZ,
+                           double maxX, double maxY, double maxZ );
+};
+
+#endif // SIMULATEDNODESINDEX_H
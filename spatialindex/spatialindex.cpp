@@ -8,10 +8,121 @@
 #include "domain/cartesiangrid.h"
 #include "domain/geogrid.h"
 #include "domain/segmentset.h"
+#include "geostats/matrix3x3.h"
 
+#include <QFile>
 #include <cassert>
-#include <boost/foreach.hpp>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <limits>
+
+namespace {
+
+//The samples found in the normalized space of a search neighborhood are tested with SearchNeighborhood::isInside()
+//anyway.  This margin keeps those on its surface despite the different round-off of the two computations.
+const double ANISOTROPIC_SEARCH_MARGIN = 1E-6;
+
+/** The kinds of data files whose indexes can be saved by SpatialIndex::fillPersistent(). */
+enum class PersistedDataFileKind : uint32_t {
+    POINT_SET = 1,
+    CARTESIAN_GRID,
+    GEOGRID
+};
+
+/** The fixed-size header at the beginning of the files saved by SpatialIndex::fillPersistent().
+ * The k-d tree follows it (see KdTree::write()). */
+struct SpatialIndexFileHeader {
+    char magic[8];
+    quint32 kind;
+    quint32 backend;
+    FileValidityStamp sourceStamp;
+    double parameters[10];
+    quint64 nItems;
+};
+
+//Change the last char whenever the file layout or KdTree's layout changes, so old indexes get rebuilt.
+const char SPATIAL_INDEX_MAGIC[8] = { 'G', 'R', 'S', 'P', 'I', 'D', 'X', '1' };
+
+void toArray( const Matrix3X3<double>& matrix, double (&array)[3][3] )
+{
+    array[0][0] = matrix._a11; array[0][1] = matrix._a12; array[0][2] = matrix._a13;
+    array[1][0] = matrix._a21; array[1][1] = matrix._a22; array[1][2] = matrix._a23;
+    array[2][0] = matrix._a31; array[2][1] = matrix._a32; array[2][2] = matrix._a33;
+}
 
+/** The KdTree::visitAnisotropic() visitor of SpatialIndex::getNearestWithinSectors().  It keeps the nearest
+ * samples of each sector in bounded max-heaps.  The distances are Euclidean or, if a transform is given,
+ * those in the normalized space of the search neighborhood. */
+class SectorCollector
+{
+public:
+    SectorCollector( DataFile& dataFile, const SearchNeighborhood& searchNeighborhood,
+                     double x, double y, double z, size_t capacity,
+                     std::vector< std::vector< KdTree::DistanceAndIndex > >& sectorHeaps,
+                     const double (*normalizingTransform)[3] = nullptr, double gapFactor = 1.0 ) :
+        m_dataFile( dataFile ),
+        m_searchNeighborhood( searchNeighborhood ),
+        m_x( x ), m_y( y ), m_z( z ),
+        m_capacity( capacity ),
+        m_sectorHeaps( sectorHeaps ),
+        m_nFullSectors( 0 ),
+        m_transform( normalizingTransform ),
+        m_gapFactor( gapFactor )
+    {}
+
+    void operator()( uint32_t index ){
+        double xP, yP, zP;
+        m_dataFile.getDataSpatialLocation( index, xP, yP, zP );
+        if( ! m_searchNeighborhood.isInside( m_x, m_y, m_z, xP, yP, zP ) )
+            return;
+        double dx = xP - m_x, dy = yP - m_y, dz = zP - m_z;
+        if( m_transform ){
+            double nx = m_transform[0][0] * dx + m_transform[0][1] * dy + m_transform[0][2] * dz;
+            double ny = m_transform[1][0] * dx + m_transform[1][1] * dy + m_transform[1][2] * dz;
+            double nz = m_transform[2][0] * dx + m_transform[2][1] * dy + m_transform[2][2] * dz;
+            dx = nx; dy = ny; dz = nz;
+        }
+        KdTree::DistanceAndIndex candidate( dx*dx + dy*dy + dz*dz, index );
+        std::vector< KdTree::DistanceAndIndex >& heap = m_sectorHeaps[ m_searchNeighborhood.getSector( m_x, m_y, xP, yP ) ];
+        if( heap.size() < m_capacity ){
+            heap.push_back( candidate );
+            std::push_heap( heap.begin(), heap.end() );
+            if( heap.size() == m_capacity )
+                ++m_nFullSectors;
+        } else if( candidate < heap.front() ){
+            std::pop_heap( heap.begin(), heap.end() );
+            heap.back() = candidate;
+            std::push_heap( heap.begin(), heap.end() );
+        }
+    }
+
+    /** Beyond the given distance, nothing is of use once every sector has its nearest samples closer than it.
+     * The gap is Euclidean, so it is scaled by the gap factor (a lower bound of the ratio between the normalized
+     * and the Euclidean distances) when ranking by normalized distance. */
+    bool canSkip( double gap ) const {
+        if( m_nFullSectors < m_sectorHeaps.size() )
+            return false;
+        double squaredGap = gap * gap * m_gapFactor * m_gapFactor;
+        for( const std::vector< KdTree::DistanceAndIndex >& heap : m_sectorHeaps )
+            if( squaredGap <= heap.front().first )
+                return false;
+        return true;
+    }
+
+private:
+    DataFile& m_dataFile;
+    const SearchNeighborhood& m_searchNeighborhood;
+    double m_x, m_y, m_z;
+    size_t m_capacity;
+    std::vector< std::vector< KdTree::DistanceAndIndex > >& m_sectorHeaps;
+    size_t m_nFullSectors;
+    const double (*m_transform)[3];
+    double m_gapFactor;
+};
+
+}
 
 void SpatialIndex::setDataFile( DataFile* df ){
 	m_dataFile = df;
@@ -20,7 +131,8 @@ void SpatialIndex::setDataFile( DataFile* df ){
 }
 
 SpatialIndex::SpatialIndex() :
-	m_dataFile( nullptr )
+    m_dataFile( nullptr ),
+    m_backend( SpatialIndexBackend::RSTAR_TREE )
 {
 }
 
@@ -30,7 +142,7 @@ SpatialIndex::~SpatialIndex()
     clear();
 }
 
-void SpatialIndex::fill(PointSet *ps, double tolerance)
+void SpatialIndex::fill(PointSet *ps, double tolerance, SpatialIndexBackend backend)
 {
     //first clear the index.
     clear();
@@ -42,6 +154,31 @@ void SpatialIndex::fill(PointSet *ps, double tolerance)
     if( totlines == 0 )
         Application::instance()->logWarn("SpatialIndex::fill(PointSet *, double): no data.  Make sure data was loaded prior to indexing.");
 
+    if( backend == SpatialIndexBackend::KD_TREE ){
+        m_backend = backend;
+        m_kdTree.reserve( totlines );
+        for( uint iLine = 0; iLine < totlines; ++iLine){
+            double x, y, z;
+            ps->getDataSpatialLocation( iLine, x, y, z );
+            m_kdTree.add( x, y, z, iLine );
+        }
+        //the tolerance makes the k-d tree items the same boxes as those of the R*-tree.
+        m_kdTree.build( tolerance );
+        return;
+    }
+
+    if( backend == SpatialIndexBackend::UNIFORM_GRID ){
+        m_backend = backend;
+        m_uniformGrid.reserve( totlines );
+        for( uint iLine = 0; iLine < totlines; ++iLine){
+            double x, y, z;
+            ps->getDataSpatialLocation( iLine, x, y, z );
+            m_uniformGrid.add( x, y, z, iLine );
+        }
+        m_uniformGrid.build( tolerance, tolerance, tolerance );
+        return;
+    }
+
     std::vector< BoxAndDataIndex > boxes;
     boxes.reserve( totlines );
 
@@ -61,7 +198,7 @@ void SpatialIndex::fill(PointSet *ps, double tolerance)
     m_rtree = RStarRtree( boxes );
 }
 
-void SpatialIndex::fill(CartesianGrid * cg)
+void SpatialIndex::fill(CartesianGrid * cg, SpatialIndexBackend backend)
 {
 	//first clear the index.
 	clear();
@@ -78,6 +215,31 @@ void SpatialIndex::fill(CartesianGrid * cg)
     if( totlines == 0 )
         Application::instance()->logWarn("SpatialIndex::fill(CartesianGrid *): no data.  Make sure data was loaded prior to indexing.");
 
+    if( backend == SpatialIndexBackend::KD_TREE ){
+        m_backend = backend;
+        m_kdTree.reserve( totlines );
+        for( uint iLine = 0; iLine < totlines; ++iLine){
+            double x, y, z;
+            cg->getDataSpatialLocation( iLine, x, y, z );
+            m_kdTree.add( x, y, z, iLine );
+        }
+        //all cells have the same size, so they are indexed as points with the half cell sizes as tolerances.
+        m_kdTree.build( tX, tY, tZ );
+        return;
+    }
+
+    if( backend == SpatialIndexBackend::UNIFORM_GRID ){
+        m_backend = backend;
+        m_uniformGrid.reserve( totlines );
+        for( uint iLine = 0; iLine < totlines; ++iLine){
+            double x, y, z;
+            cg->getDataSpatialLocation( iLine, x, y, z );
+            m_uniformGrid.add( x, y, z, iLine );
+        }
+        m_uniformGrid.build( tX, tY, tZ );
+        return;
+    }
+
     std::vector< BoxAndDataIndex > boxes;
     boxes.reserve( totlines );
 
@@ -96,7 +258,7 @@ void SpatialIndex::fill(CartesianGrid * cg)
     m_rtree = RStarRtree( boxes );
 }
 
-void SpatialIndex::fill(GeoGrid * gg)
+void SpatialIndex::fill(GeoGrid * gg, SpatialIndexBackend backend)
 {
 	//first clear the index.
 	clear();
@@ -112,6 +274,20 @@ void SpatialIndex::fill(GeoGrid * gg)
     if( totlines == 0 )
         Application::instance()->logWarn("SpatialIndex::fill(GeoGrid *): no data.  Make sure data was loaded prior to indexing.");
 
+    if( backend == SpatialIndexBackend::KD_TREE ){
+        m_backend = backend;
+        m_kdTree.reserve( totlines );
+        for( uint iLine = 0; iLine < totlines; ++iLine){
+            //each cell is indexed by the center and the half sizes of its bounding box.
+            double minX, minY, minZ, maxX, maxY, maxZ;
+            gg->getBoundingBox( iLine, minX, minY, minZ, maxX, maxY, maxZ );
+            m_kdTree.add( ( minX + maxX ) / 2, ( minY + maxY ) / 2, ( minZ + maxZ ) / 2,
+                          ( maxX - minX ) / 2, ( maxY - minY ) / 2, ( maxZ - minZ ) / 2, iLine );
+        }
+        m_kdTree.build( 0.0 );
+        return;
+    }
+
     std::vector< BoxAndDataIndex > boxes;
     boxes.reserve( totlines );
 
@@ -130,7 +306,7 @@ void SpatialIndex::fill(GeoGrid * gg)
     m_rtree = RStarRtree( boxes );
 }
 
-void SpatialIndex::fill( SegmentSet *ss, double tolerance )
+void SpatialIndex::fill(SegmentSet *ss, double tolerance, SpatialIndexBackend backend)
 {
     //first clear the index.
     clear();
@@ -143,6 +319,20 @@ void SpatialIndex::fill( SegmentSet *ss, double tolerance )
     if( totlines == 0 )
         Application::instance()->logWarn("SpatialIndex::fill(SegmentSet *, double): no data.  Make sure data was loaded prior to indexing.");
 
+    if( backend == SpatialIndexBackend::KD_TREE ){
+        m_backend = backend;
+        m_kdTree.reserve( totlines );
+        for( uint iLine = 0; iLine < totlines; ++iLine){
+            //each segment is indexed by its midpoint and the half sizes of its bounding box.
+            double minX, minY, minZ, maxX, maxY, maxZ;
+            ss->getBoundingBox( iLine, minX, minY, minZ, maxX, maxY, maxZ );
+            m_kdTree.add( ( minX + maxX ) / 2, ( minY + maxY ) / 2, ( minZ + maxZ ) / 2,
+                          ( maxX - minX ) / 2, ( maxY - minY ) / 2, ( maxZ - minZ ) / 2, iLine );
+        }
+        m_kdTree.build( tolerance );
+        return;
+    }
+
     std::vector< BoxAndDataIndex > boxes;
     boxes.reserve( totlines );
 
@@ -161,6 +351,147 @@ void SpatialIndex::fill( SegmentSet *ss, double tolerance )
     m_rtree = RStarRtree( boxes );
 }
 
+void SpatialIndex::fillPersistent(PointSet *ps, double tolerance)
+{
+    clear();
+    setDataFile( ps );
+
+    //the point locations are in the data file, but the columns with the coordinates are set in the metadata.
+    PersistenceKey key = { static_cast<uint32_t>( PersistedDataFileKind::POINT_SET ),
+                           FileValidityStamp::fromFile( ps->getPath() ),
+                           { tolerance,
+                             static_cast<double>( ps->getXindex() ),
+                             static_cast<double>( ps->getYindex() ),
+                             static_cast<double>( ps->getZindex() ) } };
+    if( key.sourceStamp.isNull() ){
+        fill( ps, tolerance, SpatialIndexBackend::KD_TREE );
+        return;
+    }
+    QString path = getIndexFilePath( ps );
+    if( loadKdTree( path, key ) )
+        return;
+    fill( ps, tolerance, SpatialIndexBackend::KD_TREE );
+    saveKdTree( path, key );
+}
+
+void SpatialIndex::fillPersistent(CartesianGrid *cg)
+{
+    clear();
+    setDataFile( cg );
+
+    //the cells depend only on the grid geometry, whereas the data file changes as variables are added to it
+    //(e.g. realizations), so the parameters alone identify the index.
+    PersistenceKey key = { static_cast<uint32_t>( PersistedDataFileKind::CARTESIAN_GRID ),
+                           FileValidityStamp(),
+                           { cg->getX0(), cg->getY0(), cg->getZ0(),
+                             cg->getDX(), cg->getDY(), cg->getDZ(),
+                             static_cast<double>( cg->getNX() ),
+                             static_cast<double>( cg->getNY() ),
+                             static_cast<double>( cg->getNZ() ),
+                             cg->getRot() } };
+    if( cg->getPath().isEmpty() ){
+        fill( cg, SpatialIndexBackend::KD_TREE );
+        return;
+    }
+    QString path = getIndexFilePath( cg );
+    if( loadKdTree( path, key ) )
+        return;
+    fill( cg, SpatialIndexBackend::KD_TREE );
+    saveKdTree( path, key );
+}
+
+void SpatialIndex::fillPersistent(GeoGrid *gg)
+{
+    clear();
+    setDataFile( gg );
+
+    //the mesh is needed to get the cells' bounding boxes in the queries anyway.
+    gg->loadMesh();
+
+    //the cell geometry is in the mesh file.
+    PersistenceKey key = { static_cast<uint32_t>( PersistedDataFileKind::GEOGRID ),
+                           FileValidityStamp::fromBinaryFile( gg->getMeshFilePath() ),
+                           { 0.0 } };
+    if( key.sourceStamp.isNull() ){
+        fill( gg, SpatialIndexBackend::KD_TREE );
+        return;
+    }
+    QString path = getIndexFilePath( gg );
+    if( loadKdTree( path, key ) )
+        return;
+    fill( gg, SpatialIndexBackend::KD_TREE );
+    saveKdTree( path, key );
+}
+
+QString SpatialIndex::getIndexFilePath(DataFile *df)
+{
+    return df->getPath() + ".spatialindex";
+}
+
+bool SpatialIndex::loadKdTree(const QString &path, const PersistenceKey &key)
+{
+    QFile file( path );
+    if( ! file.exists() || ! file.open( QFile::ReadOnly ) )
+        return false;
+
+    //read and check the header
+    SpatialIndexFileHeader header;
+    quint64 nItems = m_dataFile->getDataLineCount();
+    if( file.read( reinterpret_cast<char*>( &header ), sizeof(header) ) != (qint64)sizeof(header) ||
+        std::memcmp( header.magic, SPATIAL_INDEX_MAGIC, sizeof(SPATIAL_INDEX_MAGIC) ) ||
+        header.kind != key.kind ||
+        header.backend != static_cast<quint32>( SpatialIndexBackend::KD_TREE ) ||
+        header.sourceStamp != key.sourceStamp ||
+        ! std::equal( key.parameters, key.parameters + 10, header.parameters ) ||
+        header.nItems != nItems )
+        return false;
+
+    bool ok = m_kdTree.read( [&file]( char* data, size_t nBytes ){
+                                 return nBytes == 0 || file.read( data, nBytes ) == static_cast<qint64>( nBytes ); },
+                             nItems ) && file.atEnd();
+    if( ! ok ){
+        Application::instance()->logWarn( "SpatialIndex::loadKdTree(): index file " + path + " is corrupt.  Rebuilding it." );
+        m_kdTree.clear();
+        return false;
+    }
+    m_backend = SpatialIndexBackend::KD_TREE;
+    return true;
+}
+
+bool SpatialIndex::saveKdTree(const QString &path, const PersistenceKey &key) const
+{
+    //the index is written to a temporary file first, so a failed save does not leave a corrupt index behind.
+    QFile file( path + ".new" );
+    if( ! file.open( QFile::WriteOnly | QFile::Truncate ) ){
+        Application::instance()->logWarn( "SpatialIndex::saveKdTree(): could not open " + file.fileName() + " for writing." );
+        return false;
+    }
+
+    SpatialIndexFileHeader header;
+    std::memcpy( header.magic, SPATIAL_INDEX_MAGIC, sizeof(SPATIAL_INDEX_MAGIC) );
+    header.kind = key.kind;
+    header.backend = static_cast<quint32>( SpatialIndexBackend::KD_TREE );
+    header.sourceStamp = key.sourceStamp;
+    std::copy( key.parameters, key.parameters + 10, header.parameters );
+    header.nItems = m_kdTree.size();
+    bool ok = file.write( reinterpret_cast<const char*>( &header ), sizeof(header) ) == (qint64)sizeof(header) &&
+              m_kdTree.write( [&file]( const char* data, size_t nBytes ){
+                                  return nBytes == 0 || file.write( data, nBytes ) == static_cast<qint64>( nBytes ); } );
+    file.close();
+
+    if( ! ok ){
+        Application::instance()->logWarn( "SpatialIndex::saveKdTree(): failed to write " + file.fileName() + "." );
+        file.remove();
+        return false;
+    }
+
+    //replace the previous index, if any.
+    QFile previous( path );
+    if( previous.exists() )
+        previous.remove();
+    return file.rename( path );
+}
+
 QList<uint> SpatialIndex::getNearest(uint index, uint n) const
 {
     assert( m_dataFile && "SpatialIndex::getNearest(): No data file.  Make sure you have made a call to fill() prior to making queries.");
@@ -173,9 +504,9 @@ QList<uint> SpatialIndex::getNearest(uint index, uint n) const
     m_dataFile->getDataSpatialLocation( index, x, y, z );
 
     // find n nearest values to a point
+    QueryScratch scratch;
     std::vector<BoxAndDataIndex> result_n;
-    result_n.reserve( n );
-	m_rtree.query(bgi::nearest(Point3D(x, y, z), n), std::back_inserter(result_n));
+    queryNearest( x, y, z, n, scratch, result_n );
 
     // collect the point indexes
     std::vector<BoxAndDataIndex>::iterator it = result_n.begin();
@@ -197,9 +528,9 @@ QList<uint> SpatialIndex::getNearest(double x, double y, double z, uint n) const
     result.reserve( n );
 
 	// find n nearest values to a point
+    QueryScratch scratch;
     std::vector<BoxAndDataIndex> result_n;
-    result_n.reserve( n );
-	m_rtree.query(bgi::nearest(Point3D(x, y, z), n), std::back_inserter(result_n));
+    queryNearest( x, y, z, n, scratch, result_n );
 
 	// collect the point indexes
     std::vector<BoxAndDataIndex>::iterator it = result_n.begin();
@@ -242,12 +573,59 @@ QList<uint> SpatialIndex::getNearestWithin(uint index, uint n, double distance )
 	return result;
 }
 
+QList<uint> SpatialIndex::getWithinDistance(double x, double y, double z, double distance) const
+{
+    assert( m_dataFile && "SpatialIndex::getWithinDistance(): No data file.  Make sure you have made a call to fill() prior to making queries.");
+
+    QList<uint> result;
+    QueryScratch scratch;
+    if( m_backend == SpatialIndexBackend::UNIFORM_GRID ){
+        m_uniformGrid.findWithin( x, y, z, distance, scratch.kdTreeIndexes );
+        result.reserve( scratch.kdTreeIndexes.size() );
+        for( uint32_t index : scratch.kdTreeIndexes )
+            result.push_back( index );
+        return result;
+    }
+
+    //the boxes within the distance are among those intersecting the bounding box of the sphere.
+    Point3D center( x, y, z );
+    std::vector<BoxAndDataIndex> candidates;
+    queryIntersecting( Box( Point3D( x - distance, y - distance, z - distance ),
+                            Point3D( x + distance, y + distance, z + distance ) ), scratch, candidates );
+    for( const BoxAndDataIndex& candidate : candidates )
+        if( bg::comparable_distance( center, candidate.first ) <= distance * distance )
+            result.push_back( candidate.second );
+    return result;
+}
+
 QList<uint> SpatialIndex::getNearestWithinGenericRTreeBased(const DataCell& dataCell, const SearchStrategy & searchStrategy) const
 {
     assert( m_dataFile && "SpatialIndexPoints::getNearestWithin(): No data file.  Make sure you have made a call to fill() prior to making queries.");
-    //TODO: Possible Refactoring: some of the logic in here may in fact belong to the SearchStrategy class.
+
+    //Get the location of the data cell.
+    double x = dataCell._center._x;
+    double y = dataCell._center._y;
+    double z = 0.0; //put 2D data in the z==0.0 plane
+    if( m_dataFile->isTridimensional() )
+        z = dataCell._center._z;
+
+    QueryScratch scratch;
+    std::vector<uint> indexes;
+    getNearestWithinGenericRTreeBased( x, y, z, searchStrategy, scratch, indexes );
 
     QList<uint> result;
+    result.reserve( indexes.size() );
+    for( uint index : indexes )
+        result.push_back( index );
+    return result;
+}
+
+void SpatialIndex::getNearestWithinGenericRTreeBased(double x, double y, double z,
+                                                     const SearchStrategy &searchStrategy,
+                                                     QueryScratch &scratch,
+                                                     std::vector<uint> &result) const
+{
+    //TODO: Possible Refactoring: some of the logic in here may in fact belong to the SearchStrategy class.
 
     //get the desired number of samples.
     uint n = searchStrategy.m_nb_samples;
@@ -261,37 +639,49 @@ QList<uint> SpatialIndex::getNearestWithinGenericRTreeBased(const DataCell& data
     //set a flag to avoid computing distances unnecessarily (performance reason).
     bool useMinDist = minDist > 0.0;
 
-    //Get the location of the data cell.
-    double x = dataCell._center._x;
-    double y = dataCell._center._y;
-    double z = 0.0; //put 2D data in the z==0.0 plane
-    if( m_dataFile->isTridimensional() )
-        z = dataCell._center._z;
-
-    //Get the bounding box as a function of the search neighborhood centered at the data cell.
-    double maxX, maxY, maxZ, minX, minY, minZ;
-    searchNeighborhood.getBBox( x, y, z, minX, minY, minZ, maxX, maxY, maxZ );
-    Box searchBB( Point3D( minX, minY, minZ ),
-                  Point3D( maxX, maxY, maxZ ));
-
-    //Get all the points within the bounding box of the search neighborhood.
-    //This step improves performance because the actual inside/outside test of the search
-    //neighborhood implementation may be slow.
-    std::vector<BoxAndDataIndex> poinsInSearchBB;
-    m_rtree.query( bgi::intersects( searchBB ), std::back_inserter(poinsInSearchBB) );
+    //The sector search, if any, may be done while traversing the index.
+    if( searchStrategy.NBhasSpatialFiltering() && getNearestWithinSectors( x, y, z, searchStrategy, false, scratch, result ) )
+        return;
+
+    std::vector<BoxAndDataIndex>& poinsInSearchBB = scratch.candidates;
+    Matrix3X3<double> normalizingTransform;
+    if( m_backend == SpatialIndexBackend::KD_TREE && searchNeighborhood.getNormalizingTransform( normalizingTransform ) ){
+        //The k-d tree can be searched directly in the normalized space of the search neighborhood, so
+        //the points in its bounding box but outside it are not even visited.
+        double transform[3][3];
+        toArray( normalizingTransform, transform );
+        queryNearestAnisotropic( x, y, z, transform, std::numeric_limits<size_t>::max(), scratch, scratch.collected );
+        poinsInSearchBB.clear();
+        for( const BoxAndDataIndexAndDistance& sample : scratch.collected )
+            poinsInSearchBB.push_back( sample.first );
+    } else {
+        //Get the bounding box as a function of the search neighborhood centered at the data cell.
+        double maxX, maxY, maxZ, minX, minY, minZ;
+        searchNeighborhood.getBBox( x, y, z, minX, minY, minZ, maxX, maxY, maxZ );
+        Box searchBB( Point3D( minX, minY, minZ ),
+                      Point3D( maxX, maxY, maxZ ));
+
+        //Get all the points within the bounding box of the search neighborhood.
+        //This step improves performance because the actual inside/outside test of the search
+        //neighborhood implementation may be slow.
+        queryIntersecting( searchBB, scratch, poinsInSearchBB );
+    }
 
-    //Get all the samples actually inside the search neighborhood.
-    std::vector<BoxAndDataIndex>::iterator it = poinsInSearchBB.begin();
-    typedef bgi::rtree< BoxAndDataIndex, bgi::rstar<16,5,5,32> > RTreeLocal;
-    RTreeLocal rtreeLocal;
+    //Get all the samples actually inside the search neighborhood along with the distances of their boxes
+    //to the center of the neighborhood (the same distance the r-tree uses in n-nearest queries).
+    std::vector<BoxAndDataIndexAndDistance>& samplesInside = scratch.collected;
+    samplesInside.clear();
+    //The local r-tree is only needed to impose the minimum distance between samples.
+    RStarRtree& rtreeLocal = scratch.rtreeLocal;
+    rtreeLocal.clear();
     std::vector<BoxAndDataIndex> resultMinDist;
-    resultMinDist.reserve( 1 );
+    Point3D center( x, y, z );
+    std::vector<BoxAndDataIndex>::iterator it = poinsInSearchBB.begin();
     for(; it != poinsInSearchBB.end(); ++it){
         uint indexP = (*it).second;
         //get the location of the point in the result set.
-        double xP = m_dataFile->getDataSpatialLocation( indexP, CartesianCoord::X );
-        double yP = m_dataFile->getDataSpatialLocation( indexP, CartesianCoord::Y );
-        double zP = m_dataFile->getDataSpatialLocation( indexP, CartesianCoord::Z );
+        double xP, yP, zP;
+        m_dataFile->getDataSpatialLocation( indexP, xP, yP, zP );
         //Test whether the point is actually inside the ellipsoid.
         if( searchNeighborhood.isInside( x, y, z, xP, yP, zP ) ){
             //if it necessary to impose a minimum distance between samples...
@@ -302,9 +692,8 @@ QList<uint> SpatialIndex::getNearestWithinGenericRTreeBased(const DataCell& data
                     rtreeLocal.query(bgi::nearest(Point3D(xP, yP, zP), 1), std::back_inserter(resultMinDist));
                     //get the location of the closest sample already collected.
                     uint indexClosestP = resultMinDist[0].second;
-                    double xClosestP = m_dataFile->getDataSpatialLocation( indexClosestP, CartesianCoord::X );
-                    double yClosestP = m_dataFile->getDataSpatialLocation( indexClosestP, CartesianCoord::Y );
-                    double zClosestP = m_dataFile->getDataSpatialLocation( indexClosestP, CartesianCoord::Z );
+                    double xClosestP, yClosestP, zClosestP;
+                    m_dataFile->getDataSpatialLocation( indexClosestP, xClosestP, yClosestP, zClosestP );
                     //reset the vector used to collect the nearest sample already collected
                     resultMinDist.clear();
                     //compute the distance between the current sample and the nearest sample collected
@@ -315,9 +704,10 @@ QList<uint> SpatialIndex::getNearestWithinGenericRTreeBased(const DataCell& data
                         continue;
                     }
                 }
+                rtreeLocal.insert( *it );
             }
-            //Adds the current sample to a local r-tree for the ensuing n-nearest search.
-            rtreeLocal.insert( *it );
+            //Collects the current sample for the ensuing n-nearest search.
+            samplesInside.push_back( { *it, bg::comparable_distance( center, (*it).first ) } );
         }
     }
 
@@ -326,35 +716,33 @@ QList<uint> SpatialIndex::getNearestWithinGenericRTreeBased(const DataCell& data
     if( searchStrategy.NBhasSpatialFiltering() ){
         //Copy all sample locations found inside the neighborhood to a vector.
         std::vector<IndexedSpatialLocationPtr> locationsToFilter;
-        locationsToFilter.reserve( rtreeLocal.size() );
-        for ( RTreeLocal::const_iterator it = rtreeLocal.begin() ; it != rtreeLocal.end() ; ++it ){
+        locationsToFilter.reserve( samplesInside.size() );
+        for ( const BoxAndDataIndexAndDistance& sample : samplesInside ){
             //Get sample's location given the index stored in the r-tree.
-            double x = m_dataFile->getDataSpatialLocation( (*it).second, CartesianCoord::X );
-            double y = m_dataFile->getDataSpatialLocation( (*it).second, CartesianCoord::Y );
-            double z = m_dataFile->getDataSpatialLocation( (*it).second, CartesianCoord::Z );
-            locationsToFilter.push_back( IndexedSpatialLocationPtr( new IndexedSpatialLocation( x, y, z, (*it).second ) ) );
+            double xS, yS, zS;
+            m_dataFile->getDataSpatialLocation( sample.first.second, xS, yS, zS );
+            locationsToFilter.push_back( IndexedSpatialLocationPtr( new IndexedSpatialLocation( xS, yS, zS, sample.first.second ) ) );
         }
         //Perform spatial filter with respect to the center of the current estimation cell.
-        searchStrategy.m_searchNB->performSpatialFilter( x, y, z, locationsToFilter, searchStrategy );
+        searchStrategy.m_searchNB->performSpatialFilter( x, y, z, locationsToFilter, searchStrategy, false );
         //...Collect the indexes of the samples spatially filtered.
         std::vector<IndexedSpatialLocationPtr>::iterator it = locationsToFilter.begin();
-        for( int count = 0; it != locationsToFilter.end() && count < n ; ++it, ++count)
+        for( uint count = 0; it != locationsToFilter.end() && count < n ; ++it, ++count)
             result.push_back( (*it)->_index );
     //Otherwise, simply get the n-nearest of those found inside the neighborhood.
     } else {
-        std::vector<BoxAndDataIndex> resultNNearest;
-        rtreeLocal.query(bgi::nearest(Point3D(x, y, z), n), std::back_inserter(resultNNearest));
+        size_t nNearest = std::min<size_t>( n, samplesInside.size() );
+        std::partial_sort( samplesInside.begin(), samplesInside.begin() + nNearest, samplesInside.end(),
+                           []( const BoxAndDataIndexAndDistance& a, const BoxAndDataIndexAndDistance& b ){
+                               return a.second < b.second || ( a.second == b.second && a.first.second < b.first.second ); } );
         //If the number of n-neares samples found is greater than or equal the minimum number of samples
         //set in search strategy...
-        if( resultNNearest.size() >= searchStrategy.m_minNumberOfSamples ) {
+        if( nNearest >= searchStrategy.m_minNumberOfSamples ) {
             //...Collect the n-nearest point indexes found inside the ellipsoid.
-            it = resultNNearest.begin();
-            for( int count = 0; it != resultNNearest.end() && count < n ; ++it, ++count)
-                result.push_back( (*it).second );
+            for( size_t i = 0; i < nNearest; ++i )
+                result.push_back( samplesInside[i].first.second );
         }
     }
-
-    return result;
 }
 
 inline bool operator< (const BoxAndDataIndexAndDistance& boxAndDataIndexAndDistance1,
@@ -366,14 +754,35 @@ inline bool operator< (const BoxAndDataIndexAndDistance& boxAndDataIndexAndDista
 QList<uint> SpatialIndex::getNearestWithinTunedForLargeDataSets(const DataCell& dataCell, const SearchStrategy & searchStrategy) const
 {
     assert( m_dataFile && "SpatialIndex::getNearestWithin(): No data file.  Make sure you have made a call to fill() prior to making queries.");
+
+	//Get the location of the data cell.
+	double x = dataCell._center._x;
+	double y = dataCell._center._y;
+	double z = 0.0; //put 2D data in the z==0.0 plane
+	if( m_dataFile->isTridimensional() )
+		z = dataCell._center._z;
+
+    QueryScratch scratch;
+    std::vector<uint> indexes;
+    getNearestWithinTunedForLargeDataSets( x, y, z, searchStrategy, scratch, indexes );
+
+    QList<uint> result;
+    result.reserve( indexes.size() );
+    for( uint index : indexes )
+        result.push_back( index );
+    return result;
+}
+
+void SpatialIndex::getNearestWithinTunedForLargeDataSets(double x, double y, double z,
+                                                         const SearchStrategy &searchStrategy,
+                                                         QueryScratch &scratch,
+                                                         std::vector<uint> &result) const
+{
 	//TODO: Possible Refactoring: some of the logic in here may in fact belong to the SearchStrategy class.
 
 	//get the desired number of samples.
 	uint n = searchStrategy.m_nb_samples;
 
-    QList<uint> result;
-    result.reserve( n );
-
     //get the search neighboorhood (e.g. an ellipsoid).
 	const SearchNeighborhood& searchNeighborhood = *(searchStrategy.m_searchNB);
 
@@ -383,19 +792,14 @@ QList<uint> SpatialIndex::getNearestWithinTunedForLargeDataSets(const DataCell&
 	//set a flag to avoid computing distances unnecessarily (performance reason).
 	bool useMinDist = minDist > 0.0;
 
-	//Get the location of the data cell.
-	double x = dataCell._center._x;
-	double y = dataCell._center._y;
-	double z = 0.0; //put 2D data in the z==0.0 plane
-	if( m_dataFile->isTridimensional() )
-		z = dataCell._center._z;
-
     //Get all the n points closest to the center of the cell.
     //This step improves performance because the actual inside/outside test of the search
     //neighborhood implementation may be slow.
-    std::vector< BoxAndDataIndexAndDistance > pointsInSearchBB;
-    pointsInSearchBB.reserve( 1000 );
-    BOOST_FOREACH(const BoxAndDataIndex & v, m_rtree | bgi::adaptors::queried(bgi::nearest(Point3D( x, y, z ), n)))
+    std::vector<BoxAndDataIndex>& nearestPoints = scratch.candidates;
+    queryNearest( x, y, z, n, scratch, nearestPoints );
+    std::vector< BoxAndDataIndexAndDistance >& pointsInSearchBB = scratch.collected;
+    pointsInSearchBB.clear();
+    for( const BoxAndDataIndex & v : nearestPoints )
     {
         uint indexP = v.second;
         //get the location of the point in the result set.
@@ -450,74 +854,285 @@ QList<uint> SpatialIndex::getNearestWithinTunedForLargeDataSets(const DataCell&
             locationsToFilter.push_back( IndexedSpatialLocationPtr( new IndexedSpatialLocation( x, y, z, (*it).first.second ) ) );
         }
         //Perform spatial filter with respect to the center of the current estimation cell.
-        searchStrategy.m_searchNB->performSpatialFilter( x, y, z, locationsToFilter, searchStrategy );
+        searchStrategy.m_searchNB->performSpatialFilter( x, y, z, locationsToFilter, searchStrategy, false );
         //...Collect the indexes of the samples spatially filtered.
         std::vector<IndexedSpatialLocationPtr>::const_iterator it = locationsToFilter.cbegin();
-        for( int count = 0; it != locationsToFilter.cend()  && count < n ; ++it, ++count )
+        for( uint count = 0; it != locationsToFilter.cend()  && count < n ; ++it, ++count )
             result.push_back( (*it)->_index );
     //Otherwise, simply get the n-nearest of those found inside the neighborhood.
     } else {
         //Copy all sample indexes found inside the neighborhood to the vector to be returned.
         std::vector< BoxAndDataIndexAndDistance >::const_iterator it = pointsInSearchBB.cbegin();
-        for ( int count = 0 ; it != pointsInSearchBB.cend() && count < n ; ++it, ++count )
+        for ( uint count = 0 ; it != pointsInSearchBB.cend() && count < n ; ++it, ++count )
             result.push_back( (*it).first.second );
     }
+}
+
+QList<uint> SpatialIndex::getNearestWithinAnisotropicDistanceRanked(const DataCell &dataCell,
+                                                                   const SearchStrategy &searchStrategy) const
+{
+    assert( m_dataFile && "SpatialIndex::getNearestWithinAnisotropicDistanceRanked(): No data file.  Make sure you have made a call to fill() prior to making queries.");
+
+    //Get the location of the data cell.
+    double x = dataCell._center._x;
+    double y = dataCell._center._y;
+    double z = 0.0; //put 2D data in the z==0.0 plane
+    if( m_dataFile->isTridimensional() )
+        z = dataCell._center._z;
+
+    QueryScratch scratch;
+    std::vector<uint> indexes;
+    getNearestWithinAnisotropicDistanceRanked( x, y, z, searchStrategy, scratch, indexes );
 
+    QList<uint> result;
+    result.reserve( indexes.size() );
+    for( uint index : indexes )
+        result.push_back( index );
     return result;
 }
 
-QList<uint> SpatialIndex::getNearestFromCartesianGrid(const GridCell &gridCell,
-                                                      const SearchStrategy &searchStrategy,
-                                                      bool hasNDV,
-                                                      double NDVvalue,
-                                                      uint nCellsIDirection,
-                                                      uint nCellsJDirection,
-                                                      uint nCellsKDirection,
-                                                      const std::vector<double> *simulatedData) const
+void SpatialIndex::getNearestWithinAnisotropicDistanceRanked(double x, double y, double z,
+                                                             const SearchStrategy &searchStrategy,
+                                                             QueryScratch &scratch,
+                                                             std::vector<uint> &result) const
 {
-    assert( m_dataFile && "SpatialIndex::getNearestFromCartesianGrid(): No data file.  "
-                          "Make sure you have made a call to fill() prior to making queries.");
+    //get the search neighboorhood (e.g. an ellipsoid).
+    const SearchNeighborhood& searchNeighborhood = *(searchStrategy.m_searchNB);
 
-    assert( ( gridCell._dataIndex >= 0 || simulatedData ) && "SpatialIndex::getNearestFromCartesianGrid(): "
-                                                             "the data index of gridCell is -1, but no "
-                                                             "separate computed data was provided (simulatedData == nullptr).");
+    //only ellipsoids have an anisotropic distance.
+    Matrix3X3<double> normalizingTransform;
+    if( ! searchNeighborhood.getNormalizingTransform( normalizingTransform ) ){
+        getNearestWithinGenericRTreeBased( x, y, z, searchStrategy, scratch, result );
+        return;
+    }
+    double transform[3][3];
+    toArray( normalizingTransform, transform );
 
     //get the desired number of samples.
     uint n = searchStrategy.m_nb_samples;
 
-    //prepare the result container.
-    QList<uint> result;
-    result.reserve( n );
+    //get the minimum distance between samples. (0.0 == not used)
+    double minDist = searchStrategy.m_minDistanceBetweenSamples;
+
+    //set a flag to avoid computing distances unnecessarily (performance reason).
+    bool useMinDist = minDist > 0.0;
 
-    //for this search mode, the data set must be a Cartesian grid
-    CartesianGrid* cg = dynamic_cast< CartesianGrid* >( m_dataFile );
-    if( cg ){
-
-        //collects valued n-neighbors ordered by their topological distance with respect
-        //to the target cell
-        GridCellPtrMultiset vCells;
-
-        //collects the data samples (depend on the search neighborhood)
-        GeostatsUtils::getValuedNeighborsTopoOrdered( gridCell,
-                                                               n,
-                                                               nCellsIDirection,
-                                                               nCellsJDirection,
-                                                               nCellsKDirection,
-                                                               hasNDV,
-                                                               NDVvalue,
-                                                               vCells,
-                                                               simulatedData );
-
-        //collect the data row indexes of the valued samples found.
-        for( const GridCellPtr& vCell : vCells ){
-            assert( vCell->_dataIndex >= 0 && "SpatialIndex::getNearestFromCartesianGrid(): tried to return invalid data index." );
-            result.push_back( vCell->_dataIndex );
+    bool hasSpatialFiltering = searchStrategy.NBhasSpatialFiltering();
+
+    //The sector search, if any, may be done while traversing the index.
+    if( hasSpatialFiltering && getNearestWithinSectors( x, y, z, searchStrategy, true, scratch, result ) )
+        return;
+
+    //Get the candidate samples ordered by their anisotropic distances to the center.
+    std::vector<BoxAndDataIndexAndDistance>& candidates = scratch.collected;
+    if( m_backend == SpatialIndexBackend::KD_TREE ){
+        //All the samples inside the neighborhood may be needed if some are discarded by the minimum distance
+        //or by the spatial filter, otherwise the n nearest suffice.
+        size_t nCandidates = n;
+        if( useMinDist || hasSpatialFiltering )
+            nCandidates = std::numeric_limits<size_t>::max();
+        queryNearestAnisotropic( x, y, z, transform, nCandidates, scratch, candidates );
+    } else {
+        //The R*-tree only supports Cartesian queries, so the candidates are those in the bounding box.
+        double maxX, maxY, maxZ, minX, minY, minZ;
+        searchNeighborhood.getBBox( x, y, z, minX, minY, minZ, maxX, maxY, maxZ );
+        queryIntersecting( Box( Point3D( minX, minY, minZ ), Point3D( maxX, maxY, maxZ ) ), scratch, scratch.candidates );
+        candidates.clear();
+        for( const BoxAndDataIndex& candidate : scratch.candidates ){
+            double offset[3];
+            m_dataFile->getDataSpatialLocation( candidate.second, offset[0], offset[1], offset[2] );
+            offset[0] -= x; offset[1] -= y; offset[2] -= z;
+            double squaredDistance = 0.0;
+            for( int row = 0; row < 3; ++row ){
+                double component = transform[row][0] * offset[0] + transform[row][1] * offset[1] + transform[row][2] * offset[2];
+                squaredDistance += component * component;
+            }
+            candidates.push_back( { candidate, squaredDistance } );
         }
+        std::sort( candidates.begin(), candidates.end(),
+                   []( const BoxAndDataIndexAndDistance& a, const BoxAndDataIndexAndDistance& b ){
+                       return a.second < b.second || ( a.second == b.second && a.first.second < b.first.second ); } );
+    }
 
-    } else
-        assert( false && "SpatialIndex::getNearestFromCartesianGrid(): Searched data set is not a Cartesian grid.");
+    //Collect the samples actually inside the search neighborhood, nearest first.
+    std::vector<uint>& accepted = scratch.accepted;
+    accepted.clear();
+    RStarRtree& rtreeLocal = scratch.rtreeLocal;
+    rtreeLocal.clear();
+    std::vector<BoxAndDataIndex> resultMinDist;
+    for( const BoxAndDataIndexAndDistance& candidate : candidates ){
+        //without spatial filtering, the n nearest samples are the first n accepted.
+        if( ! hasSpatialFiltering && accepted.size() == n )
+            break;
+        uint indexP = candidate.first.second;
+        double xP, yP, zP;
+        m_dataFile->getDataSpatialLocation( indexP, xP, yP, zP );
+        if( ! searchNeighborhood.isInside( x, y, z, xP, yP, zP ) )
+            continue;
+        //if it necessary to impose a minimum distance between samples...
+        if( useMinDist ){
+            //...and if there is at least a sample already collected...
+            if( ! rtreeLocal.empty() ){
+                //...then query the local r-tree for the closest sample to the current sample so far.
+                rtreeLocal.query(bgi::nearest(Point3D(xP, yP, zP), 1), std::back_inserter(resultMinDist));
+                double xClosestP, yClosestP, zClosestP;
+                m_dataFile->getDataSpatialLocation( resultMinDist[0].second, xClosestP, yClosestP, zClosestP );
+                resultMinDist.clear();
+                //if the current sample is closer to a sample previously collected than allowed, skip it.
+                if( boost::geometry::distance( Point3D(xP, yP, zP), Point3D(xClosestP, yClosestP, zClosestP) ) < minDist )
+                    continue;
+            }
+            rtreeLocal.insert( candidate.first );
+        }
+        accepted.push_back( indexP );
+    }
 
-    return result;
+    //The search strategy may need to perform spatial filtering (e.g. octant/sector search) of the samples found
+    //in the search neighborhood.
+    if( hasSpatialFiltering ){
+        std::vector<IndexedSpatialLocationPtr> locationsToFilter;
+        locationsToFilter.reserve( accepted.size() );
+        for( uint index : accepted ){
+            double xS, yS, zS;
+            m_dataFile->getDataSpatialLocation( index, xS, yS, zS );
+            locationsToFilter.push_back( IndexedSpatialLocationPtr( new IndexedSpatialLocation( xS, yS, zS, index ) ) );
+        }
+        searchStrategy.m_searchNB->performSpatialFilter( x, y, z, locationsToFilter, searchStrategy, true );
+        std::vector<IndexedSpatialLocationPtr>::const_iterator it = locationsToFilter.cbegin();
+        for( uint count = 0; it != locationsToFilter.cend() && count < n ; ++it, ++count )
+            result.push_back( (*it)->_index );
+    } else if( accepted.size() >= searchStrategy.m_minNumberOfSamples )
+        result.insert( result.end(), accepted.begin(), accepted.end() );
+}
+
+bool SpatialIndex::getNearestWithinSectors(double x, double y, double z,
+                                           const SearchStrategy &searchStrategy,
+                                           bool rankByNormalizedDistance,
+                                           QueryScratch &scratch,
+                                           std::vector<uint> &result) const
+{
+    const SearchNeighborhood& searchNeighborhood = *(searchStrategy.m_searchNB);
+
+    //the minimum distance between samples depends on the order the samples are collected.
+    if( m_backend != SpatialIndexBackend::KD_TREE || searchStrategy.m_minDistanceBetweenSamples > 0.0 )
+        return false;
+    Matrix3X3<double> normalizingTransform;
+    uint nSectors, minSamplesPerSector, maxSamplesPerSector;
+    if( ! searchNeighborhood.getNormalizingTransform( normalizingTransform ) ||
+        ! searchNeighborhood.getSectorFilter( nSectors, minSamplesPerSector, maxSamplesPerSector ) ||
+        nSectors == 0 )
+        return false;
+
+    //nothing is taken from the sectors (also avoids empty heaps below).
+    uint n = searchStrategy.m_nb_samples;
+    if( maxSamplesPerSector == 0 || n == 0 )
+        return true;
+
+    //Collect the nearest samples of each sector.  Enough of them are kept to check the minimum per sector.
+    std::vector< std::vector< KdTree::DistanceAndIndex > >& sectorHeaps = scratch.sectorHeaps;
+    sectorHeaps.resize( nSectors );
+    for( std::vector< KdTree::DistanceAndIndex >& heap : sectorHeaps )
+        heap.clear();
+    double transform[3][3];
+    toArray( normalizingTransform, transform );
+    //when ranking by normalized distance, the Euclidean gaps of the k-d tree are converted with the inverse of
+    //the Frobenius norm of the inverse transform, which is a lower bound of the scale of the transform.
+    double gapFactor = 1.0;
+    if( rankByNormalizedDistance ){
+        Matrix3X3<double> inverse = normalizingTransform;
+        inverse.invert();
+        gapFactor = 1.0 / std::sqrt( inverse._a11*inverse._a11 + inverse._a12*inverse._a12 + inverse._a13*inverse._a13 +
+                                     inverse._a21*inverse._a21 + inverse._a22*inverse._a22 + inverse._a23*inverse._a23 +
+                                     inverse._a31*inverse._a31 + inverse._a32*inverse._a32 + inverse._a33*inverse._a33 );
+    }
+    SectorCollector collector( *m_dataFile, searchNeighborhood, x, y, z,
+                               std::max( minSamplesPerSector, maxSamplesPerSector ), sectorHeaps,
+                               rankByNormalizedDistance ? transform : nullptr, gapFactor );
+    m_kdTree.visitAnisotropic( x, y, z, transform, 1.0 + ANISOTROPIC_SEARCH_MARGIN, collector );
+
+    //the search fails if a sector falls short of the minimum.
+    for( std::vector< KdTree::DistanceAndIndex >& heap : sectorHeaps ){
+        if( minSamplesPerSector && heap.size() < minSamplesPerSector )
+            return true;
+        std::sort_heap( heap.begin(), heap.end() );
+    }
+
+    //Take the nearest sample of each sector in turn, then the second nearest, etc.
+    size_t count = 0;
+    for( uint nthElement = 0; nthElement < maxSamplesPerSector; ++nthElement )
+        for( const std::vector< KdTree::DistanceAndIndex >& heap : sectorHeaps )
+            if( nthElement < heap.size() ){
+                result.push_back( heap[nthElement].second );
+                if( ++count == n )
+                    return true;
+            }
+    return true;
+}
+
+void SpatialIndex::getNearestWithinBatch(const std::vector<double> &x,
+                                         const std::vector<double> &y,
+                                         const std::vector<double> &z,
+                                         const SearchStrategy &searchStrategy,
+                                         NeighborhoodSearchAlgorithm algorithm,
+                                         SpatialIndexNeighborhoods &result,
+                                         unsigned int nThreads) const
+{
+    assert( m_dataFile && "SpatialIndex::getNearestWithinBatch(): No data file.  Make sure you have made a call to fill() prior to making queries.");
+    assert( x.size() == y.size() && x.size() == z.size() && "SpatialIndex::getNearestWithinBatch(): coordinate vectors of different sizes.");
+
+    size_t nQueries = x.size();
+    bool is3D = m_dataFile->isTridimensional();
+    if( nThreads == 0 )
+        nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+
+    //the locations are queried in blocks of consecutive locations, which are handed out to the threads
+    //as they become free, so threads that get denser neighborhoods do not hold the others up.
+    const size_t QUERIES_PER_BLOCK = 256;
+    size_t nBlocks = ( nQueries + QUERIES_PER_BLOCK - 1 ) / QUERIES_PER_BLOCK;
+    std::vector< std::vector<uint> > indexesOfBlocks( nBlocks );
+    std::vector< size_t > counts( nQueries );
+    std::atomic< size_t > nextBlock( 0 );
+    auto queryBlocks = [&](){
+        QueryScratch scratch;
+        for( size_t iBlock = nextBlock++; iBlock < nBlocks; iBlock = nextBlock++ ){
+            std::vector<uint>& indexes = indexesOfBlocks[iBlock];
+            size_t lastQuery = std::min( ( iBlock + 1 ) * QUERIES_PER_BLOCK, nQueries );
+            for( size_t iQuery = iBlock * QUERIES_PER_BLOCK; iQuery < lastQuery; ++iQuery ){
+                size_t countBefore = indexes.size();
+                double zQuery = is3D ? z[iQuery] : 0.0; //put 2D data in the z==0.0 plane
+                switch( algorithm ){
+                case NeighborhoodSearchAlgorithm::GENERIC_RTREE_BASED:
+                    getNearestWithinGenericRTreeBased( x[iQuery], y[iQuery], zQuery, searchStrategy, scratch, indexes );
+                    break;
+                case NeighborhoodSearchAlgorithm::TUNED_FOR_LARGE_DATA_SETS:
+                    getNearestWithinTunedForLargeDataSets( x[iQuery], y[iQuery], zQuery, searchStrategy, scratch, indexes );
+                    break;
+                case NeighborhoodSearchAlgorithm::ANISOTROPIC_DISTANCE_RANKED:
+                    getNearestWithinAnisotropicDistanceRanked( x[iQuery], y[iQuery], zQuery, searchStrategy, scratch, indexes );
+                    break;
+                }
+                counts[iQuery] = indexes.size() - countBefore;
+            }
+        }
+    };
+    std::vector< std::thread > threads;
+    for( unsigned int iThread = 1; iThread < nThreads && iThread < nBlocks; ++iThread )
+        threads.push_back( std::thread( queryBlocks ) );
+    queryBlocks(); //this thread also does its share.
+    for( std::thread& thread : threads )
+        thread.join();
+
+    //gather the results of the blocks in query order.
+    result.offsets.resize( nQueries + 1 );
+    result.offsets[0] = 0;
+    for( size_t iQuery = 0; iQuery < nQueries; ++iQuery )
+        result.offsets[iQuery + 1] = result.offsets[iQuery] + counts[iQuery];
+    result.indexes.clear();
+    result.indexes.reserve( result.offsets.back() );
+    for( std::vector<uint>& indexes : indexesOfBlocks ){
+        result.indexes.insert( result.indexes.end(), indexes.begin(), indexes.end() );
+        std::vector<uint>().swap( indexes );
+    }
 }
 
 QList<uint> SpatialIndex::getWithinZInterval(double zInitial, double zFinal)
@@ -541,8 +1156,9 @@ QList<uint> SpatialIndex::getWithinZInterval(double zInitial, double zFinal)
     //Get all the points within the bounding box of the search neighborhood.
     //This step improves performance because the actual inside/outside test of the search
     //neighborhood implementation may be slow.
+    QueryScratch scratch;
     std::vector<BoxAndDataIndex> poinsInSearchBB;
-    m_rtree.query( bgi::intersects( searchBB ), std::back_inserter( poinsInSearchBB ) );
+    queryIntersecting( searchBB, scratch, poinsInSearchBB );
 
     //Get all the row indexes of the samples that intersect the z interval.
     std::vector<BoxAndDataIndex>::iterator it = poinsInSearchBB.begin();
@@ -555,10 +1171,87 @@ QList<uint> SpatialIndex::getWithinZInterval(double zInitial, double zFinal)
 void SpatialIndex::clear()
 {
 	m_rtree.clear();
+    m_kdTree.clear();
+    m_uniformGrid.clear();
+    m_backend = SpatialIndexBackend::RSTAR_TREE;
 	m_dataFile = nullptr;
 }
 
 bool SpatialIndex::isEmpty() const
 {
-	return m_rtree.empty();
+    return m_rtree.empty() && m_kdTree.empty() && m_uniformGrid.empty();
+}
+
+BoxAndDataIndex SpatialIndex::makeBoxAndDataIndex(uint index) const
+{
+    double minX, minY, minZ, maxX, maxY, maxZ;
+    SegmentSet* ss = dynamic_cast< SegmentSet* >( m_dataFile );
+    GeoGrid* gg = dynamic_cast< GeoGrid* >( m_dataFile );
+    if( ss )
+        ss->getBoundingBox( index, minX, minY, minZ, maxX, maxY, maxZ );
+    else if( gg )
+        gg->getBoundingBox( index, minX, minY, minZ, maxX, maxY, maxZ );
+    else {
+        m_dataFile->getDataSpatialLocation( index, minX, minY, minZ );
+        maxX = minX; maxY = minY; maxZ = minZ;
+    }
+    //the tolerances are those of fill() (e.g. the half cell sizes of Cartesian grids).
+    double tX = getTolerance( 0 ), tY = getTolerance( 1 ), tZ = getTolerance( 2 );
+    return std::make_pair( Box( Point3D( minX - tX, minY - tY, minZ - tZ ),
+                                Point3D( maxX + tX, maxY + tY, maxZ + tZ ) ),
+                           index );
+}
+
+double SpatialIndex::getTolerance(int axis) const
+{
+    if( m_backend == SpatialIndexBackend::UNIFORM_GRID )
+        return m_uniformGrid.getTolerance( axis );
+    return m_kdTree.getTolerance( axis );
+}
+
+void SpatialIndex::queryNearest(double x, double y, double z, uint n, QueryScratch &scratch,
+                                std::vector<BoxAndDataIndex> &result) const
+{
+    result.clear();
+    if( m_backend == SpatialIndexBackend::KD_TREE ){
+        m_kdTree.findNearest( x, y, z, n, scratch.kdTreeNearest );
+        for( const KdTree::DistanceAndIndex& distanceAndIndex : scratch.kdTreeNearest )
+            result.push_back( makeBoxAndDataIndex( distanceAndIndex.second ) );
+    } else if( m_backend == SpatialIndexBackend::UNIFORM_GRID ){
+        m_uniformGrid.findNearest( x, y, z, n, scratch.uniformGridNearest );
+        for( const UniformGrid::DistanceAndIndex& distanceAndIndex : scratch.uniformGridNearest )
+            result.push_back( makeBoxAndDataIndex( distanceAndIndex.second ) );
+    } else
+        m_rtree.query( bgi::nearest( Point3D( x, y, z ), n ), std::back_inserter( result ) );
+}
+
+void SpatialIndex::queryNearestAnisotropic(double x, double y, double z, const double (&transform)[3][3], size_t n,
+                                           QueryScratch &scratch, std::vector<BoxAndDataIndexAndDistance> &result) const
+{
+    assert( m_backend == SpatialIndexBackend::KD_TREE && "SpatialIndex::queryNearestAnisotropic(): requires the k-d tree backend.");
+    result.clear();
+    m_kdTree.findNearestAnisotropic( x, y, z, transform, n, 1.0 + ANISOTROPIC_SEARCH_MARGIN, scratch.kdTreeNearest );
+    for( const KdTree::DistanceAndIndex& distanceAndIndex : scratch.kdTreeNearest )
+        result.push_back( { makeBoxAndDataIndex( distanceAndIndex.second ), distanceAndIndex.first } );
+}
+
+void SpatialIndex::queryIntersecting(const Box &box, QueryScratch &scratch, std::vector<BoxAndDataIndex> &result) const
+{
+    result.clear();
+    if( m_backend == SpatialIndexBackend::KD_TREE ){
+        scratch.kdTreeIndexes.clear();
+        m_kdTree.findIntersecting( box.min_corner().get<0>(), box.min_corner().get<1>(), box.min_corner().get<2>(),
+                                   box.max_corner().get<0>(), box.max_corner().get<1>(), box.max_corner().get<2>(),
+                                   scratch.kdTreeIndexes );
+        for( uint32_t index : scratch.kdTreeIndexes )
+            result.push_back( makeBoxAndDataIndex( index ) );
+    } else if( m_backend == SpatialIndexBackend::UNIFORM_GRID ){
+        scratch.kdTreeIndexes.clear();
+        m_uniformGrid.findIntersecting( box.min_corner().get<0>(), box.min_corner().get<1>(), box.min_corner().get<2>(),
+                                        box.max_corner().get<0>(), box.max_corner().get<1>(), box.max_corner().get<2>(),
+                                        scratch.kdTreeIndexes );
+        for( uint32_t index : scratch.kdTreeIndexes )
+            result.push_back( makeBoxAndDataIndex( index ) );
+    } else
+        m_rtree.query( bgi::intersects( box ), std::back_inserter( result ) );
 }
@@ -5,6 +5,9 @@
 #include <vector>
 #include <boost/geometry.hpp>
 #include <boost/geometry/index/rtree.hpp>
+#include "kdtree.h"
+#include "uniformgrid.h"
+#include "domain/auxiliary/filevaliditystamp.h"
 
 class PointSet;
 class CartesianGrid;
@@ -23,6 +26,44 @@ typedef std::pair<Box, size_t> BoxAndDataIndex;
 typedef bgi::rtree< BoxAndDataIndex, bgi::rstar<16,5,5,32> > RStarRtree;
 typedef std::pair< BoxAndDataIndex, double > BoxAndDataIndexAndDistance;
 
+/** The data structures SpatialIndex can use to index point sets and segment sets. */
+enum class SpatialIndexBackend : uint {
+    RSTAR_TREE = 0, //!< Boost's R*-tree (default).  Suitable for objects of any size (e.g. grid cells).
+    KD_TREE,        //!< Flat k-d tree (see KdTree).  Faster to build and query for points, short segments and
+                    //!< cells of similar sizes.  Can be saved to file (see SpatialIndex::fillPersistent()).
+    UNIFORM_GRID    //!< Bucketed uniform grid (see UniformGrid).  The fastest to build (O(n)) and to query for dense,
+                    //!< evenly spread points and Cartesian grid cells.  Segments and GeoGrid cells are indexed
+                    //!< with the R*-tree instead.
+};
+
+/** The neighborhood search algorithms of SpatialIndex::getNearestWithinBatch(). */
+enum class NeighborhoodSearchAlgorithm : uint {
+    GENERIC_RTREE_BASED = 0,    //!< The algorithm of SpatialIndex::getNearestWithinGenericRTreeBased().
+    TUNED_FOR_LARGE_DATA_SETS,  //!< The algorithm of SpatialIndex::getNearestWithinTunedForLargeDataSets().
+    ANISOTROPIC_DISTANCE_RANKED //!< The algorithm of SpatialIndex::getNearestWithinAnisotropicDistanceRanked().
+};
+
+/**
+ * The results of many neighborhood queries in compressed sparse row (CSR) layout: the data line indexes
+ * found for the i-th query are indexes[offsets[i]] through indexes[offsets[i+1]-1].
+ */
+struct SpatialIndexNeighborhoods
+{
+    /** The positions in indexes where the results of each query begin, plus the total number of indexes. */
+    std::vector< size_t > offsets;
+    /** The data line indexes found by all queries, one query after the other. */
+    std::vector< uint > indexes;
+
+    /** Returns the number of queries. */
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    /** Returns the number of data lines found by the given query. */
+    size_t getCount( size_t iQuery ) const { return offsets[iQuery + 1] - offsets[iQuery]; }
+
+    /** Returns the data line indexes found by the given query (getCount() elements). */
+    const uint* getIndexes( size_t iQuery ) const { return indexes.data() + offsets[iQuery]; }
+};
+
 /**
  * This class exposes functionalities related to spatial indexes and queries with GammaRay objects.
  */
@@ -35,24 +76,42 @@ public:
     /** Fills the index with the PointSet points (bulk load).
      * It erases current index.
      * @param tolerance Sets the size of the bounding boxes around each point.
+     * @param backend The data structure used to index the points.  The query results are the same,
+     *                except for the order of points at exactly the same distance.
+     *                The uniform grid suits points spread evenly, rather than clustered, over the data extent.
      */
-	void fill( PointSet* ps, double tolerance );
+    void fill( PointSet* ps, double tolerance, SpatialIndexBackend backend = SpatialIndexBackend::RSTAR_TREE );
 
 	/** Fills the index with the CartesianGrid cells (bulk load).
      * It erases current index.
      */
-	void fill( CartesianGrid* cg );
+	void fill( CartesianGrid* cg, SpatialIndexBackend backend = SpatialIndexBackend::RSTAR_TREE );
 
 	/** Fills the index with the GeoGrid cells (bulk load).
      * It erases current index.
 	 */
-	void fill( GeoGrid* gg );
+	void fill( GeoGrid* gg, SpatialIndexBackend backend = SpatialIndexBackend::RSTAR_TREE );
 
     /** Fills the index with the SegmentSet segments (bulk load).
      * It erases current index.
      * @param tolerance Sets the size of the bounding boxes around each segment.
+     * @param backend The data structure used to index the segments.  The k-d tree is only effective
+     *                if the segments are short relative to the spacing between them.
+     */
+    void fill( SegmentSet* ss, double tolerance, SpatialIndexBackend backend = SpatialIndexBackend::RSTAR_TREE );
+
+    /** These are the same as the fill() methods with the k-d tree backend, but the index is saved in a file next to
+     * the data file (see getIndexFilePath()), so later calls (e.g. in later runs of a simulation) load it instead of
+     * rebuilding it.  The saved index is tagged with the validity stamp of the file with the geometry of the items
+     * (the data file of point sets and the mesh file of GeoGrids) and with the fill parameters, so it is rebuilt
+     * if any of them changes.  Cartesian grid cells only depend on the grid parameters.
      */
-    void fill( SegmentSet* ss, double tolerance );
+    void fillPersistent( PointSet* ps, double tolerance );
+    void fillPersistent( CartesianGrid* cg );
+    void fillPersistent( GeoGrid* gg );
+
+    /** Returns the path to the file where fillPersistent() saves the index of the given data file. */
+    static QString getIndexFilePath( DataFile* df );
 
 	/**
      * Returns the indexes of the n-nearest (in space) data lines to some data line given by its index.
@@ -77,6 +136,12 @@ public:
      */
     QList<uint> getNearestWithin(uint index, uint n, double distance) const;
 
+    /**
+     * Returns the data line indexes of all the data lines whose bounding boxes (see fill()) are within the given
+     * distance to a point in space, in no particular order.  May return an empty list.
+     */
+    QList<uint> getWithinDistance( double x, double y, double z, double distance ) const;
+
 	/**
      * Returns the data line indexes of the n-nearest (in space) data lines within the given neighborhood
      * centered at given data cell (e.g. grid cell). The indexes are the data line indexes
@@ -93,32 +158,36 @@ public:
     QList<uint> getNearestWithinTunedForLargeDataSets(const DataCell& dataCell,
                                         const SearchStrategy & searchStrategy ) const;
 
+    /**
+     * Does the same as getNearestWithinGenericRTreeBased(), but the n-nearest samples are those nearest in the
+     * normalized space of the search ellipsoid (the anisotropic distance, as in GSLib), not in Cartesian space.
+     * If the index was filled with SpatialIndexBackend::KD_TREE, the k-d tree is searched directly in that space,
+     * so the samples in the bounding box of an elongated ellipsoid but outside it are not even visited.
+     * If the search neighborhood is not an ellipsoid, this is the same as getNearestWithinGenericRTreeBased().
+     */
+    QList<uint> getNearestWithinAnisotropicDistanceRanked( const DataCell& dataCell,
+                                                           const SearchStrategy & searchStrategy ) const;
 
     /**
-     * It is a highly specialized member of the getNearest*() family of methods.
-     * It works only with regular grid cells and Cartesian grids, taking
-     * advantage of the implicit regular geometry and topology to improve search performance manifold.
-     * An empty list can be returned.
-     * @param gridCell The grid cell used as center to query neighboring cells.
-     * @param searchStrategy The object containg the search parameters.
-     * @param hasNDV Shortcut to avoid iterative calls to the slow DataFile::hasNoDataValue()
-     * @param NDVvalue Shortcut to avoid iterative calls to the slow DataFile::getNoDataValueAsDouble()
-     * @param The parallelepipedal search neighborhoord's size as number of cells in East-West direction.
-     * @param The parallelepipedal search neighborhoord's size as number of cells in North-South direction.
-     * @param The parallelepipedal search neighborhoord's size as number of cells in Up-Down direction.
-     * @param simulatedData This should be set if this method is being called by computations that do not
-     *                      immediately commit the results to the grid (e.g. simulation routines), otherwise an index
-     *                      crash will ensue as the index in gridCell object is invalid or is -1.
+     * Performs getNearestWithinGenericRTreeBased(), getNearestWithinTunedForLargeDataSets() or
+     * getNearestWithinAnisotropicDistanceRanked() for many
+     * locations at once, in parallel.  The result for each location is the same as that of the
+     * respective single-location method centered at it.  Each thread reuses its working memory between
+     * queries, so this is much faster than calling those methods in a loop.
+     * The indexed data file must not be changed while this method runs.
+     * @param x, y, z The locations of the neighborhood centers (e.g. grid cell centers).  The z values
+     *                are ignored if the indexed data set is 2D.
+     * @param result Output: the data line indexes found for each location.
+     * @param nThreads The number of threads to use.  Zero means one per logical processor.
      */
-    QList<uint> getNearestFromCartesianGrid(const GridCell &gridCell,
-                                            const SearchStrategy & searchStrategy,
-                                            bool hasNDV,
-                                            double NDVvalue,
-                                            uint nCellsIDirection,
-                                            uint nCellsJDirection,
-                                            uint nCellsKDirection,
-                                            const std::vector<double> *simulatedData = nullptr
-                                            ) const;
+    void getNearestWithinBatch( const std::vector<double>& x,
+                                const std::vector<double>& y,
+                                const std::vector<double>& z,
+                                const SearchStrategy& searchStrategy,
+                                NeighborhoodSearchAlgorithm algorithm,
+                                SpatialIndexNeighborhoods& result,
+                                unsigned int nThreads = 0 ) const;
+
 
     /**
      * Returns the data line indexes of the data lines that happen to be partially or entirely
@@ -135,13 +204,92 @@ public:
     bool isEmpty() const;
 
 private:
+    /** Working memory of the queries, which is kept between queries to avoid repeated allocations. */
+    struct QueryScratch {
+        std::vector< BoxAndDataIndex > candidates;
+        std::vector< BoxAndDataIndexAndDistance > collected;
+        std::vector< KdTree::DistanceAndIndex > kdTreeNearest;
+        std::vector< uint32_t > kdTreeIndexes;
+        std::vector< UniformGrid::DistanceAndIndex > uniformGridNearest;
+        std::vector< uint > accepted;
+        /** One bounded max-heap of (squared distance, index) per search sector. */
+        std::vector< std::vector< KdTree::DistanceAndIndex > > sectorHeaps;
+        RStarRtree rtreeLocal;
+    };
+
 	void setDataFile( DataFile* df );
 
+    /** What an index saved by fillPersistent() depends on, besides the number of items. */
+    struct PersistenceKey {
+        /** The kind of data file indexed (see PersistedDataFileKind in the .cpp). */
+        uint32_t kind;
+        /** The validity stamp of the file with the geometry of the items.  Null if the parameters suffice. */
+        FileValidityStamp sourceStamp;
+        /** The fill parameters (e.g. tolerance, coordinate columns or grid geometry), zero if unused. */
+        double parameters[10];
+    };
+
+    /** Restores the k-d tree saved by saveKdTree() with the given key.  Returns false if the file is
+     * absent, stale or unreadable. */
+    bool loadKdTree( const QString& path, const PersistenceKey& key );
+
+    /** Saves the k-d tree tagged with the given key.  Returns false if the file could not be written. */
+    bool saveKdTree( const QString& path, const PersistenceKey& key ) const;
+
+    /** Returns the bounding box of the given data line as indexed by fill() (used with the k-d tree and
+     * uniform grid backends). */
+    BoxAndDataIndex makeBoxAndDataIndex( uint index ) const;
+
+    /** Returns the tolerance along the given axis of the backend in use (see makeBoxAndDataIndex()). */
+    double getTolerance( int axis ) const;
+
+    /** Sets result with the n objects nearest to the given point in no particular order. */
+    void queryNearest( double x, double y, double z, uint n, QueryScratch& scratch,
+                       std::vector<BoxAndDataIndex>& result ) const;
+
+    /** Sets result with the objects whose bounding boxes intersect the given box. */
+    void queryIntersecting( const Box& box, QueryScratch& scratch, std::vector<BoxAndDataIndex>& result ) const;
+
+    /** Sets result with up to n objects nearest to the given point in the anisotropic space given by the transform
+     * (see SearchNeighborhood::getNormalizingTransform()) within distance 1 (plus a small margin for round-off).
+     * The objects are ordered by that distance.  Only for the k-d tree backend. */
+    void queryNearestAnisotropic( double x, double y, double z, const double (&transform)[3][3], size_t n,
+                                  QueryScratch& scratch, std::vector<BoxAndDataIndexAndDistance>& result ) const;
+
+    /** The implementations of the getNearestWithin*() methods for neighborhoods given the location of their
+     * centers.  The data line indexes found are appended to result. */
+    void getNearestWithinGenericRTreeBased( double x, double y, double z, const SearchStrategy & searchStrategy,
+                                            QueryScratch& scratch, std::vector<uint>& result ) const;
+    void getNearestWithinTunedForLargeDataSets( double x, double y, double z, const SearchStrategy & searchStrategy,
+                                                QueryScratch& scratch, std::vector<uint>& result ) const;
+    void getNearestWithinAnisotropicDistanceRanked( double x, double y, double z, const SearchStrategy & searchStrategy,
+                                                    QueryScratch& scratch, std::vector<uint>& result ) const;
+
+    /** Performs the search with sector filtering (see SearchNeighborhood::getSectorFilter()) during the k-d tree
+     * traversal: the samples inside the neighborhood are binned by sector as they are found, each sector keeping
+     * only its nearest ones, and the subtrees that cannot improve any sector are pruned.  The result is the same
+     * as that of SearchNeighborhood::performSpatialFilter() on all the samples inside the neighborhood, with the samples
+     * ranked by their anisotropic distances if rankByNormalizedDistance is true.
+     * Returns false, without touching result, if the search cannot be done that way (e.g. the R*-tree backend,
+     * minimum distance between samples or neighborhoods other than search ellipsoids with sectors). */
+    bool getNearestWithinSectors( double x, double y, double z, const SearchStrategy & searchStrategy,
+                                  bool rankByNormalizedDistance,
+                                  QueryScratch& scratch, std::vector<uint>& result ) const;
+
 	/** The R* variant of the rtree
 	* WARNING: incorrect R-Tree parameter may lead to crashes with element insertions
 	*/
     RStarRtree m_rtree; //TODO: make these parameters variable (passed in the constructor?)
 
+    /** The k-d tree, used instead of m_rtree if m_backend == SpatialIndexBackend::KD_TREE. */
+    KdTree m_kdTree;
+
+    /** The uniform grid, used instead of m_rtree if m_backend == SpatialIndexBackend::UNIFORM_GRID. */
+    UniformGrid m_uniformGrid;
+
+    /** The data structure in use. */
+    SpatialIndexBackend m_backend;
+
 	/** The data file which is being indexed. */
 	DataFile* m_dataFile;
 };
@@ -0,0 +1,273 @@
+#include "uniformgrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+/** The target average number of items per bucket. */
+const double ITEMS_PER_BUCKET = 2.0;
+
+/** Returns the squared distance between a coordinate and an interval [center - halfSize, center + halfSize]. */
+inline double squaredGap( double coordinate, double center, double halfSize )
+{
+    double gap = std::abs( coordinate - center ) - halfSize;
+    return gap > 0.0 ? gap * gap : 0.0;
+}
+
+}
+
+UniformGrid::UniformGrid() :
+    m_nBuckets{ 0, 0, 0 },
+    m_origin{ 0.0, 0.0, 0.0 },
+    m_bucketSize{ 1.0, 1.0, 1.0 },
+    m_tolerance{ 0.0, 0.0, 0.0 }
+{
+}
+
+void UniformGrid::reserve( size_t nItems )
+{
+    m_items.reserve( nItems );
+}
+
+void UniformGrid::add( double x, double y, double z, uint32_t index )
+{
+    m_items.push_back( Item{ { x, y, z }, index } );
+}
+
+void UniformGrid::build( double toleranceX, double toleranceY, double toleranceZ )
+{
+    m_tolerance[0] = toleranceX;
+    m_tolerance[1] = toleranceY;
+    m_tolerance[2] = toleranceZ;
+    m_bucketStarts.clear();
+    for( int axis = 0; axis < 3; ++axis ){
+        m_nBuckets[axis] = 0;
+        m_origin[axis] = 0.0;
+        m_bucketSize[axis] = 1.0;
+    }
+    if( m_items.empty() )
+        return;
+
+    //get the extent of the points
+    double min[3], max[3];
+    for( int axis = 0; axis < 3; ++axis ){
+        min[axis] = std::numeric_limits<double>::max();
+        max[axis] = -std::numeric_limits<double>::max();
+    }
+    for( const Item& item : m_items )
+        for( int axis = 0; axis < 3; ++axis ){
+            min[axis] = std::min( min[axis], item.center[axis] );
+            max[axis] = std::max( max[axis], item.center[axis] );
+        }
+
+    //The bucket edge is that of a cube holding ITEMS_PER_BUCKET items on average in the space spanned by
+    //the points.  Flat axes (e.g. the Z of 2D data) get a single bucket, so 2D data are bucketed in 2D.
+    double volume = 1.0;
+    int nDimensions = 0;
+    for( int axis = 0; axis < 3; ++axis )
+        if( max[axis] > min[axis] ){
+            volume *= max[axis] - min[axis];
+            ++nDimensions;
+        }
+    double edge = 1.0;
+    //the number of buckets is capped by that of items, so sparse outliers do not make the grid huge.
+    double maxBucketsPerAxis = 1.0;
+    if( nDimensions > 0 ){
+        edge = std::pow( volume * ITEMS_PER_BUCKET / m_items.size(), 1.0 / nDimensions );
+        maxBucketsPerAxis = std::ceil( std::pow( static_cast<double>( m_items.size() ), 1.0 / nDimensions ) );
+    }
+    for( int axis = 0; axis < 3; ++axis ){
+        m_origin[axis] = min[axis];
+        double extent = max[axis] - min[axis];
+        if( extent > 0.0 && edge > 0.0 ){
+            double nBuckets = std::min( std::max( 1.0, std::ceil( extent / edge ) ), maxBucketsPerAxis );
+            m_nBuckets[axis] = static_cast<uint32_t>( nBuckets );
+            m_bucketSize[axis] = extent / nBuckets;
+        } else {
+            m_nBuckets[axis] = 1;
+            m_bucketSize[axis] = 1.0;
+        }
+    }
+
+    //counting sort of the items by bucket: count, prefix sum and scatter.
+    size_t nBucketsTotal = static_cast<size_t>( m_nBuckets[0] ) * m_nBuckets[1] * m_nBuckets[2];
+    std::vector< uint32_t > bucketOfItem( m_items.size() );
+    m_bucketStarts.assign( nBucketsTotal + 1, 0 );
+    for( size_t iItem = 0; iItem < m_items.size(); ++iItem ){
+        const Item& item = m_items[iItem];
+        size_t bucketIndex = getBucketIndex( getBucket( 0, item.center[0] ),
+                                             getBucket( 1, item.center[1] ),
+                                             getBucket( 2, item.center[2] ) );
+        bucketOfItem[iItem] = static_cast<uint32_t>( bucketIndex );
+        ++m_bucketStarts[ bucketIndex + 1 ];
+    }
+    for( size_t iBucket = 0; iBucket < nBucketsTotal; ++iBucket )
+        m_bucketStarts[ iBucket + 1 ] += m_bucketStarts[ iBucket ];
+    std::vector< uint32_t > nextPosition( m_bucketStarts.begin(), m_bucketStarts.end() - 1 );
+    std::vector< Item > items( m_items.size() );
+    for( size_t iItem = 0; iItem < m_items.size(); ++iItem )
+        items[ nextPosition[ bucketOfItem[iItem] ]++ ] = m_items[iItem];
+    m_items.swap( items );
+}
+
+uint32_t UniformGrid::getBucket( int axis, double coordinate ) const
+{
+    double bucket = std::floor( ( coordinate - m_origin[axis] ) / m_bucketSize[axis] );
+    if( ! ( bucket > 0.0 ) )
+        return 0;
+    if( bucket >= m_nBuckets[axis] )
+        return m_nBuckets[axis] - 1;
+    return static_cast<uint32_t>( bucket );
+}
+
+void UniformGrid::findNearest( double x, double y, double z, size_t n, std::vector<DistanceAndIndex> &result ) const
+{
+    result.clear();
+    if( n == 0 || m_items.empty() )
+        return;
+    result.reserve( std::min( n, m_items.size() ) );
+    const double location[3] = { x, y, z };
+    const uint32_t center[3] = { getBucket( 0, x ), getBucket( 1, y ), getBucket( 2, z ) };
+    uint32_t maxRing = std::max( std::max( m_nBuckets[0], m_nBuckets[1] ), m_nBuckets[2] );
+
+    //The buckets are scanned in rings (shells of buckets) of increasing Chebyshev distance to the bucket of the
+    //location, until the worst of the n items found is closer than anything beyond the rings scanned so far.
+    //result is used as a max-heap of the n best items so far.
+    for( uint32_t ring = 0; ring < maxRing; ++ring ){
+        uint32_t low[3], high[3];
+        for( int axis = 0; axis < 3; ++axis ){
+            low[axis] = center[axis] >= ring ? center[axis] - ring : 0;
+            high[axis] = std::min( center[axis] + ring, m_nBuckets[axis] - 1 );
+        }
+        for( uint32_t k = low[2]; k <= high[2]; ++k ){
+            bool kOnRing = k + ring == center[2] || k == center[2] + ring;
+            for( uint32_t j = low[1]; j <= high[1]; ++j ){
+                bool jkOnRing = kOnRing || j + ring == center[1] || j == center[1] + ring;
+                if( jkOnRing ){
+                    for( uint32_t i = low[0]; i <= high[0]; ++i )
+                        scanBucketForNearest( getBucketIndex( i, j, k ), location, n, result );
+                } else {
+                    //inside the ring, only the buckets at its ends along I are new.
+                    if( center[0] >= ring )
+                        scanBucketForNearest( getBucketIndex( center[0] - ring, j, k ), location, n, result );
+                    if( ring > 0 && center[0] + ring < m_nBuckets[0] )
+                        scanBucketForNearest( getBucketIndex( center[0] + ring, j, k ), location, n, result );
+                }
+            }
+        }
+
+        //all buckets were scanned.
+        if( low[0] == 0 && low[1] == 0 && low[2] == 0 &&
+            high[0] + 1 == m_nBuckets[0] && high[1] + 1 == m_nBuckets[1] && high[2] + 1 == m_nBuckets[2] )
+            break;
+
+        //the items not scanned yet are in buckets beyond the faces of the block of buckets scanned so far,
+        //so their boxes are not closer than the nearest face minus the tolerance.
+        if( result.size() == n ){
+            double bound = std::numeric_limits<double>::max();
+            for( int axis = 0; axis < 3; ++axis ){
+                if( low[axis] > 0 )
+                    bound = std::min( bound, location[axis] - ( m_origin[axis] + low[axis] * m_bucketSize[axis] )
+                                             - m_tolerance[axis] );
+                if( high[axis] + 1 < m_nBuckets[axis] )
+                    bound = std::min( bound, m_origin[axis] + ( high[axis] + 1 ) * m_bucketSize[axis] - location[axis]
+                                             - m_tolerance[axis] );
+            }
+            if( bound > 0.0 && bound * bound > result.front().first )
+                break;
+        }
+    }
+    std::sort_heap( result.begin(), result.end() );
+}
+
+void UniformGrid::scanBucketForNearest( size_t bucketIndex, const double (&location)[3], size_t n,
+                                        std::vector<DistanceAndIndex> &heap ) const
+{
+    for( uint32_t iItem = m_bucketStarts[ bucketIndex ]; iItem < m_bucketStarts[ bucketIndex + 1 ]; ++iItem ){
+        const Item& item = m_items[iItem];
+        DistanceAndIndex candidate( squaredGap( location[0], item.center[0], m_tolerance[0] ) +
+                                    squaredGap( location[1], item.center[1], m_tolerance[1] ) +
+                                    squaredGap( location[2], item.center[2], m_tolerance[2] ),
+                                    item.index );
+        if( heap.size() < n ){
+            heap.push_back( candidate );
+            std::push_heap( heap.begin(), heap.end() );
+        } else if( candidate < heap.front() ){
+            std::pop_heap( heap.begin(), heap.end() );
+            heap.back() = candidate;
+            std::push_heap( heap.begin(), heap.end() );
+        }
+    }
+}
+
+void UniformGrid::findIntersecting( double minX, double minY, double minZ,
+                                    double maxX, double maxY, double maxZ,
+                                    std::vector<uint32_t> &result ) const
+{
+    if( m_items.empty() )
+        return;
+    const double min[3] = { minX, minY, minZ };
+    const double max[3] = { maxX, maxY, maxZ };
+    //the buckets with centers that may be in the box enlarged by the tolerances.
+    uint32_t low[3], high[3];
+    for( int axis = 0; axis < 3; ++axis ){
+        if( min[axis] > max[axis] )
+            return;
+        low[axis] = getBucket( axis, min[axis] - m_tolerance[axis] );
+        high[axis] = getBucket( axis, max[axis] + m_tolerance[axis] );
+    }
+    for( uint32_t k = low[2]; k <= high[2]; ++k )
+        for( uint32_t j = low[1]; j <= high[1]; ++j ){
+            //the buckets along I are contiguous, so are their items.
+            uint32_t begin = m_bucketStarts[ getBucketIndex( low[0], j, k ) ];
+            uint32_t end = m_bucketStarts[ getBucketIndex( high[0], j, k ) + 1 ];
+            for( uint32_t iItem = begin; iItem < end; ++iItem ){
+                const Item& item = m_items[iItem];
+                bool intersects = true;
+                for( int axis = 0; axis < 3 && intersects; ++axis )
+                    intersects = item.center[axis] + m_tolerance[axis] >= min[axis] &&
+                                 item.center[axis] - m_tolerance[axis] <= max[axis];
+                if( intersects )
+                    result.push_back( item.index );
+            }
+        }
+}
+
+void UniformGrid::findWithin( double x, double y, double z, double distance, std::vector<uint32_t> &result ) const
+{
+    if( m_items.empty() || distance < 0.0 )
+        return;
+    const double location[3] = { x, y, z };
+    uint32_t low[3], high[3];
+    for( int axis = 0; axis < 3; ++axis ){
+        low[axis] = getBucket( axis, location[axis] - distance - m_tolerance[axis] );
+        high[axis] = getBucket( axis, location[axis] + distance + m_tolerance[axis] );
+    }
+    double squaredDistance = distance * distance;
+    for( uint32_t k = low[2]; k <= high[2]; ++k )
+        for( uint32_t j = low[1]; j <= high[1]; ++j ){
+            uint32_t begin = m_bucketStarts[ getBucketIndex( low[0], j, k ) ];
+            uint32_t end = m_bucketStarts[ getBucketIndex( high[0], j, k ) + 1 ];
+            for( uint32_t iItem = begin; iItem < end; ++iItem ){
+                const Item& item = m_items[iItem];
+                if( squaredGap( x, item.center[0], m_tolerance[0] ) +
+                    squaredGap( y, item.center[1], m_tolerance[1] ) +
+                    squaredGap( z, item.center[2], m_tolerance[2] ) <= squaredDistance )
+                    result.push_back( item.index );
+            }
+        }
+}
+
+void UniformGrid::clear()
+{
+    std::vector< Item >().swap( m_items );
+    std::vector< uint32_t >().swap( m_bucketStarts );
+    for( int axis = 0; axis < 3; ++axis ){
+        m_nBuckets[axis] = 0;
+        m_origin[axis] = 0.0;
+        m_bucketSize[axis] = 1.0;
+        m_tolerance[axis] = 0.0;
+    }
+}
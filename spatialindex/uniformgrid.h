@@ -0,0 +1,98 @@
+#ifndef UNIFORMGRID_H
+#define UNIFORMGRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+/**
+ * A bucketed uniform grid (a.k.a. cell list) of 3D points, used by SpatialIndex as a spatial hash for dense point
+ * data, such as samples located against a regular grid or the cells of a Cartesian grid.  The space spanned by the
+ * points is divided into equal buckets and the points are stored bucket after bucket in a single array, which is
+ * built with one counting sort pass, so building is O(n) and the points near each other are near in memory.
+ * The queries scan the buckets around the query location.
+ * Each point stands for a box with the same half sizes (the tolerances passed to build()), so the queries have the
+ * same semantics as those of KdTree on points.  It is not suitable for items of varying sizes (e.g. GeoGrid cells).
+ */
+class UniformGrid
+{
+public:
+    /** A pair of squared distance and item index as returned by findNearest(). */
+    typedef std::pair< double, uint32_t > DistanceAndIndex;
+
+    UniformGrid();
+
+    /** Pre-allocates memory for the given number of items. */
+    void reserve( size_t nItems );
+
+    /** Adds a point to be indexed.  Call build() after adding all items. */
+    void add( double x, double y, double z, uint32_t index );
+
+    /** Builds the buckets with the points added so far.  The bucket size is set so there are about
+     * two points per bucket on average.
+     * @param toleranceX, toleranceY, toleranceZ The half sizes of the box of every point.
+     */
+    void build( double toleranceX, double toleranceY, double toleranceZ );
+
+    /** Returns the tolerance along the given axis passed to build(). */
+    double getTolerance( int axis ) const { return m_tolerance[axis]; }
+
+    /** Finds the n items nearest to the given location.  The distance to an item is that to its box, which is zero
+     * if the location is inside it.  Ties are broken by the lower index.
+     * @param result Output: squared distances and item indexes, nearest first.
+     */
+    void findNearest( double x, double y, double z, size_t n, std::vector< DistanceAndIndex >& result ) const;
+
+    /** Finds the items whose boxes intersect (or touch) the given box.  The indexes are appended to result
+     * in no particular order. */
+    void findIntersecting( double minX, double minY, double minZ,
+                           double maxX, double maxY, double maxZ,
+                           std::vector< uint32_t >& result ) const;
+
+    /** Finds the items whose boxes are within the given distance to the given location.  The indexes are appended
+     * to result in no particular order. */
+    void findWithin( double x, double y, double z, double distance, std::vector< uint32_t >& result ) const;
+
+    /** Returns the number of items in the grid. */
+    size_t size() const { return m_items.size(); }
+
+    bool empty() const { return m_items.empty(); }
+
+    /** Empties the grid and frees its memory. */
+    void clear();
+
+private:
+    struct Item {
+        double center[3];
+        uint32_t index;
+    };
+
+    /** The items, bucket after bucket (in the order of the bucket linear indexes) after build(). */
+    std::vector< Item > m_items;
+    /** The position in m_items of the first item of each bucket, plus the number of items. */
+    std::vector< uint32_t > m_bucketStarts;
+    /** The number of buckets along each axis. */
+    uint32_t m_nBuckets[3];
+    /** The lower corner of the bucket (0,0,0). */
+    double m_origin[3];
+    /** The bucket sizes along each axis. */
+    double m_bucketSize[3];
+    /** The half sizes of the items' boxes along each axis. */
+    double m_tolerance[3];
+
+    /** Returns the bucket index along the given axis of the given coordinate, clamped to the grid. */
+    uint32_t getBucket( int axis, double coordinate ) const;
+
+    /** Returns the linear index of the given bucket. */
+    size_t getBucketIndex( uint32_t i, uint32_t j, uint32_t k ) const {
+        return ( static_cast<size_t>( k ) * m_nBuckets[1] + j ) * m_nBuckets[0] + i;
+    }
+
+    /** Appends to the heap (a max-heap of the n best items so far) the items of the given bucket closer than
+     * its worst item. */
+    void scanBucketForNearest( size_t bucketIndex, const double (&location)[3], size_t n,
+                               std::vector< DistanceAndIndex >& heap ) const;
+};
+
+#endif // UNIFORMGRID_H
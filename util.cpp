@@ -13,6 +13,7 @@
 #include <QPushButton>
 #include <cassert>
 #include <stdint.h>
+#include <cstring>
 #include <chrono>
 #include "exceptions/invalidgslibdatafileexception.h"
 #include "domain/application.h"
@@ -1577,6 +1578,436 @@ void Util::fastSplit(const QString lineGEOEAS, QStringList & list)
     }
 }
 
+double Util::fastParseDouble(const char *begin, const char *end, bool *ok)
+{
+    //powers of ten that are exactly representable as doubles.
+    static const double exactPowersOfTen[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                               1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                               1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    //integers up to 2^53 are exactly representable as doubles.
+    static const uint64_t maxExactMantissa = 9007199254740992ULL;
+
+    const char* c = begin;
+    bool isNegative = false;
+    if( c < end && ( *c == '-' || *c == '+' ) ){
+        isNegative = ( *c == '-' );
+        ++c;
+    }
+
+    //collect the decimal digits as an integer mantissa and a power of ten.
+    uint64_t mantissa = 0;
+    int nSignificantDigits = 0;
+    int nDigits = 0;
+    int exponent = 0;
+    bool fastPathPossible = true;
+    for( ; c < end && *c >= '0' && *c <= '9'; ++c ){
+        ++nDigits;
+        if( mantissa || *c != '0' )
+            ++nSignificantDigits;
+        mantissa = mantissa * 10 + ( *c - '0' );
+    }
+    if( c < end && *c == '.' ){
+        ++c;
+        for( ; c < end && *c >= '0' && *c <= '9'; ++c ){
+            ++nDigits;
+            if( mantissa || *c != '0' )
+                ++nSignificantDigits;
+            mantissa = mantissa * 10 + ( *c - '0' );
+            --exponent;
+        }
+    }
+    if( ! nDigits || nSignificantDigits > 19 )
+        fastPathPossible = false;
+    if( fastPathPossible && c < end && ( *c == 'e' || *c == 'E' ) ){
+        ++c;
+        bool isExponentNegative = false;
+        if( c < end && ( *c == '-' || *c == '+' ) ){
+            isExponentNegative = ( *c == '-' );
+            ++c;
+        }
+        int exponentPart = 0;
+        int nExponentDigits = 0;
+        for( ; c < end && *c >= '0' && *c <= '9' && nExponentDigits < 5; ++c, ++nExponentDigits )
+            exponentPart = exponentPart * 10 + ( *c - '0' );
+        if( ! nExponentDigits )
+            fastPathPossible = false;
+        exponent += isExponentNegative ? -exponentPart : exponentPart;
+    }
+    if( c != end )
+        fastPathPossible = false;
+
+    //A single multiplication or division of two exactly representable values is correctly rounded (Clinger, 1990).
+    if( fastPathPossible && mantissa <= maxExactMantissa ){
+        double value;
+        bool isExact = true;
+        if( ! mantissa )
+            value = 0.0;
+        else if( exponent >= 0 && exponent <= 22 )
+            value = static_cast<double>( mantissa ) * exactPowersOfTen[ exponent ];
+        else if( exponent < 0 && exponent >= -22 )
+            value = static_cast<double>( mantissa ) / exactPowersOfTen[ -exponent ];
+        else
+            isExact = false;
+        if( isExact ){
+            if( ok )
+                *ok = true;
+            return isNegative ? -value : value;
+        }
+    }
+
+    //fall back to Qt's (locale-independent) conversion for all other cases.
+    return QByteArray::fromRawData( begin, static_cast<int>( end - begin ) ).toDouble( ok );
+}
+
+namespace {
+
+//////////////////////// Shortest round-trip formatting of floating-point values ////////////////////////
+//This is the Grisu2 algorithm (Loitsch, 2010. Printing floating-point numbers quickly and accurately with integers).
+//It always yields digits that are read back as the same value and they are the shortest such digits in
+//the vast majority of cases.
+
+/** A floating-point value of the form f * 2^e with a 64-bit significand. */
+struct DiyFp {
+    uint64_t f;
+    int e;
+    DiyFp( uint64_t f_, int e_ ) : f( f_ ), e( e_ ) {}
+};
+
+/** Returns x - y (x and y must have the same exponent and x >= y). */
+inline DiyFp diyFpSubtract( const DiyFp& x, const DiyFp& y )
+{
+    return DiyFp( x.f - y.f, x.e );
+}
+
+/** Returns x * y with the 128-bit product rounded to the upper 64 bits. */
+inline DiyFp diyFpMultiply( const DiyFp& x, const DiyFp& y )
+{
+    const uint64_t xLo = x.f & 0xFFFFFFFFu;
+    const uint64_t xHi = x.f >> 32;
+    const uint64_t yLo = y.f & 0xFFFFFFFFu;
+    const uint64_t yHi = y.f >> 32;
+    const uint64_t p0 = xLo * yLo;
+    const uint64_t p1 = xLo * yHi;
+    const uint64_t p2 = xHi * yLo;
+    const uint64_t p3 = xHi * yHi;
+    uint64_t middle = ( p0 >> 32 ) + ( p1 & 0xFFFFFFFFu ) + ( p2 & 0xFFFFFFFFu );
+    middle += uint64_t( 1 ) << 31; //round half up
+    const uint64_t high = p3 + ( p1 >> 32 ) + ( p2 >> 32 ) + ( middle >> 32 );
+    return DiyFp( high, x.e + y.e + 64 );
+}
+
+inline DiyFp diyFpNormalize( DiyFp x )
+{
+    while( ! ( x.f >> 63 ) ){
+        x.f <<= 1;
+        --x.e;
+    }
+    return x;
+}
+
+/** Computes the value and the midpoints to its neighbors (the boundaries of its rounding interval).
+ * The significand is read from the binary representation of the value, which must be positive and finite.
+ * @param significandBits The number of significand bits in the binary representation (not counting the hidden bit).
+ * @param exponentBias The exponent bias in the binary representation plus significandBits.
+ */
+inline void computeBoundaries( uint64_t bits, int significandBits, int exponentBias,
+                               DiyFp& value, DiyFp& lowerBoundary, DiyFp& upperBoundary )
+{
+    const uint64_t hiddenBit = uint64_t( 1 ) << significandBits;
+    const uint64_t biasedExponent = bits >> significandBits;
+    const uint64_t fraction = bits & ( hiddenBit - 1 );
+    DiyFp v = biasedExponent ? DiyFp( fraction + hiddenBit, static_cast<int>( biasedExponent ) - exponentBias ) :
+                               DiyFp( fraction, 1 - exponentBias ); //subnormal values
+    //at powers of two, the lower neighbor is closer
+    const bool lowerBoundaryIsCloser = ! fraction && biasedExponent > 1;
+    DiyFp upper( 2 * v.f + 1, v.e - 1 );
+    DiyFp lower = lowerBoundaryIsCloser ? DiyFp( 4 * v.f - 1, v.e - 2 ) : DiyFp( 2 * v.f - 1, v.e - 1 );
+    upperBoundary = diyFpNormalize( upper );
+    lowerBoundary = DiyFp( lower.f << ( lower.e - upperBoundary.e ), upperBoundary.e );
+    value = diyFpNormalize( v );
+}
+
+/** A normalized power of ten: 10^k ~= f * 2^e. */
+struct CachedPowerOfTen {
+    uint64_t f;
+    int e;
+    int k;
+};
+
+/** Returns a power of ten c such that the binary exponent of c * 2^e is in [-60, -32]. */
+inline CachedPowerOfTen getCachedPowerOfTen( int e )
+{
+    static const CachedPowerOfTen powers[] = {
+        { 0xAB70FE17C79AC6CA, -1060, -300 },
+        { 0xFF77B1FCBEBCDC4F, -1034, -292 },
+        { 0xBE5691EF416BD60C, -1007, -284 },
+        { 0x8DD01FAD907FFC3C,  -980, -276 },
+        { 0xD3515C2831559A83,  -954, -268 },
+        { 0x9D71AC8FADA6C9B5,  -927, -260 },
+        { 0xEA9C227723EE8BCB,  -901, -252 },
+        { 0xAECC49914078536D,  -874, -244 },
+        { 0x823C12795DB6CE57,  -847, -236 },
+        { 0xC21094364DFB5637,  -821, -228 },
+        { 0x9096EA6F3848984F,  -794, -220 },
+        { 0xD77485CB25823AC7,  -768, -212 },
+        { 0xA086CFCD97BF97F4,  -741, -204 },
+        { 0xEF340A98172AACE5,  -715, -196 },
+        { 0xB23867FB2A35B28E,  -688, -188 },
+        { 0x84C8D4DFD2C63F3B,  -661, -180 },
+        { 0xC5DD44271AD3CDBA,  -635, -172 },
+        { 0x936B9FCEBB25C996,  -608, -164 },
+        { 0xDBAC6C247D62A584,  -582, -156 },
+        { 0xA3AB66580D5FDAF6,  -555, -148 },
+        { 0xF3E2F893DEC3F126,  -529, -140 },
+        { 0xB5B5ADA8AAFF80B8,  -502, -132 },
+        { 0x87625F056C7C4A8B,  -475, -124 },
+        { 0xC9BCFF6034C13053,  -449, -116 },
+        { 0x964E858C91BA2655,  -422, -108 },
+        { 0xDFF9772470297EBD,  -396, -100 },
+        { 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+        { 0xF8A95FCF88747D94,  -343,  -84 },
+        { 0xB94470938FA89BCF,  -316,  -76 },
+        { 0x8A08F0F8BF0F156B,  -289,  -68 },
+        { 0xCDB02555653131B6,  -263,  -60 },
+        { 0x993FE2C6D07B7FAC,  -236,  -52 },
+        { 0xE45C10C42A2B3B06,  -210,  -44 },
+        { 0xAA242499697392D3,  -183,  -36 },
+        { 0xFD87B5F28300CA0E,  -157,  -28 },
+        { 0xBCE5086492111AEB,  -130,  -20 },
+        { 0x8CBCCC096F5088CC,  -103,  -12 },
+        { 0xD1B71758E219652C,   -77,   -4 },
+        { 0x9C40000000000000,   -50,    4 },
+        { 0xE8D4A51000000000,   -24,   12 },
+        { 0xAD78EBC5AC620000,     3,   20 },
+        { 0x813F3978F8940984,    30,   28 },
+        { 0xC097CE7BC90715B3,    56,   36 },
+        { 0x8F7E32CE7BEA5C70,    83,   44 },
+        { 0xD5D238A4ABE98068,   109,   52 },
+        { 0x9F4F2726179A2245,   136,   60 },
+        { 0xED63A231D4C4FB27,   162,   68 },
+        { 0xB0DE65388CC8ADA8,   189,   76 },
+        { 0x83C7088E1AAB65DB,   216,   84 },
+        { 0xC45D1DF942711D9A,   242,   92 },
+        { 0x924D692CA61BE758,   269,  100 },
+        { 0xDA01EE641A708DEA,   295,  108 },
+        { 0xA26DA3999AEF774A,   322,  116 },
+        { 0xF209787BB47D6B85,   348,  124 },
+        { 0xB454E4A179DD1877,   375,  132 },
+        { 0x865B86925B9BC5C2,   402,  140 },
+        { 0xC83553C5C8965D3D,   428,  148 },
+        { 0x952AB45CFA97A0B3,   455,  156 },
+        { 0xDE469FBD99A05FE3,   481,  164 },
+        { 0xA59BC234DB398C25,   508,  172 },
+        { 0xF6C69A72A3989F5C,   534,  180 },
+        { 0xB7DCBF5354E9BECE,   561,  188 },
+        { 0x88FCF317F22241E2,   588,  196 },
+        { 0xCC20CE9BD35C78A5,   614,  204 },
+        { 0x98165AF37B2153DF,   641,  212 },
+        { 0xE2A0B5DC971F303A,   667,  220 },
+        { 0xA8D9D1535CE3B396,   694,  228 },
+        { 0xFB9B7CD9A4A7443C,   720,  236 },
+        { 0xBB764C4CA7A44410,   747,  244 },
+        { 0x8BAB8EEFB6409C1A,   774,  252 },
+        { 0xD01FEF10A657842C,   800,  260 },
+        { 0x9B10A4E5E9913129,   827,  268 },
+        { 0xE7109BFBA19C0C9D,   853,  276 },
+        { 0xAC2820D9623BF429,   880,  284 },
+        { 0x80444B5E7AA7CF85,   907,  292 },
+        { 0xBF21E44003ACDD2D,   933,  300 },
+        { 0x8E679C2F5E44FF8F,   960,  308 },
+        { 0xD433179D9C8CB841,   986,  316 },
+        { 0x9E19DB92B4E31BA9,  1013,  324 },
+    };
+    static const int minDecimalExponent = -300;
+    static const int decimalExponentStep = 8;
+    const int alpha = -60;
+    const int f = alpha - e - 1;
+    const int k = ( f * 78913 ) / ( 1 << 18 ) + static_cast<int>( f > 0 ); //ceil( f * log10(2) )
+    const int index = ( -minDecimalExponent + k + ( decimalExponentStep - 1 ) ) / decimalExponentStep;
+    return powers[ index ];
+}
+
+/** Returns the number of decimal digits of n and sets powerOfTen to 10^(digits - 1). */
+inline int countDecimalDigits( uint32_t n, uint32_t& powerOfTen )
+{
+    int nDigits = 10;
+    powerOfTen = 1000000000;
+    while( nDigits > 1 && n < powerOfTen ){
+        powerOfTen /= 10;
+        --nDigits;
+    }
+    return nDigits;
+}
+
+/** Moves the last generated digit towards the value as long as the result stays in the rounding interval. */
+inline void grisuRound( char* digits, int nDigits, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t tenToK )
+{
+    while( rest < distance && delta - rest >= tenToK &&
+           ( rest + tenToK < distance || distance - rest > rest + tenToK - distance ) ){
+        --digits[ nDigits - 1 ];
+        rest += tenToK;
+    }
+}
+
+/** Generates the decimal digits of a value given its (scaled) boundaries.
+ * The value is digits * 10^decimalExponent.  Returns the number of digits.
+ */
+int grisuGenerateDigits( char* digits, int& decimalExponent, DiyFp lower, DiyFp value, DiyFp upper )
+{
+    uint64_t delta = diyFpSubtract( upper, lower ).f;
+    uint64_t distance = diyFpSubtract( upper, value ).f;
+    const int shift = -upper.e;
+    const uint64_t one = uint64_t( 1 ) << shift;
+    uint32_t integral = static_cast<uint32_t>( upper.f >> shift );
+    uint64_t fractional = upper.f & ( one - 1 );
+    int nDigits = 0;
+
+    //digits of the integral part
+    uint32_t powerOfTen;
+    int n = countDecimalDigits( integral, powerOfTen );
+    while( n > 0 ){
+        digits[ nDigits++ ] = static_cast<char>( '0' + integral / powerOfTen );
+        integral %= powerOfTen;
+        --n;
+        const uint64_t rest = ( uint64_t( integral ) << shift ) + fractional;
+        if( rest <= delta ){
+            decimalExponent += n;
+            grisuRound( digits, nDigits, distance, delta, rest, uint64_t( powerOfTen ) << shift );
+            return nDigits;
+        }
+        powerOfTen /= 10;
+    }
+
+    //digits of the fractional part
+    int m = 0;
+    while( true ){
+        fractional *= 10;
+        digits[ nDigits++ ] = static_cast<char>( '0' + ( fractional >> shift ) );
+        fractional &= one - 1;
+        ++m;
+        delta *= 10;
+        distance *= 10;
+        if( fractional <= delta )
+            break;
+    }
+    decimalExponent -= m;
+    grisuRound( digits, nDigits, distance, delta, fractional, one );
+    return nDigits;
+}
+
+/** Formats a positive finite value given its shortest digits and decimal exponent (value = digits * 10^exponent).
+ * The layout is that of the %g format of printf(): fixed notation for moderate magnitudes and
+ * scientific notation with a two-digit exponent (e.g. 1e-05) otherwise.
+ * Returns the position past the last written character.
+ */
+char* formatDecimalDigits( const char* digits, int nDigits, int decimalExponent, char* buffer )
+{
+    //the exponent in scientific notation
+    const int scientificExponent = nDigits + decimalExponent - 1;
+    if( scientificExponent >= -4 && scientificExponent < 17 ){
+        if( decimalExponent >= 0 ){
+            //integer: digits followed by zeros
+            std::memcpy( buffer, digits, nDigits );
+            buffer += nDigits;
+            std::memset( buffer, '0', decimalExponent );
+            return buffer + decimalExponent;
+        }
+        if( scientificExponent >= 0 ){
+            //the decimal point goes between the digits
+            const int nIntegralDigits = scientificExponent + 1;
+            std::memcpy( buffer, digits, nIntegralDigits );
+            buffer += nIntegralDigits;
+            *buffer++ = '.';
+            std::memcpy( buffer, digits + nIntegralDigits, nDigits - nIntegralDigits );
+            return buffer + ( nDigits - nIntegralDigits );
+        }
+        //zeros between the decimal point and the digits
+        *buffer++ = '0';
+        *buffer++ = '.';
+        std::memset( buffer, '0', -scientificExponent - 1 );
+        buffer += -scientificExponent - 1;
+        std::memcpy( buffer, digits, nDigits );
+        return buffer + nDigits;
+    }
+    *buffer++ = digits[0];
+    if( nDigits > 1 ){
+        *buffer++ = '.';
+        std::memcpy( buffer, digits + 1, nDigits - 1 );
+        buffer += nDigits - 1;
+    }
+    *buffer++ = 'e';
+    int exponent = scientificExponent;
+    if( exponent < 0 ){
+        *buffer++ = '-';
+        exponent = -exponent;
+    } else
+        *buffer++ = '+';
+    if( exponent >= 100 ){
+        *buffer++ = static_cast<char>( '0' + exponent / 100 );
+        exponent %= 100;
+    }
+    *buffer++ = static_cast<char>( '0' + exponent / 10 );
+    *buffer++ = static_cast<char>( '0' + exponent % 10 );
+    return buffer;
+}
+
+/** Formats a value of either precision.  For single precision values, the rounding interval
+ * is that of float, so the digits are the shortest that read back as the same float.
+ */
+char* formatShortest( double value, uint64_t bits, int significandBits, int exponentBias, char* buffer )
+{
+    if( value != value ){
+        std::memcpy( buffer, "nan", 3 );
+        return buffer + 3;
+    }
+    if( std::signbit( value ) ){
+        *buffer++ = '-';
+        value = -value;
+    }
+    if( value == 0.0 ){
+        *buffer = '0';
+        return buffer + 1;
+    }
+    if( std::isinf( value ) ){
+        std::memcpy( buffer, "inf", 3 );
+        return buffer + 3;
+    }
+    //discard the sign bit
+    bits &= ~( uint64_t( 1 ) << ( significandBits + ( significandBits > 23 ? 11 : 8 ) ) );
+
+    DiyFp v( 0, 0 ), lower( 0, 0 ), upper( 0, 0 );
+    computeBoundaries( bits, significandBits, exponentBias, v, lower, upper );
+    //scale the value and its boundaries by a power of ten so their binary exponent falls in [-60, -32]
+    const CachedPowerOfTen cached = getCachedPowerOfTen( upper.e );
+    const DiyFp c( cached.f, cached.e );
+    const DiyFp w = diyFpMultiply( v, c );
+    DiyFp wLower = diyFpMultiply( lower, c );
+    DiyFp wUpper = diyFpMultiply( upper, c );
+    //account for the imprecision of the products
+    ++wLower.f;
+    --wUpper.f;
+    char digits[20];
+    int decimalExponent = -cached.k;
+    int nDigits = grisuGenerateDigits( digits, decimalExponent, wLower, w, wUpper );
+    return formatDecimalDigits( digits, nDigits, decimalExponent, buffer );
+}
+
+}
+
+char* Util::fastFormatDouble(double value, char *buffer)
+{
+    uint64_t bits;
+    std::memcpy( &bits, &value, sizeof(bits) );
+    return formatShortest( value, bits, 52, 1075, buffer );
+}
+
+char* Util::fastFormatFloat(float value, char *buffer)
+{
+    uint32_t bits;
+    std::memcpy( &bits, &value, sizeof(bits) );
+    return formatShortest( value, bits, 23, 150, buffer );
+}
+
 std::vector<std::string> Util::tokenizeWithDoubleQuotes( const std::string &lineOfText, bool includeDoubleQuotes )
 {
     std::vector<std::string> result;
@@ -526,6 +526,39 @@ public:
      */
 	static void fastSplit(const QString lineGEOEAS, QStringList& list);
 
+    /** Returns whether the given character can be part of a value in a data line of GEO-EAS files.
+     *  Any other character is a separator.  This is the same rule used by fastSplit().
+     */
+    inline static bool isGEOEASNumberChar( char c ){
+        switch( c ){
+            case '-': case '.': case '0': case '1': case '2': case '3': case '4': case '5':
+            case '6': case '7': case '8': case '9': case 'E': case 'e': case '+':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /** Converts the characters in [begin, end) to a double without allocating memory.
+     *  This is meant to parse values directly from a buffer (e.g. a memory-mapped file).
+     *  Plain decimal values (the vast majority in GEO-EAS files) take an exact fast path.
+     *  Other cases are handed over to QByteArray::toDouble(), so the result is always the same
+     *  as that of QString::toDouble().
+     *  @param ok If not null, it is set to false if the conversion fails.  In this case, zero is returned.
+     */
+    static double fastParseDouble( const char* begin, const char* end, bool* ok = nullptr );
+
+    /** Writes the shortest decimal representation of a value that is read back as the same value
+     *  (e.g. 0.1 instead of 0.10000000000000001).  The output is locale-independent and laid out
+     *  like printf()'s %g format (e.g. 1e-05), so any program reading GEO-EAS files (e.g. GSLib) can read it.
+     *  @param buffer Must have room for at least 32 characters.  No terminating null char is written.
+     *  @return The position past the last written character.
+     */
+    static char* fastFormatDouble( double value, char* buffer );
+
+    /** Same as fastFormatDouble() but for single precision values (e.g. 0.1f is written as 0.1). */
+    static char* fastFormatFloat( float value, char* buffer );
+
     /**
      * Tokenizes a line of text using blank spaces or tabulation characters as separator.
      * Text enclosed in double quotes are kept as one token.